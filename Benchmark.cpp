@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "Renderer.h"
+#include "SceneGenerator.h"
+#include "Benchmark.h"
+#ifdef _WIN32
+#include <psapi.h>
+#endif
+
+namespace
+{
+	struct Timings
+	{
+		float average = 0.f, p95 = 0.f;
+	};
+
+	Timings Summarize(std::vector<float> samples)
+	{
+		Timings timings;
+		if (samples.empty()) return timings;
+
+		std::sort(samples.begin(), samples.end());
+		timings.average = std::accumulate(samples.begin(), samples.end(), 0.f) / samples.size();
+		timings.p95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+		return timings;
+	}
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& settings) : _settings(settings)
+{
+}
+
+unsigned long long Benchmark::GetProcessMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS_EX counters = { sizeof(counters) };
+	if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) return counters.PrivateUsage;
+#endif
+	return 0;
+}
+
+bool Benchmark::Run(VulkanRenderer*& renderer, GWindow& win)
+{
+	std::ofstream csv(_settings.output);
+	if (!csv)
+	{
+		std::cout << "Error: can't write " << _settings.output << '\n';
+		return true;
+	}
+
+	csv << "gbuffer,subpass_merge,merged_passes,target_triangles,triangles,instances,draws,lights,frame_ms_avg,frame_ms_p95,cpu_ms_avg,cpu_ms_p95,gpu_ms_avg,gpu_ms_p95,geometry_mb,process_mb,device_mb,device_budget_mb,transient_mb,transient_saved_mb,gbuffer_bytes_per_pixel,command_buffers,barriers,async_ms,async_overlap_ms\n";
+
+	for (auto& configuration : _settings.configurations)
+	{
+		//the frame graph's nodes are built for one layout, the next renderer starts it over
+		delete renderer;
+		FrameGraph::DestroyInstance();
+		renderer = new VulkanRenderer(win, configuration.gBufferLayout, configuration.mergeSubpasses);
+
+		if (!Sweep(*renderer, win, configuration, csv)) return false;
+	}
+
+	std::cout << "Benchmark results written to " << _settings.output << '\n';
+	return true;
+}
+
+bool Benchmark::Sweep(VulkanRenderer& renderer, GWindow& win, const BenchmarkConfiguration& configuration, std::ofstream& csv)
+{
+	const char* layout = configuration.gBufferLayout == GBufferLayout::COMPACT ? "compact" : "full";
+
+	//the first frame runs the frame graph setup, SetView needs its buffers
+	if (!+win.ProcessWindowEvents()) return false;
+	renderer.Render();
+
+	for (size_t sizeIdx = 0; sizeIdx < _settings.triangleCounts.size(); sizeIdx++)
+	{
+		SceneGeneratorSettings sceneSettings;
+		sceneSettings.targetTriangles = _settings.triangleCounts[sizeIdx];
+		sceneSettings.lights = _settings.lights;
+
+		nlohmann::json scene = SceneGenerator::Generate(sceneSettings);
+		if (!_settings.sceneDirectory.empty())
+		{
+			std::filesystem::create_directories(_settings.sceneDirectory);
+			SceneGenerator::Save(scene, _settings.sceneDirectory + "/Generated_" + std::to_string(sceneSettings.targetTriangles) + ".json");
+		}
+
+		renderer.UnloadScene();
+		renderer.LoadScene(scene);
+
+		//look down at the whole grid
+		float extent = std::sqrt(scene.value("instances", 1.f)) * sceneSettings.spacing;
+		renderer.SetView(vec4{ 0.f, extent * .6f + 5.f, -extent * .8f - 5.f, 1.f }, vec4{ 0.f, 0.f, 0.f, 1.f });
+
+		std::vector<float> frameMs, cpuMs, gpuMs;
+		for (unsigned int frame = 0; frame < _settings.warmupFrames + _settings.measuredFrames; frame++)
+		{
+			if (!+win.ProcessWindowEvents()) return false;
+
+			auto start = std::chrono::steady_clock::now();
+			renderer.Render();
+			float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			if (frame < _settings.warmupFrames) continue;
+
+			const FrameStats& stats = renderer.GetFrameStats();
+			frameMs.push_back(elapsed);
+			cpuMs.push_back(stats.cpuMs);
+			if (stats.gpuMs >= 0.f) gpuMs.push_back(stats.gpuMs);
+		}
+
+		const FrameStats& stats = renderer.GetFrameStats();
+		Timings frame = Summarize(frameMs), cpu = Summarize(cpuMs), gpu = Summarize(gpuMs);
+
+		csv << layout << ',' << configuration.mergeSubpasses << ',' << stats.mergedPasses << ',' << sceneSettings.targetTriangles << ',' << stats.triangles << ',' << scene.value("instances", 0ull) << ',' << stats.draws << ',' << sceneSettings.lights << ','
+			<< frame.average << ',' << frame.p95 << ',' << cpu.average << ',' << cpu.p95 << ',';
+		if (gpuMs.empty()) csv << ",,";
+		else csv << gpu.average << ',' << gpu.p95 << ',';
+		csv << stats.geometryBytes / (1024.f * 1024.f) << ',' << GetProcessMemory() / (1024.f * 1024.f) << ',' << stats.deviceUsage / (1024.f * 1024.f) << ',' << stats.deviceBudget / (1024.f * 1024.f) << ','
+			<< stats.transientBytes / (1024.f * 1024.f) << ',' << stats.transientSavedBytes / (1024.f * 1024.f) << ',' << stats.gBufferBytesPerPixel << ',' << stats.commandBuffers << ',' << stats.barriers << ',' << stats.asyncMs << ',' << stats.asyncOverlapMs << '\n';
+		csv.flush();
+
+		std::cout << "Benchmark " << layout << (configuration.mergeSubpasses ? " merged " : " separate ") << sizeIdx + 1 << '/' << _settings.triangleCounts.size() << ": " << stats.triangles << " triangles, " << stats.draws << " draws, "
+			<< frame.average << "ms frame, " << cpu.average << "ms cpu, " << (gpuMs.empty() ? -1.f : gpu.average) << "ms gpu\n";
+	}
+
+	return true;
+}
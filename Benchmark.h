@@ -0,0 +1,41 @@
+#pragma once
+
+struct BenchmarkConfiguration
+{
+	GBufferLayout gBufferLayout = GBufferLayout::FULL;
+	bool mergeSubpasses = true;
+};
+
+struct BenchmarkSettings
+{
+	std::vector<unsigned long long> triangleCounts = { 100000, 1000000, 5000000, 10000000, 25000000 };
+	unsigned int lights = 10;
+	unsigned int warmupFrames = 60;
+	unsigned int measuredFrames = 300;
+	std::string output = "benchmark.csv";
+	std::string sceneDirectory; //also writes every generated scene here when set
+	//each gets a renderer of its own, these are only chosen when it's created
+	std::vector<BenchmarkConfiguration> configurations =
+	{
+		{ GBufferLayout::FULL, true },
+		{ GBufferLayout::FULL, false },
+		{ GBufferLayout::COMPACT, true },
+		{ GBufferLayout::COMPACT, false }
+	};
+};
+
+//sweeps generated scenes of increasing size for every configuration and writes one csv row per configuration and size
+class Benchmark
+{
+	BenchmarkSettings _settings;
+
+	static unsigned long long GetProcessMemory();
+	bool Sweep(VulkanRenderer& renderer, GWindow& win, const BenchmarkConfiguration& configuration, std::ofstream& csv);
+
+public:
+	Benchmark(const BenchmarkSettings& settings);
+
+	//replaces renderer with a new one per configuration, the last configuration's is left there
+	//false if the window was closed before the sweep finished
+	bool Run(VulkanRenderer*& renderer, GWindow& win);
+};
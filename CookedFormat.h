@@ -0,0 +1,300 @@
+#pragma once
+
+// Shared between the renderer and the Cooker tool, so keep this free of Gateware/Vulkan
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Cooked
+{
+	constexpr uint32_t MESH_MAGIC = 0x48534D49; //"IMSH"
+	constexpr uint32_t TEXTURE_MAGIC = 0x58455449; //"ITEX"
+	constexpr uint32_t MESH_VERSION = 2;
+	constexpr uint32_t TEXTURE_VERSION = 1;
+	constexpr const char* MANIFEST_PATH = "Cooked/manifest.json";
+
+	struct MeshHeader
+	{
+		uint32_t magic = MESH_MAGIC;
+		uint32_t version = MESH_VERSION;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		uint32_t primitiveCount = 0;
+		uint32_t drawCount = 0;
+		float posMin[3] = { 0, 0, 0 };
+		float posScale[3] = { 0, 0, 0 }; //extent / 65535
+	};
+
+	struct Primitive
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		uint32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+		int32_t materialIndex = -1;
+	};
+
+	//one per (node, primitive) pair, the transform is kept as TRS so the renderer builds the exact same matrix it would from the gltf node
+	struct Draw
+	{
+		uint32_t primitive = 0;
+		float translation[3] = { 0, 0, 0 };
+		float rotation[4] = { 0, 0, 0, 1 };
+		float scale[3] = { 1, 1, 1 };
+	};
+
+	//quantized vertex streams, stored as separate planes to match the renderer's vertex bindings
+	//on disk each stream (and the index buffer) is compressed with MeshCodec
+	struct MeshData
+	{
+		MeshHeader header;
+		std::vector<Primitive> primitives;
+		std::vector<Draw> draws;
+		std::vector<uint16_t> positions; //unorm16 x3 inside the mesh bounds
+		std::vector<int16_t> normals; //octahedral snorm16 x2
+		std::vector<uint16_t> texCoords; //half x2
+		std::vector<int8_t> tangents; //snorm8 x4, w is handedness
+		std::vector<uint32_t> indices; //local to the primitive
+	};
+
+	enum class TextureFormat : uint32_t
+	{
+		RGBA8 = 0,
+		BC1 = 1,
+		BC3 = 2,
+	};
+
+	struct TextureHeader
+	{
+		uint32_t magic = TEXTURE_MAGIC;
+		uint32_t version = TEXTURE_VERSION;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipCount = 0;
+		TextureFormat format = TextureFormat::RGBA8;
+	};
+
+	struct TextureMip
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t byteOffset = 0; //from the start of the mip data
+		uint32_t byteSize = 0;
+	};
+
+	struct TextureData
+	{
+		TextureHeader header;
+		std::vector<TextureMip> mips;
+		std::vector<uint8_t> data;
+	};
+
+	//64-bit FNV-1a, used for incremental cooking
+	inline uint64_t Hash(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	inline uint16_t FloatToHalf(float f)
+	{
+		uint32_t x;
+		memcpy(&x, &f, sizeof(x));
+		uint32_t sign = (x >> 16) & 0x8000;
+		int32_t exponent = int32_t((x >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = x & 0x7FFFFF;
+
+		if (((x >> 23) & 0xFF) == 0xFF) return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0)); //inf/nan
+		if (exponent >= 31) return uint16_t(sign | 0x7C00); //overflow
+		if (exponent <= 0) //denormal or zero
+		{
+			if (exponent < -10) return uint16_t(sign);
+			mantissa |= 0x800000;
+			uint32_t shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1) half++; //round
+			return uint16_t(sign | half);
+		}
+
+		uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000) half++; //round, may carry into the exponent which is still correct
+		return uint16_t(half);
+	}
+
+	inline float HalfToFloat(uint16_t h)
+	{
+		uint32_t sign = uint32_t(h & 0x8000) << 16;
+		uint32_t exponent = (h >> 10) & 0x1F;
+		uint32_t mantissa = h & 0x3FF;
+		uint32_t x;
+
+		if (exponent == 0)
+		{
+			if (mantissa == 0) x = sign;
+			else
+			{
+				//renormalize
+				exponent = 1;
+				while (!(mantissa & 0x400)) { mantissa <<= 1; exponent--; }
+				mantissa &= 0x3FF;
+				x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+			}
+		}
+		else if (exponent == 31) x = sign | 0x7F800000 | (mantissa << 13);
+		else x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+
+		float f;
+		memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+
+	inline int16_t ToSnorm16(float v) { return int16_t(std::lround(std::fmax(-1.f, std::fmin(1.f, v)) * 32767.f)); }
+	inline float FromSnorm16(int16_t v) { return std::fmax(-1.f, v / 32767.f); }
+	inline int8_t ToSnorm8(float v) { return int8_t(std::lround(std::fmax(-1.f, std::fmin(1.f, v)) * 127.f)); }
+	inline float FromSnorm8(int8_t v) { return std::fmax(-1.f, v / 127.f); }
+
+	//octahedral normal encoding
+	inline void OctEncode(const float n[3], int16_t out[2])
+	{
+		float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+		float x = l1 > 0 ? n[0] / l1 : 0, y = l1 > 0 ? n[1] / l1 : 0;
+		if (n[2] < 0)
+		{
+			float ox = x;
+			x = (1.f - fabsf(y)) * (ox >= 0 ? 1.f : -1.f);
+			y = (1.f - fabsf(ox)) * (y >= 0 ? 1.f : -1.f);
+		}
+		out[0] = ToSnorm16(x);
+		out[1] = ToSnorm16(y);
+	}
+
+	inline void OctDecode(const int16_t in[2], float out[3])
+	{
+		float x = FromSnorm16(in[0]), y = FromSnorm16(in[1]);
+		float z = 1.f - fabsf(x) - fabsf(y);
+		if (z < 0)
+		{
+			float ox = x;
+			x = (1.f - fabsf(y)) * (ox >= 0 ? 1.f : -1.f);
+			y = (1.f - fabsf(ox)) * (y >= 0 ? 1.f : -1.f);
+		}
+		float l = sqrtf(x * x + y * y + z * z);
+		out[0] = x / l;
+		out[1] = y / l;
+		out[2] = z / l;
+	}
+
+	template <typename T>
+	inline void WriteVector(std::ofstream& file, const std::vector<T>& v)
+	{
+		if (!v.empty()) file.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+	}
+
+	template <typename T>
+	inline bool ReadVector(std::ifstream& file, std::vector<T>& v, size_t count)
+	{
+		v.resize(count);
+		if (count) file.read(reinterpret_cast<char*>(v.data()), count * sizeof(T));
+		return bool(file);
+	}
+
+	inline bool WriteMesh(const std::string& path, const MeshData& mesh)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+
+		file.write(reinterpret_cast<const char*>(&mesh.header), sizeof(MeshHeader));
+		WriteVector(file, mesh.primitives);
+		WriteVector(file, mesh.draws);
+
+		const uint32_t vertexCount = mesh.header.vertexCount;
+		std::vector<uint8_t> encoded;
+		MeshCodec::EncodeVertexStream(mesh.positions.data(), vertexCount, 6, 2, encoded);
+		MeshCodec::EncodeVertexStream(mesh.normals.data(), vertexCount, 4, 2, encoded);
+		MeshCodec::EncodeVertexStream(mesh.texCoords.data(), vertexCount, 4, 2, encoded);
+		MeshCodec::EncodeVertexStream(mesh.tangents.data(), vertexCount, 4, 1, encoded);
+		MeshCodec::EncodeIndexStream(mesh.indices.data(), mesh.header.indexCount, encoded);
+
+		uint64_t encodedSize = encoded.size();
+		file.write(reinterpret_cast<const char*>(&encodedSize), sizeof(encodedSize));
+		WriteVector(file, encoded);
+		return bool(file);
+	}
+
+	//reads the file in one go, then decodes the streams one after another, each fanning its blocks out over the codec's workers
+	inline bool ReadMesh(const std::string& path, MeshData& mesh)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+
+		file.read(reinterpret_cast<char*>(&mesh.header), sizeof(MeshHeader));
+		if (!file || mesh.header.magic != MESH_MAGIC || mesh.header.version != MESH_VERSION) return false;
+
+		const MeshHeader& h = mesh.header;
+		uint64_t encodedSize = 0;
+		if (!ReadVector(file, mesh.primitives, h.primitiveCount) || !ReadVector(file, mesh.draws, h.drawCount)) return false;
+		if (!file.read(reinterpret_cast<char*>(&encodedSize), sizeof(encodedSize))) return false;
+
+		std::vector<uint8_t> encoded;
+		if (!ReadVector(file, encoded, encodedSize)) return false;
+
+		mesh.positions.resize(size_t(h.vertexCount) * 3);
+		mesh.normals.resize(size_t(h.vertexCount) * 2);
+		mesh.texCoords.resize(size_t(h.vertexCount) * 2);
+		mesh.tangents.resize(size_t(h.vertexCount) * 4);
+		mesh.indices.resize(h.indexCount);
+
+		//streams are back to back, walk them once to find where each starts
+		const uint8_t* end = encoded.data() + encoded.size();
+		const uint8_t* streams[5] = { encoded.data() };
+		for (int i = 1; i < 5; i++)
+		{
+			MeshCodec::StreamHeader header;
+			std::vector<uint32_t> offsets;
+			const uint8_t* p = streams[i - 1];
+			if (!MeshCodec::detail::ReadHeader(p, end, header, offsets, MeshCodec::VERTEX_BLOCK_ELEMENTS)) return false;
+			streams[i] = p + offsets.back();
+		}
+
+		return MeshCodec::DecodeVertexStream(streams[0], end, mesh.positions.data(), h.vertexCount, 6)
+			&& MeshCodec::DecodeVertexStream(streams[1], end, mesh.normals.data(), h.vertexCount, 4)
+			&& MeshCodec::DecodeVertexStream(streams[2], end, mesh.texCoords.data(), h.vertexCount, 4)
+			&& MeshCodec::DecodeVertexStream(streams[3], end, mesh.tangents.data(), h.vertexCount, 4)
+			&& MeshCodec::DecodeIndexStream(streams[4], end, mesh.indices.data(), h.indexCount);
+	}
+
+	inline bool WriteTexture(const std::string& path, const TextureData& texture)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+
+		file.write(reinterpret_cast<const char*>(&texture.header), sizeof(TextureHeader));
+		WriteVector(file, texture.mips);
+		WriteVector(file, texture.data);
+		return bool(file);
+	}
+
+	inline bool ReadTexture(const std::string& path, TextureData& texture)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+
+		file.read(reinterpret_cast<char*>(&texture.header), sizeof(TextureHeader));
+		if (!file || texture.header.magic != TEXTURE_MAGIC || texture.header.version != TEXTURE_VERSION) return false;
+		if (!ReadVector(file, texture.mips, texture.header.mipCount)) return false;
+
+		size_t size = 0;
+		for (auto& mip : texture.mips) size = std::max<size_t>(size, size_t(mip.byteOffset) + mip.byteSize);
+		return ReadVector(file, texture.data, size);
+	}
+}
@@ -0,0 +1,293 @@
+#include "Cooker.h"
+#include "MeshCooker.h"
+#include "TextureCooker.h"
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../tinygltf/tiny_gltf.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	bool ReadFile(const fs::path& path, std::vector<char>& out)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+		out.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read(out.data(), out.size());
+		return bool(file);
+	}
+
+	std::string ToHex(uint64_t v)
+	{
+		std::ostringstream ss;
+		ss << std::hex << v;
+		return ss.str();
+	}
+}
+
+void ParallelFor(size_t count, unsigned int jobs, const std::function<void(size_t)>& fn)
+{
+	if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+	jobs = (unsigned int)std::min<size_t>(jobs, count);
+
+	if (jobs <= 1)
+	{
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	std::atomic<size_t> next = 0;
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < jobs; t++)
+	{
+		workers.emplace_back([&]()
+			{
+				for (size_t i = next++; i < count; i = next++) fn(i);
+			});
+	}
+	for (auto& w : workers) w.join();
+}
+
+Cooker::Cooker(const CookerOptions& options) : _options(options)
+{
+	std::ifstream manifest(fs::path(_options.outputDir) / "manifest.json");
+	if (manifest)
+	{
+		_previousManifest = nlohmann::json::parse(manifest, nullptr, false);
+		if (_previousManifest.is_discarded()) _previousManifest = nlohmann::json();
+	}
+}
+
+std::vector<fs::path> Cooker::FindSources() const
+{
+	std::vector<fs::path> sources;
+	if (!fs::exists(_options.modelsDir)) return sources;
+
+	for (auto& entry : fs::recursive_directory_iterator(_options.modelsDir))
+	{
+		if (!entry.is_regular_file()) continue;
+		auto ext = entry.path().extension().string();
+		if (ext == ".gltf" || ext == ".glb") sources.push_back(fs::relative(entry.path()));
+	}
+
+	std::sort(sources.begin(), sources.end());
+	return sources;
+}
+
+//hashes the gltf plus every external buffer/image it references, and the cooked format versions
+uint64_t Cooker::HashSource(const fs::path& source) const
+{
+	uint32_t versions[2] = { Cooked::MESH_VERSION, Cooked::TEXTURE_VERSION };
+	uint64_t hash = Cooked::Hash(versions, sizeof(versions));
+
+	std::vector<char> bytes;
+	if (!ReadFile(source, bytes)) return 0;
+	hash = Cooked::Hash(bytes.data(), bytes.size(), hash);
+
+	if (source.extension() != ".gltf") return hash;
+
+	nlohmann::json json = nlohmann::json::parse(bytes.begin(), bytes.end(), nullptr, false);
+	if (json.is_discarded()) return hash;
+
+	for (const char* section : { "buffers", "images" })
+	{
+		if (!json.contains(section)) continue;
+		for (auto& item : json[section])
+		{
+			if (!item.contains("uri") || !item["uri"].is_string()) continue;
+			std::string uri = item["uri"];
+			if (uri.rfind("data:", 0) == 0) continue; //embedded, already hashed with the gltf
+
+			std::string decoded;
+			tinygltf::URIDecode(uri, &decoded, nullptr);
+			hash = Cooked::Hash(decoded.data(), decoded.size(), hash);
+			if (ReadFile(source.parent_path() / decoded, bytes)) hash = Cooked::Hash(bytes.data(), bytes.size(), hash);
+		}
+	}
+
+	return hash;
+}
+
+bool Cooker::IsUpToDate(const CookedAsset& asset) const
+{
+	if (_options.force || !_previousManifest.contains("assets")) return false;
+
+	for (auto& entry : _previousManifest.at("assets"))
+	{
+		if (entry.value("source", "") != asset.source) continue;
+		if (entry.value("hash", "") != ToHex(asset.hash)) return false;
+
+		if (!fs::exists(entry.value("mesh", ""))) return false;
+		if (!entry.contains("materials")) return false; //cooked before materials were recorded
+		for (auto& tex : entry.value("textures", std::vector<std::string>()))
+			if (!fs::exists(tex)) return false;
+		return true;
+	}
+	return false;
+}
+
+void Cooker::CookAsset(CookedAsset& asset)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	//import
+	tinygltf::Model model;
+	tinygltf::TinyGLTF loader;
+	std::string error, warning;
+	bool loaded = fs::path(asset.source).extension() == ".glb"
+		? loader.LoadBinaryFromFile(&model, &error, &warning, asset.source)
+		: loader.LoadASCIIFromFile(&model, &error, &warning, asset.source);
+
+	if (!warning.empty()) Log("Warning: " + asset.source + ": " + warning);
+	if (!loaded)
+	{
+		Log("Error: failed to import " + asset.source + ": " + error);
+		asset.failed = true;
+		return;
+	}
+
+	fs::path outBase = fs::path(_options.outputDir) / fs::path(asset.source).replace_extension();
+	fs::create_directories(outBase.parent_path());
+
+	asset.mesh = outBase.generic_string() + ".imesh";
+	asset.textures.resize(model.images.size());
+	for (auto& material : model.materials)
+	{
+		int texture = material.pbrMetallicRoughness.baseColorTexture.index;
+		asset.materials.push_back(texture >= 0 && texture < (int)model.textures.size() ? model.textures[texture].source : -1);
+	}
+	std::atomic<bool> failed = false;
+
+	//mesh and every texture cook independently
+	ParallelFor(1 + model.images.size(), _options.jobs, [&](size_t task)
+		{
+			std::string taskError;
+			if (task == 0)
+			{
+				Cooked::MeshData mesh;
+				if (!CookMesh(model, mesh, taskError) || !Cooked::WriteMesh(asset.mesh, mesh))
+				{
+					Log("Error: " + asset.source + " mesh: " + (taskError.empty() ? "write failed" : taskError));
+					failed = true;
+					return;
+				}
+				asset.vertexCount = mesh.header.vertexCount;
+				asset.indexCount = mesh.header.indexCount;
+				asset.drawCount = mesh.header.drawCount;
+				return;
+			}
+
+			size_t imageIdx = task - 1;
+			std::string path = outBase.generic_string() + "_tex" + std::to_string(imageIdx) + ".itex";
+			Cooked::TextureData texture;
+			if (!CookTexture(model.images[imageIdx], texture, taskError) || !Cooked::WriteTexture(path, texture))
+			{
+				Log("Error: " + asset.source + " image " + std::to_string(imageIdx) + ": " + (taskError.empty() ? "write failed" : taskError));
+				failed = true;
+				return;
+			}
+			asset.textures[imageIdx] = path;
+		});
+
+	asset.failed = failed;
+
+	std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+	if (!asset.failed)
+	{
+		std::ostringstream ss;
+		//compare against the float streams the renderer used to read straight from the gltf
+		size_t rawBytes = size_t(asset.vertexCount) * (sizeof(float) * 12) + size_t(asset.indexCount) * sizeof(uint32_t);
+		size_t meshBytes = fs::file_size(asset.mesh);
+		ss << "Cooked " << asset.source << ": " << asset.vertexCount << " vertices, " << asset.indexCount << " indices ("
+			<< meshBytes / 1024 << " KB, " << float(rawBytes) / std::max<size_t>(meshBytes, 1) << "x smaller than raw), "
+			<< asset.textures.size() << " textures in " << elapsed.count() << "s";
+		Log(ss.str());
+	}
+}
+
+void Cooker::WriteManifest(const std::vector<CookedAsset>& assets) const
+{
+	nlohmann::json manifest;
+	manifest["version"] = 1;
+	manifest["assets"] = nlohmann::json::array();
+
+	for (auto& asset : assets)
+	{
+		if (asset.failed) continue;
+
+		nlohmann::json entry;
+		entry["source"] = asset.source;
+		entry["hash"] = ToHex(asset.hash);
+		entry["mesh"] = asset.mesh;
+		entry["textures"] = asset.textures;
+		entry["materials"] = asset.materials;
+		entry["vertexCount"] = asset.vertexCount;
+		entry["indexCount"] = asset.indexCount;
+		entry["drawCount"] = asset.drawCount;
+		manifest["assets"].push_back(entry);
+	}
+
+	fs::create_directories(_options.outputDir);
+	std::ofstream file(fs::path(_options.outputDir) / "manifest.json");
+	file << manifest.dump(1, '\t');
+}
+
+void Cooker::Log(const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(_logMutex);
+	std::cout << message << '\n';
+}
+
+int Cooker::Run()
+{
+	auto sources = FindSources();
+	if (sources.empty())
+	{
+		Log("No .gltf/.glb files found under " + _options.modelsDir);
+		return 1;
+	}
+
+	std::vector<CookedAsset> assets(sources.size());
+	ParallelFor(sources.size(), _options.jobs, [&](size_t i)
+		{
+			CookedAsset& asset = assets[i];
+			asset.source = sources[i].generic_string();
+			asset.hash = HashSource(sources[i]);
+
+			if (IsUpToDate(asset))
+			{
+				//carry the previous entry forward untouched, read only, the workers share the manifest
+				const nlohmann::json& previous = _previousManifest;
+				for (auto& entry : previous.at("assets"))
+				{
+					if (entry.value("source", "") != asset.source) continue;
+					asset.mesh = entry.value("mesh", "");
+					asset.textures = entry.value("textures", std::vector<std::string>());
+					asset.materials = entry.value("materials", std::vector<int>());
+					asset.vertexCount = entry.value("vertexCount", 0u);
+					asset.indexCount = entry.value("indexCount", 0u);
+					asset.drawCount = entry.value("drawCount", 0u);
+				}
+				asset.upToDate = true;
+				Log("Up to date " + asset.source);
+				return;
+			}
+
+			CookAsset(asset);
+		});
+
+	WriteManifest(assets);
+
+	size_t failed = std::count_if(assets.begin(), assets.end(), [](const CookedAsset& a) { return a.failed; });
+	size_t skipped = std::count_if(assets.begin(), assets.end(), [](const CookedAsset& a) { return a.upToDate; });
+	std::cout << assets.size() - failed - skipped << " cooked, " << skipped << " up to date, " << failed << " failed\n";
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "../CookedFormat.h"
+#include "../tinygltf/json.hpp"
+#include "../tinygltf/tiny_gltf.h"
+#include <filesystem>
+#include <functional>
+#include <mutex>
+
+struct CookerOptions
+{
+	std::string modelsDir = "Models";
+	std::string outputDir = "Cooked";
+	unsigned int jobs = 0; //0 = hardware concurrency
+	bool force = false;
+};
+
+struct CookedAsset
+{
+	std::string source; //as the renderer names it, e.g. "Models/Shapes/Shapes.gltf"
+	uint64_t hash = 0;
+	std::string mesh;
+	std::vector<std::string> textures;
+	std::vector<int> materials; //base color image per gltf material, -1 without one
+	unsigned int vertexCount = 0, indexCount = 0, drawCount = 0;
+	bool upToDate = false;
+	bool failed = false;
+};
+
+//runs fn(0..count-1) on up to 'jobs' threads
+void ParallelFor(size_t count, unsigned int jobs, const std::function<void(size_t)>& fn);
+
+class Cooker
+{
+	CookerOptions _options;
+	nlohmann::json _previousManifest;
+	std::mutex _logMutex;
+
+	std::vector<std::filesystem::path> FindSources() const;
+	uint64_t HashSource(const std::filesystem::path& source) const;
+	bool IsUpToDate(const CookedAsset& asset) const;
+	void CookAsset(CookedAsset& asset);
+	void WriteManifest(const std::vector<CookedAsset>& assets) const;
+	void Log(const std::string& message);
+
+public:
+	Cooker(const CookerOptions& options);
+
+	int Run();
+};
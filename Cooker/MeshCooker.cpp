@@ -0,0 +1,457 @@
+#include "MeshCooker.h"
+#include <array>
+#include <cfloat>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+	//trivial so the float streams read from gltf can be copied straight in, value initialization still zeroes it
+	struct float3 { float x, y, z; };
+
+	inline float3 operator+(const float3& a, const float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline float3 operator-(const float3& a, const float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline float3 operator*(const float3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+	inline float Dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float3 Cross(const float3& a, const float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	inline float3 Normalize(const float3& a)
+	{
+		float l = sqrtf(Dot(a, a));
+		return l > 0 ? a * (1.f / l) : float3{};
+	}
+
+	//raw float primitive before quantization
+	struct SourcePrimitive
+	{
+		std::vector<float3> positions, normals;
+		std::vector<std::array<float, 2>> texCoords;
+		std::vector<std::array<float, 4>> tangents;
+		std::vector<uint32_t> indices;
+		int materialIndex = -1;
+	};
+
+	//18 bytes, no padding, hashed and compared as raw memory for dedup
+	struct QuantizedVertex
+	{
+		uint16_t position[3];
+		int16_t normal[2];
+		uint16_t texCoord[2];
+		int8_t tangent[4];
+
+		bool operator==(const QuantizedVertex& o) const { return memcmp(this, &o, sizeof(QuantizedVertex)) == 0; }
+	};
+	static_assert(sizeof(QuantizedVertex) == 18, "QuantizedVertex must be tightly packed");
+
+	struct QuantizedVertexHash
+	{
+		size_t operator()(const QuantizedVertex& v) const { return size_t(Cooked::Hash(&v, sizeof(v))); }
+	};
+
+	//reads any float or normalized integer accessor into floats, honouring byteStride
+	bool ReadAccessor(const tinygltf::Model& model, int accessorIdx, int components, std::vector<float>& out)
+	{
+		if (accessorIdx < 0 || accessorIdx >= (int)model.accessors.size()) return false;
+		const tinygltf::Accessor& accessor = model.accessors[accessorIdx];
+		if (accessor.bufferView < 0) return false;
+		const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+		const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+		int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+		size_t stride = accessor.ByteStride(bufferView);
+		if (componentSize <= 0 || stride == size_t(-1) || stride == 0 || accessor.count == 0) return false;
+
+		const unsigned char* base = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+		if (bufferView.byteOffset + accessor.byteOffset + stride * (accessor.count - 1) + componentSize * components > buffer.data.size()) return false;
+
+		out.resize(accessor.count * components);
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			const unsigned char* element = base + stride * i;
+			for (int c = 0; c < components; c++)
+			{
+				const unsigned char* p = element + componentSize * c;
+				float v = 0;
+				switch (accessor.componentType)
+				{
+				case TINYGLTF_COMPONENT_TYPE_FLOAT: memcpy(&v, p, sizeof(float)); break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: v = *p / 255.f; break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: { uint16_t s; memcpy(&s, p, 2); v = s / 65535.f; break; }
+				case TINYGLTF_COMPONENT_TYPE_BYTE: v = std::max(*(const int8_t*)p / 127.f, -1.f); break;
+				case TINYGLTF_COMPONENT_TYPE_SHORT: { int16_t s; memcpy(&s, p, 2); v = std::max(s / 32767.f, -1.f); break; }
+				default: return false;
+				}
+				out[i * components + c] = v;
+			}
+		}
+		return true;
+	}
+
+	bool ReadIndices(const tinygltf::Model& model, int accessorIdx, std::vector<uint32_t>& out)
+	{
+		const tinygltf::Accessor& accessor = model.accessors[accessorIdx];
+		if (accessor.bufferView < 0) return false;
+		const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+		const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+		const unsigned char* base = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+		size_t stride = accessor.ByteStride(bufferView);
+		if (stride == size_t(-1) || stride == 0) return false;
+
+		out.resize(accessor.count);
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			const unsigned char* p = base + stride * i;
+			switch (accessor.componentType)
+			{
+			case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: memcpy(&out[i], p, 4); break;
+			case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: { uint16_t s; memcpy(&s, p, 2); out[i] = s; break; }
+			case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: out[i] = *p; break;
+			default: return false;
+			}
+		}
+		return true;
+	}
+
+	//same per-triangle accumulation the renderer uses, but scoped to one primitive
+	void GenerateTangents(SourcePrimitive& prim)
+	{
+		size_t vCount = prim.positions.size();
+		std::vector<float3> tangent(vCount), biTangent(vCount);
+
+		for (size_t i = 0; i + 2 < prim.indices.size(); i += 3)
+		{
+			uint32_t i0 = prim.indices[i + 0], i1 = prim.indices[i + 1], i2 = prim.indices[i + 2];
+
+			float3 e1 = prim.positions[i1] - prim.positions[i0];
+			float3 e2 = prim.positions[i2] - prim.positions[i0];
+			float du1 = prim.texCoords[i1][0] - prim.texCoords[i0][0], dv1 = prim.texCoords[i1][1] - prim.texCoords[i0][1];
+			float du2 = prim.texCoords[i2][0] - prim.texCoords[i0][0], dv2 = prim.texCoords[i2][1] - prim.texCoords[i0][1];
+
+			float r = 1.f;
+			float a = du1 * dv2 - du2 * dv1;
+			if (fabs(a) > 0) r = 1.f / a; //catch degenerated UVs
+
+			float3 t = (e1 * dv2 - e2 * dv1) * r;
+			float3 b = (e2 * du1 - e1 * du2) * r;
+
+			for (uint32_t v : { i0, i1, i2 })
+			{
+				tangent[v] = tangent[v] + t;
+				biTangent[v] = biTangent[v] + b;
+			}
+		}
+
+		prim.tangents.resize(vCount);
+		for (size_t v = 0; v < vCount; v++)
+		{
+			const float3& n = prim.normals[v];
+			const float3& t = tangent[v];
+			float3 o = Normalize(t - n * Dot(n, t));
+
+			if (o.x == 0 && o.y == 0 && o.z == 0) //if tangent invalid
+			{
+				if (fabsf(n.x) > fabsf(n.y)) o = float3{ n.z, 0, -n.x } * (1 / sqrtf(n.x * n.x + n.z * n.z));
+				else o = float3{ 0, -n.z, n.y } * (1 / sqrtf(n.y * n.y + n.z * n.z));
+			}
+
+			float handedness = Dot(Cross(n, t), biTangent[v]) < 0.f ? 1.f : -1.f;
+			prim.tangents[v] = { o.x, o.y, o.z, handedness };
+		}
+	}
+
+	bool ImportPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& gltfPrim, SourcePrimitive& prim, std::string& error)
+	{
+		if (gltfPrim.mode != -1 && gltfPrim.mode != TINYGLTF_MODE_TRIANGLES)
+		{
+			error = "only triangle lists are supported";
+			return false;
+		}
+
+		auto attribute = [&](const char* name) { auto it = gltfPrim.attributes.find(name); return it == gltfPrim.attributes.end() ? -1 : it->second; };
+
+		std::vector<float> data;
+		if (!ReadAccessor(model, attribute("POSITION"), 3, data))
+		{
+			error = "missing or unreadable POSITION";
+			return false;
+		}
+		size_t vCount = data.size() / 3;
+		prim.positions.resize(vCount);
+		memcpy(prim.positions.data(), data.data(), data.size() * sizeof(float));
+
+		prim.normals.assign(vCount, float3{ 0, 0, 1 });
+		if (ReadAccessor(model, attribute("NORMAL"), 3, data) && data.size() == vCount * 3)
+			memcpy(prim.normals.data(), data.data(), data.size() * sizeof(float));
+
+		prim.texCoords.assign(vCount, { 0, 0 });
+		if (ReadAccessor(model, attribute("TEXCOORD_0"), 2, data) && data.size() == vCount * 2)
+			memcpy(prim.texCoords.data(), data.data(), data.size() * sizeof(float));
+
+		if (gltfPrim.indices >= 0)
+		{
+			if (!ReadIndices(model, gltfPrim.indices, prim.indices))
+			{
+				error = "unreadable indices";
+				return false;
+			}
+		}
+		else
+		{
+			prim.indices.resize(vCount);
+			for (uint32_t i = 0; i < vCount; i++) prim.indices[i] = i;
+		}
+
+		for (uint32_t i : prim.indices)
+		{
+			if (i >= vCount)
+			{
+				error = "index out of range";
+				return false;
+			}
+		}
+
+		if (ReadAccessor(model, attribute("TANGENT"), 4, data) && data.size() == vCount * 4)
+		{
+			prim.tangents.resize(vCount);
+			memcpy(prim.tangents.data(), data.data(), data.size() * sizeof(float));
+		}
+		else GenerateTangents(prim);
+
+		prim.materialIndex = gltfPrim.material;
+		return true;
+	}
+
+	//Tom Forsyth's linear-speed vertex cache optimisation
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		constexpr int cacheSize = 32;
+		size_t triCount = indices.size() / 3;
+		if (triCount == 0) return;
+
+		auto vertexScore = [](int cachePos, uint32_t valence)
+			{
+				if (valence == 0) return -1.f;
+				float score = 0;
+				if (cachePos >= 0)
+				{
+					if (cachePos < 3) score = .75f;
+					else score = powf(1.f - float(cachePos - 3) / float(cacheSize - 3), 1.5f);
+				}
+				return score + 2.f * powf(float(valence), -.5f);
+			};
+
+		std::vector<uint32_t> valence(vertexCount, 0), adjacencyOffset(vertexCount + 1, 0), adjacency(indices.size());
+		for (uint32_t i : indices) valence[i]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+		{
+			std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < triCount; t++)
+				for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+		}
+
+		std::vector<int> cachePos(vertexCount, -1);
+		std::vector<float> vScore(vertexCount), tScore(triCount, 0);
+		std::vector<bool> emitted(triCount, false);
+		for (size_t v = 0; v < vertexCount; v++) vScore[v] = vertexScore(-1, valence[v]);
+		for (size_t t = 0; t < triCount; t++)
+			for (int k = 0; k < 3; k++) tScore[t] += vScore[indices[t * 3 + k]];
+
+		std::vector<uint32_t> cache, nextCache, result;
+		result.reserve(indices.size());
+		size_t scanCursor = 0;
+		int64_t best = -1;
+
+		for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++)
+		{
+			if (best < 0)
+			{
+				while (emitted[scanCursor]) scanCursor++;
+				best = int64_t(scanCursor);
+			}
+
+			uint32_t tri = uint32_t(best);
+			emitted[tri] = true;
+			nextCache.clear();
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[tri * 3 + k];
+				result.push_back(v);
+				nextCache.push_back(v);
+
+				//remove the triangle from this vertex's live adjacency
+				uint32_t* begin = &adjacency[adjacencyOffset[v]];
+				uint32_t* end = begin + valence[v];
+				*std::find(begin, end, tri) = *(end - 1);
+				valence[v]--;
+			}
+			for (uint32_t v : cache)
+				if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2]) nextCache.push_back(v);
+
+			for (uint32_t v : cache) cachePos[v] = -1;
+			for (size_t i = 0; i < nextCache.size(); i++)
+			{
+				uint32_t v = nextCache[i];
+				cachePos[v] = i < cacheSize ? int(i) : -1;
+				float newScore = vertexScore(cachePos[v], valence[v]);
+				float delta = newScore - vScore[v];
+				vScore[v] = newScore;
+				for (uint32_t a = 0; a < valence[v]; a++) tScore[adjacency[adjacencyOffset[v] + a]] += delta;
+			}
+			if (nextCache.size() > cacheSize) nextCache.resize(cacheSize);
+			std::swap(cache, nextCache);
+
+			best = -1;
+			float bestScore = -1;
+			for (uint32_t v : cache)
+			{
+				for (uint32_t a = 0; a < valence[v]; a++)
+				{
+					uint32_t t = adjacency[adjacencyOffset[v] + a];
+					if (tScore[t] > bestScore)
+					{
+						bestScore = tScore[t];
+						best = t;
+					}
+				}
+			}
+		}
+
+		indices.swap(result);
+	}
+}
+
+bool CookMesh(const tinygltf::Model& model, Cooked::MeshData& out, std::string& error)
+{
+	//import every primitive once, nodes that share a mesh share its primitives
+	std::vector<SourcePrimitive> sources;
+	std::vector<std::vector<int>> meshPrimitives(model.meshes.size());
+
+	for (size_t m = 0; m < model.meshes.size(); m++)
+	{
+		for (auto& gltfPrim : model.meshes[m].primitives)
+		{
+			SourcePrimitive prim;
+			std::string primError;
+			if (!ImportPrimitive(model, gltfPrim, prim, primError))
+			{
+				std::cout << "Warning: skipping primitive of mesh '" << model.meshes[m].name << "': " << primError << '\n';
+				meshPrimitives[m].push_back(-1);
+				continue;
+			}
+			meshPrimitives[m].push_back((int)sources.size());
+			sources.push_back(std::move(prim));
+		}
+	}
+
+	if (sources.empty())
+	{
+		error = "no drawable primitives";
+		return false;
+	}
+
+	float3 min = { FLT_MAX, FLT_MAX, FLT_MAX }, max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (auto& prim : sources)
+	{
+		for (auto& p : prim.positions)
+		{
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+	}
+
+	Cooked::MeshHeader& header = out.header;
+	header = Cooked::MeshHeader();
+	header.posMin[0] = min.x; header.posMin[1] = min.y; header.posMin[2] = min.z;
+	header.posScale[0] = (max.x - min.x) / 65535.f;
+	header.posScale[1] = (max.y - min.y) / 65535.f;
+	header.posScale[2] = (max.z - min.z) / 65535.f;
+
+	auto quantizePos = [&](float v, int axis)
+		{
+			float scale = header.posScale[axis];
+			return scale > 0 ? uint16_t(std::lround(std::clamp((v - header.posMin[axis]) / scale, 0.f, 65535.f))) : uint16_t(0);
+		};
+
+	for (auto& prim : sources)
+	{
+		//quantize and weld identical vertices
+		std::unordered_map<QuantizedVertex, uint32_t, QuantizedVertexHash> unique;
+		std::vector<QuantizedVertex> vertices;
+		std::vector<uint32_t> remap(prim.positions.size());
+
+		for (size_t v = 0; v < prim.positions.size(); v++)
+		{
+			QuantizedVertex q;
+			q.position[0] = quantizePos(prim.positions[v].x, 0);
+			q.position[1] = quantizePos(prim.positions[v].y, 1);
+			q.position[2] = quantizePos(prim.positions[v].z, 2);
+			float3 n = Normalize(prim.normals[v]);
+			float nrm[3] = { n.x, n.y, n.z };
+			Cooked::OctEncode(nrm, q.normal);
+			q.texCoord[0] = Cooked::FloatToHalf(prim.texCoords[v][0]);
+			q.texCoord[1] = Cooked::FloatToHalf(prim.texCoords[v][1]);
+			for (int k = 0; k < 4; k++) q.tangent[k] = Cooked::ToSnorm8(prim.tangents[v][k]);
+
+			auto [it, inserted] = unique.try_emplace(q, (uint32_t)vertices.size());
+			if (inserted) vertices.push_back(q);
+			remap[v] = it->second;
+		}
+
+		std::vector<uint32_t> indices(prim.indices.size());
+		for (size_t i = 0; i < indices.size(); i++) indices[i] = remap[prim.indices[i]];
+
+		OptimizeVertexCache(indices, vertices.size());
+
+		//reorder vertices by first use so fetches walk memory linearly
+		std::vector<uint32_t> fetchRemap(vertices.size(), UINT32_MAX);
+		uint32_t next = 0;
+		for (uint32_t& i : indices)
+		{
+			if (fetchRemap[i] == UINT32_MAX) fetchRemap[i] = next++;
+			i = fetchRemap[i];
+		}
+		std::vector<QuantizedVertex> ordered(next);
+		for (size_t v = 0; v < vertices.size(); v++)
+			if (fetchRemap[v] != UINT32_MAX) ordered[fetchRemap[v]] = vertices[v];
+
+		Cooked::Primitive cookedPrim;
+		cookedPrim.firstIndex = (uint32_t)out.indices.size();
+		cookedPrim.indexCount = (uint32_t)indices.size();
+		cookedPrim.vertexOffset = (uint32_t)(out.positions.size() / 3);
+		cookedPrim.vertexCount = (uint32_t)ordered.size();
+		cookedPrim.materialIndex = prim.materialIndex;
+		out.primitives.push_back(cookedPrim);
+
+		for (auto& q : ordered)
+		{
+			out.positions.insert(out.positions.end(), q.position, q.position + 3);
+			out.normals.insert(out.normals.end(), q.normal, q.normal + 2);
+			out.texCoords.insert(out.texCoords.end(), q.texCoord, q.texCoord + 2);
+			out.tangents.insert(out.tangents.end(), q.tangent, q.tangent + 4);
+		}
+		out.indices.insert(out.indices.end(), indices.begin(), indices.end());
+	}
+
+	//flat node walk, matching how the renderer places gltf nodes
+	for (auto& node : model.nodes)
+	{
+		if (node.mesh < 0 || node.mesh >= (int)model.meshes.size()) continue;
+
+		for (int primIdx : meshPrimitives[node.mesh])
+		{
+			if (primIdx < 0) continue;
+
+			Cooked::Draw draw;
+			draw.primitive = (uint32_t)primIdx;
+			if (node.translation.size() == 3) for (int k = 0; k < 3; k++) draw.translation[k] = (float)node.translation[k];
+			if (node.rotation.size() == 4) for (int k = 0; k < 4; k++) draw.rotation[k] = (float)node.rotation[k];
+			if (node.scale.size() == 3) for (int k = 0; k < 3; k++) draw.scale[k] = (float)node.scale[k];
+			out.draws.push_back(draw);
+		}
+	}
+
+	header.vertexCount = (uint32_t)(out.positions.size() / 3);
+	header.indexCount = (uint32_t)out.indices.size();
+	header.primitiveCount = (uint32_t)out.primitives.size();
+	header.drawCount = (uint32_t)out.draws.size();
+	return true;
+}
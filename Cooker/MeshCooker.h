@@ -0,0 +1,6 @@
+#pragma once
+#include "../CookedFormat.h"
+#include "../tinygltf/tiny_gltf.h"
+
+//import -> tangent generation -> quantization -> vertex dedup -> vertex cache/fetch optimization
+bool CookMesh(const tinygltf::Model& model, Cooked::MeshData& out, std::string& error);
@@ -0,0 +1,25 @@
+#pragma once
+#include <iostream>
+
+//the CPU-only tests' one assertion, a failure is reported and the test keeps going so every broken check shows up
+namespace Test
+{
+	inline int failures = 0;
+
+	//exit code for main
+	inline int Result()
+	{
+		if (failures) std::cout << "Error: " << failures << " checks failed\n";
+		return failures ? 1 : 0;
+	}
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cout << "Error: " << __FILE__ << ':' << __LINE__ << " CHECK(" #condition ") failed\n"; \
+			Test::failures++; \
+		} \
+	} while (0)
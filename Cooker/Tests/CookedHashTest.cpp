@@ -0,0 +1,33 @@
+#include "Check.h"
+#include "../../CookedFormat.h"
+
+namespace
+{
+	uint64_t Hash(const std::string& text, uint64_t hash = 0xcbf29ce484222325ull) { return Cooked::Hash(text.data(), text.size(), hash); }
+
+	//published 64-bit FNV-1a vectors, the cook and shader manifests on disk depend on these staying put
+	void ReferenceValues()
+	{
+		CHECK(Hash("") == 0xcbf29ce484222325ull);
+		CHECK(Hash("a") == 0xaf63dc4c8601ec8cull);
+		CHECK(Hash("foobar") == 0x85944171f73967e8ull);
+	}
+
+	void Chaining()
+	{
+		//hashing in pieces is hashing the whole, ShaderCompiler chains the source and each include like this
+		CHECK(Hash("bar", Hash("foo")) == Hash("foobar"));
+		CHECK(Hash("b", Hash("")) == Hash("b"));
+
+		//define sets ShaderCompiler names spvs after, joined with a separator so splitting them differently doesn't collide
+		CHECK(Hash("A=1\nB=2\n") != Hash("A=1B\n=2\n"));
+		CHECK(Hash("MAX_LIGHTS=16\n") != Hash("MAX_LIGHTS=32\n"));
+	}
+}
+
+int main()
+{
+	ReferenceValues();
+	Chaining();
+	return Test::Result();
+}
@@ -0,0 +1,206 @@
+#include "Check.h"
+#include "../../FrameGraphCompiler.h"
+
+namespace
+{
+	auto asyncCompute = [](QueueType type) { return type; };
+	auto graphicsOnly = [](QueueType) { return QueueType::GRAPHICS; };
+
+	//what FrameGraph keeps between compiles, without the vulkan state
+	struct Graph
+	{
+		std::vector<FrameGraphNodeInfo> nodes;
+		std::vector<std::string> sinks;
+		std::vector<size_t> schedule;
+		std::set<std::string> history;
+		size_t mergeCount = 0;
+
+		FrameGraphNodeInfo& Add(const std::string& name, std::vector<std::string> inputs, std::vector<std::string> outputs, QueueType queue = QueueType::GRAPHICS)
+		{
+			FrameGraphNodeInfo& node = nodes.emplace_back();
+			node.name = name;
+			node.shouldExecute = true;
+			node.inputResources = inputs;
+			node.outputResources = outputs;
+			node.queue = queue;
+			return node;
+		}
+
+		template <typename Resolve>
+		bool Compile(bool mergeSubpasses, Resolve resolve)
+		{
+			return FrameGraphCompiler::Compile(nodes, sinks, mergeSubpasses, resolve, schedule, history, mergeCount);
+		}
+	};
+
+	void KahnOrder()
+	{
+		Graph graph;
+		graph.Add("composite", { "a", "b" }, { "final" });
+		graph.Add("a", {}, { "a" });
+		graph.Add("b", {}, { "b" });
+		graph.Add("d", { "a" }, { "d" });
+		graph.sinks = { "final", "d" };
+
+		//producers before consumers, ready nodes in the order they were added
+		CHECK(graph.Compile(false, asyncCompute));
+		CHECK((graph.schedule == std::vector<size_t>{ 1, 2, 0, 3 }));
+		CHECK(graph.history.empty());
+	}
+
+	void Culling()
+	{
+		Graph graph;
+		graph.Add("unused", {}, { "debug" });
+		graph.Add("disabled", {}, { "off" }).shouldExecute = false;
+		graph.Add("previous", {}, { "h" });
+		graph.Add("temporal", {}, { "final" }).historyResources = { "h" };
+		graph.sinks = { "final" };
+
+		//history keeps its producer alive without ordering it first
+		CHECK(graph.Compile(false, asyncCompute));
+		CHECK((graph.schedule == std::vector<size_t>{ 2, 3 }));
+		CHECK((graph.history == std::set<std::string>{ "h" }));
+
+		//without sinks nothing enabled is culled
+		graph.sinks.clear();
+		CHECK(graph.Compile(false, asyncCompute));
+		CHECK((graph.schedule == std::vector<size_t>{ 0, 2, 3 }));
+	}
+
+	void Failures()
+	{
+		Graph cycle;
+		cycle.Add("x", { "y" }, { "x" });
+		cycle.Add("y", { "x" }, { "y" });
+		cycle.Add("sink", { "x" }, { "final" });
+		cycle.sinks = { "final" };
+		CHECK(!cycle.Compile(false, asyncCompute));
+		CHECK(cycle.schedule.empty());
+
+		//a disabled producer leaves its output missing
+		Graph missing;
+		missing.Add("producer", {}, { "a" }).shouldExecute = false;
+		missing.Add("consumer", { "a" }, { "final" });
+		missing.sinks = { "final" };
+		CHECK(!missing.Compile(false, asyncCompute));
+		CHECK(missing.schedule.empty());
+
+		missing.sinks = { "nothing" };
+		CHECK(!missing.Compile(false, asyncCompute));
+
+		Graph twice;
+		twice.Add("first", {}, { "a" });
+		twice.Add("second", {}, { "a" });
+		twice.sinks = { "a" };
+		CHECK(!twice.Compile(false, asyncCompute));
+	}
+
+	//gbuffer -> shadow -> lighting reading the gbuffer at its own pixel and the shadow map sampled
+	Graph Deferred(QueueType shadowQueue)
+	{
+		Graph graph;
+		graph.Add("gbuffer", {}, { "albedo" }).access["albedo"] = ResourceAccess::COLOR_WRITE;
+		graph.Add("shadow", {}, { "shadow" }, shadowQueue);
+		FrameGraphNodeInfo& lighting = graph.Add("lighting", { "albedo", "shadow" }, { "lit" });
+		lighting.access["albedo"] = ResourceAccess::INPUT_READ;
+		lighting.access["shadow"] = ResourceAccess::SAMPLED_READ;
+		graph.sinks = { "lit" };
+		return graph;
+	}
+
+	void Merging()
+	{
+		Graph graph = Deferred(QueueType::GRAPHICS);
+		CHECK(graph.Compile(false, asyncCompute));
+		CHECK((graph.schedule == std::vector<size_t>{ 0, 1, 2 }));
+		CHECK(graph.mergeCount == 0);
+
+		//the producer moves up to its consumer and begins the shared render pass
+		CHECK(graph.Compile(true, asyncCompute));
+		CHECK((graph.schedule == std::vector<size_t>{ 1, 0, 2 }));
+		CHECK(graph.mergeCount == 1);
+		CHECK(graph.nodes[0].mergedWith == 2 && graph.nodes[0].subpass == 0);
+		CHECK(graph.nodes[2].mergedWith == 0 && graph.nodes[2].subpass == 1);
+		CHECK(graph.nodes[1].mergedWith == FrameGraphNodeInfo::NOT_MERGED);
+
+		//a recompile starts over
+		CHECK(graph.Compile(false, asyncCompute));
+		CHECK(graph.nodes[2].mergedWith == FrameGraphNodeInfo::NOT_MERGED && graph.nodes[2].subpass == 0);
+
+		//sampled reads don't need the producer's render pass
+		graph.nodes[2].access["albedo"] = ResourceAccess::SAMPLED_READ;
+		CHECK(graph.Compile(true, asyncCompute));
+		CHECK(graph.mergeCount == 0);
+
+		//nothing in between may read what the producer writes
+		Graph blocked = Deferred(QueueType::GRAPHICS);
+		blocked.nodes[1].inputResources = { "albedo" };
+		CHECK(blocked.Compile(true, asyncCompute));
+		CHECK(blocked.mergeCount == 0);
+		CHECK((blocked.schedule == std::vector<size_t>{ 0, 1, 2 }));
+	}
+
+	void CrossQueue()
+	{
+		//an input from async compute keeps the consumer out of the producer's render pass
+		Graph graph = Deferred(QueueType::COMPUTE);
+		CHECK(graph.Compile(true, asyncCompute));
+		CHECK(graph.mergeCount == 0);
+		CHECK(graph.nodes[2].mergedWith == FrameGraphNodeInfo::NOT_MERGED);
+		CHECK((graph.schedule == std::vector<size_t>{ 0, 1, 2 }));
+
+		//without a compute queue it runs on graphics and merging goes ahead
+		CHECK(graph.Compile(true, graphicsOnly));
+		CHECK(graph.mergeCount == 1);
+		CHECK(graph.nodes[2].mergedWith == 0);
+
+		//a compute consumer is never merged
+		Graph compute = Deferred(QueueType::GRAPHICS);
+		compute.nodes[2].queue = QueueType::COMPUTE;
+		CHECK(compute.Compile(true, asyncCompute));
+		CHECK(compute.mergeCount == 0);
+	}
+
+	void Versions()
+	{
+		using FrameGraphCompiler::VersionIndex;
+
+		//single resources are their own history
+		for (unsigned long long frame = 0; frame < 4; frame++)
+		{
+			CHECK(VersionIndex(frame, 1, 0) == 0);
+			CHECK(VersionIndex(frame, 1, -1) == 0);
+			CHECK(VersionIndex(frame, 1, 5) == 0);
+		}
+
+		//the history of frame 0 is the last copy, nothing wrote it yet so it's whatever the copies were filled with
+		CHECK(VersionIndex(0, 3, 0) == 0);
+		CHECK(VersionIndex(0, 3, -1) == 2);
+		CHECK(VersionIndex(0, 2, -1) == 1);
+
+		//each frame's history is the copy the frame before wrote, and every copy is filled once by offsets 0 to count - 1
+		for (unsigned long long frame = 1; frame < 10; frame++)
+		{
+			CHECK(VersionIndex(frame, 3, -1) == VersionIndex(frame - 1, 3, 0));
+			CHECK(VersionIndex(frame, 3, 0) == frame % 3);
+		}
+		CHECK((std::set<size_t>{ VersionIndex(4, 3, 0), VersionIndex(4, 3, 1), VersionIndex(4, 3, 2) }.size() == 3));
+
+		//offsets further than the copies wrap, in either direction
+		CHECK(VersionIndex(1, 3, -4) == 0);
+		CHECK(VersionIndex(1, 3, 5) == 0);
+		CHECK(VersionIndex(~0ull, 3, 1) == (~0ull % 3 + 1) % 3);
+	}
+}
+
+int main()
+{
+	KahnOrder();
+	Culling();
+	Failures();
+	Merging();
+	CrossQueue();
+	Versions();
+	return Test::Result();
+}
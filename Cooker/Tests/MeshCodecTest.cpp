@@ -0,0 +1,105 @@
+#include "Check.h"
+#include "../../MeshCodec.h"
+#include <random>
+
+namespace
+{
+	//a smooth random walk per component, the shape quantized vertex attributes have
+	std::vector<uint8_t> MakeVertices(uint32_t count, uint32_t elementSize, uint32_t componentSize, std::mt19937& rng)
+	{
+		std::vector<uint8_t> data(size_t(count) * elementSize);
+		uint32_t componentCount = elementSize / componentSize;
+		std::vector<int> walk(componentCount, 1000);
+		for (uint32_t i = 0; i < count; i++)
+			for (uint32_t c = 0; c < componentCount; c++)
+			{
+				//now and then a jump so every group width is used
+				walk[c] += rng() % 64 == 0 ? int(rng() % 60000) : int(rng() % 17) - 8;
+				uint16_t v = uint16_t(walk[c]);
+				memcpy(&data[size_t(i) * elementSize + c * componentSize], &v, componentSize);
+			}
+		return data;
+	}
+
+	//every layout the cooked format uses, at counts around the group, tile and block edges, into aligned and unaligned output
+	void VertexRoundtrip()
+	{
+		const uint32_t layouts[][2] = { { 6, 2 }, { 4, 2 }, { 4, 1 }, { 3, 1 }, { 8, 2 } };
+		const uint32_t counts[] = { 0, 1, 15, 16, 17, 255, 256, 257, MeshCodec::VERTEX_BLOCK_ELEMENTS, MeshCodec::VERTEX_BLOCK_ELEMENTS + 1, 3 * MeshCodec::VERTEX_BLOCK_ELEMENTS + 100 };
+		std::mt19937 rng(1);
+
+		for (auto& layout : layouts)
+			for (uint32_t count : counts)
+			{
+				std::vector<uint8_t> source = MakeVertices(count, layout[0], layout[1], rng);
+				std::vector<uint8_t> encoded;
+				MeshCodec::EncodeVertexStream(source.data(), count, layout[0], layout[1], encoded);
+
+				for (size_t misalign = 0; misalign < 2; misalign++)
+				{
+					std::vector<uint8_t> decoded(source.size() + misalign);
+					const uint8_t* end = MeshCodec::DecodeVertexStream(encoded.data(), encoded.data() + encoded.size(), decoded.data() + misalign, count, layout[0]);
+					CHECK(end == encoded.data() + encoded.size());
+					CHECK(std::equal(source.begin(), source.end(), decoded.begin() + misalign));
+				}
+			}
+	}
+
+	void IndexRoundtrip()
+	{
+		const uint32_t counts[] = { 0, 1, 3, MeshCodec::INDEX_BLOCK_ELEMENTS, 2 * MeshCodec::INDEX_BLOCK_ELEMENTS + 7 };
+		std::mt19937 rng(2);
+
+		for (uint32_t count : counts)
+		{
+			std::vector<uint32_t> source(count);
+			for (auto& index : source) index = rng() % 8 ? rng() % 1000 : rng();
+			std::vector<uint8_t> encoded;
+			MeshCodec::EncodeIndexStream(source.data(), count, encoded);
+
+			std::vector<uint32_t> decoded(count);
+			CHECK(MeshCodec::DecodeIndexStream(encoded.data(), encoded.data() + encoded.size(), decoded.data(), count) == encoded.data() + encoded.size());
+			CHECK(decoded == source);
+		}
+	}
+
+	//truncated or mismatched streams are rejected rather than read past
+	void Malformed()
+	{
+		std::mt19937 rng(3);
+		const uint32_t count = MeshCodec::VERTEX_BLOCK_ELEMENTS + 500;
+		std::vector<uint8_t> source = MakeVertices(count, 6, 2, rng);
+		std::vector<uint8_t> encoded;
+		MeshCodec::EncodeVertexStream(source.data(), count, 6, 2, encoded);
+		std::vector<uint8_t> decoded(source.size());
+
+		CHECK(!MeshCodec::DecodeVertexStream(encoded.data(), encoded.data() + encoded.size(), decoded.data(), count + 1, 6));
+		CHECK(!MeshCodec::DecodeVertexStream(encoded.data(), encoded.data() + encoded.size(), decoded.data(), count, 4));
+		for (size_t cut : { size_t(0), size_t(8), encoded.size() / 2, encoded.size() - 1 })
+		{
+			std::vector<uint8_t> truncated(encoded.begin(), encoded.begin() + cut);
+			CHECK(!MeshCodec::DecodeVertexStream(truncated.data(), truncated.data() + truncated.size(), decoded.data(), count, 6));
+		}
+
+		//a block count that doesn't match the element count
+		std::vector<uint8_t> wrongBlocks = encoded;
+		MeshCodec::StreamHeader header;
+		memcpy(&header, wrongBlocks.data(), sizeof(header));
+		header.blockCount = 1;
+		memcpy(wrongBlocks.data(), &header, sizeof(header));
+		CHECK(!MeshCodec::DecodeVertexStream(wrongBlocks.data(), wrongBlocks.data() + wrongBlocks.size(), decoded.data(), count, 6));
+
+		std::vector<uint32_t> indices(1000, 5);
+		std::vector<uint8_t> encodedIndices;
+		MeshCodec::EncodeIndexStream(indices.data(), 1000, encodedIndices);
+		CHECK(!MeshCodec::DecodeIndexStream(encodedIndices.data(), encodedIndices.data() + encodedIndices.size() - 1, indices.data(), 1000));
+	}
+}
+
+int main()
+{
+	VertexRoundtrip();
+	IndexRoundtrip();
+	Malformed();
+	return Test::Result();
+}
@@ -0,0 +1,110 @@
+#include "Check.h"
+#include "../../RangeAllocator.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	void FirstFitAndMerge()
+	{
+		RangeAllocator allocator;
+		allocator.Reset(100);
+
+		uint32_t a, b, c;
+		CHECK(allocator.Allocate(10, a) && a == 0);
+		CHECK(allocator.Allocate(20, b) && b == 10);
+		CHECK(allocator.Allocate(30, c) && c == 30);
+		CHECK(allocator.GetUsed() == 60);
+		CHECK(allocator.GetLargestFree() == 40);
+
+		//a hole at the front is reused before the tail
+		allocator.Release(a, 10);
+		uint32_t d;
+		CHECK(allocator.Allocate(5, d) && d == 0);
+		CHECK(allocator.GetFreeRangeCount() == 2);
+
+		//releasing the middle merges with both neighbours back into one range
+		allocator.Release(d, 5);
+		allocator.Release(c, 30);
+		CHECK(allocator.GetFreeRangeCount() == 2);
+		allocator.Release(b, 20);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+		CHECK(allocator.GetUsed() == 0);
+		CHECK(allocator.GetLargestFree() == 100);
+	}
+
+	void Limits()
+	{
+		RangeAllocator allocator;
+		allocator.Reset(64);
+
+		uint32_t offset;
+		CHECK(!allocator.Allocate(0, offset));
+		CHECK(!allocator.Allocate(65, offset));
+		CHECK(allocator.Allocate(64, offset) && offset == 0);
+		CHECK(!allocator.Allocate(1, offset));
+		allocator.Release(0, 64);
+
+		//compaction only takes ranges that start below the block being moved
+		uint32_t low, high;
+		CHECK(allocator.Allocate(16, low) && allocator.Allocate(16, high) && high == 16);
+		allocator.Release(low, 16);
+		CHECK(!allocator.Allocate(8, offset, 0));
+		CHECK(allocator.Allocate(8, offset, high) && offset == 0);
+
+		RangeAllocator empty;
+		empty.Reset(0);
+		CHECK(!empty.Allocate(1, offset));
+	}
+
+	//random allocations and releases against a per element map of what's taken
+	void MatchesReference()
+	{
+		const uint32_t capacity = 4096;
+		RangeAllocator allocator;
+		allocator.Reset(capacity);
+		std::vector<bool> taken(capacity, false);
+		std::vector<std::pair<uint32_t, uint32_t>> live;
+		std::mt19937 rng(7);
+
+		for (int step = 0; step < 20000; step++)
+		{
+			if (live.empty() || rng() % 3)
+			{
+				uint32_t count = 1 + rng() % 64, offset;
+				if (!allocator.Allocate(count, offset)) continue;
+
+				bool overlaps = offset + count > capacity;
+				for (uint32_t i = offset; i < offset + count && !overlaps; i++) overlaps = taken[i];
+				CHECK(!overlaps);
+				for (uint32_t i = offset; i < offset + count && i < capacity; i++) taken[i] = true;
+				live.push_back({ offset, count });
+			}
+			else
+			{
+				size_t pick = rng() % live.size();
+				auto [offset, count] = live[pick];
+				live[pick] = live.back();
+				live.pop_back();
+				allocator.Release(offset, count);
+				for (uint32_t i = offset; i < offset + count; i++) taken[i] = false;
+			}
+		}
+
+		uint32_t used = 0;
+		for (bool t : taken) used += t;
+		CHECK(allocator.GetUsed() == used);
+
+		for (auto [offset, count] : live) allocator.Release(offset, count);
+		CHECK(allocator.GetUsed() == 0);
+		CHECK(allocator.GetFreeRangeCount() == 1);
+	}
+}
+
+int main()
+{
+	FirstFitAndMerge();
+	Limits();
+	MatchesReference();
+	return Test::Result();
+}
@@ -0,0 +1,105 @@
+#include "Check.h"
+#include "../../TlsfAllocator.h"
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+	void AllocateAndFree()
+	{
+		TlsfAllocator allocator;
+		allocator.Reset(1 << 20);
+
+		CHECK(!allocator.Allocate(0, 1));
+		CHECK(!allocator.Allocate((1 << 20) + 1, 1));
+
+		TlsfAllocator::Node* a = allocator.Allocate(1000, 256);
+		TlsfAllocator::Node* b = allocator.Allocate(3000, 4096);
+		CHECK(a && b);
+		CHECK(a->offset % 256 == 0 && b->offset % 4096 == 0);
+		CHECK(a->offset + a->size <= b->offset || b->offset + b->size <= a->offset);
+		CHECK(allocator.GetUsed() == 4000 && allocator.GetAllocationCount() == 2);
+
+		//freed neighbours merge, so the whole block fits again
+		allocator.Free(a);
+		allocator.Free(b);
+		CHECK(allocator.IsEmpty() && allocator.GetUsed() == 0);
+		TlsfAllocator::Node* all = allocator.Allocate(1 << 20, 1);
+		CHECK(all && all->offset == 0);
+		CHECK(!allocator.Allocate(1, 1));
+		allocator.Free(all);
+	}
+
+	//a node is exactly the size asked for, whatever is left of its free range is split off
+	void ExactSizes()
+	{
+		TlsfAllocator allocator;
+		allocator.Reset(4096);
+		TlsfAllocator::Node* node = allocator.Allocate(4096, 1);
+		CHECK(node && node->size == 4096);
+		allocator.Free(node);
+
+		for (uint64_t size : { 1ull, 15ull, 16ull, 17ull, 1000ull, 4095ull })
+		{
+			TlsfAllocator::Node* fit = allocator.Allocate(size, 1);
+			CHECK(fit && fit->size == size);
+			if (fit) allocator.Free(fit);
+		}
+	}
+
+	//random allocations and frees against the list of live ranges, none may overlap or leave the block
+	void MatchesReference()
+	{
+		const uint64_t size = 1 << 24;
+		TlsfAllocator allocator;
+		allocator.Reset(size);
+		std::vector<TlsfAllocator::Node*> live;
+		std::map<uint64_t, uint64_t> ranges; //offset -> size
+		std::mt19937 rng(11);
+		uint64_t used = 0;
+
+		for (int step = 0; step < 50000; step++)
+		{
+			if (live.empty() || rng() % 5 < 3)
+			{
+				uint64_t request = 1 + rng() % (rng() % 8 ? 4096 : 1 << 18);
+				uint64_t alignment = uint64_t(1) << (rng() % 13);
+				TlsfAllocator::Node* node = allocator.Allocate(request, alignment);
+				if (!node) continue;
+
+				CHECK(node->size == request && node->offset % alignment == 0 && node->offset + node->size <= size);
+				auto next = ranges.lower_bound(node->offset);
+				CHECK(next == ranges.end() || node->offset + node->size <= next->first);
+				CHECK(next == ranges.begin() || std::prev(next)->first + std::prev(next)->second <= node->offset);
+				ranges[node->offset] = node->size;
+				live.push_back(node);
+				used += request;
+			}
+			else
+			{
+				size_t pick = rng() % live.size();
+				TlsfAllocator::Node* node = live[pick];
+				live[pick] = live.back();
+				live.pop_back();
+				ranges.erase(node->offset);
+				used -= node->size;
+				allocator.Free(node);
+			}
+			CHECK(allocator.GetUsed() == used);
+		}
+
+		for (auto* node : live) allocator.Free(node);
+		CHECK(allocator.IsEmpty());
+		TlsfAllocator::Node* all = allocator.Allocate(size, 1);
+		CHECK(all && all->offset == 0);
+	}
+}
+
+int main()
+{
+	AllocateAndFree();
+	ExactSizes();
+	MatchesReference();
+	return Test::Result();
+}
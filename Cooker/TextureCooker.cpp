@@ -0,0 +1,216 @@
+#include "TextureCooker.h"
+
+namespace
+{
+	struct Rgba { uint8_t r, g, b, a; };
+
+	bool ToRgba8(const tinygltf::Image& image, std::vector<Rgba>& out, std::string& error)
+	{
+		if (image.width <= 0 || image.height <= 0 || image.image.empty())
+		{
+			error = "image has no decoded pixels";
+			return false;
+		}
+
+		int components = image.component;
+		int bytesPerComponent = image.bits == 16 ? 2 : image.bits == 32 ? 4 : 1;
+		size_t pixelCount = size_t(image.width) * image.height;
+		if (image.image.size() < pixelCount * components * bytesPerComponent)
+		{
+			error = "image data is truncated";
+			return false;
+		}
+
+		auto fetch = [&](size_t pixel, int c) -> uint8_t
+			{
+				const unsigned char* p = &image.image[(pixel * components + c) * bytesPerComponent];
+				if (bytesPerComponent == 1) return *p;
+				if (bytesPerComponent == 2) { uint16_t v; memcpy(&v, p, 2); return uint8_t(v >> 8); }
+				float f; memcpy(&f, p, 4); return uint8_t(std::lround(std::clamp(f, 0.f, 1.f) * 255.f));
+			};
+
+		out.resize(pixelCount);
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			uint8_t r = fetch(i, 0);
+			uint8_t g = components > 1 ? fetch(i, 1) : r;
+			uint8_t b = components > 2 ? fetch(i, 2) : (components > 1 ? 0 : r);
+			uint8_t a = components == 4 ? fetch(i, 3) : components == 2 ? g : 255;
+			out[i] = { r, g, b, a };
+		}
+		return true;
+	}
+
+	//2x2 box filter, odd edges clamp
+	std::vector<Rgba> Downsample(const std::vector<Rgba>& src, uint32_t w, uint32_t h, uint32_t& outW, uint32_t& outH)
+	{
+		outW = std::max(1u, w / 2);
+		outH = std::max(1u, h / 2);
+		std::vector<Rgba> dst(size_t(outW) * outH);
+
+		for (uint32_t y = 0; y < outH; y++)
+		{
+			uint32_t y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+			for (uint32_t x = 0; x < outW; x++)
+			{
+				uint32_t x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+				const Rgba& a = src[y0 * w + x0], & b = src[y0 * w + x1], & c = src[y1 * w + x0], & d = src[y1 * w + x1];
+				dst[y * outW + x] =
+				{
+					uint8_t((a.r + b.r + c.r + d.r + 2) / 4),
+					uint8_t((a.g + b.g + c.g + d.g + 2) / 4),
+					uint8_t((a.b + b.b + c.b + d.b + 2) / 4),
+					uint8_t((a.a + b.a + c.a + d.a + 2) / 4),
+				};
+			}
+		}
+		return dst;
+	}
+
+	inline uint16_t To565(int r, int g, int b) { return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255)); }
+	inline void From565(uint16_t c, int out[3])
+	{
+		out[0] = ((c >> 11) & 31) * 255 / 31;
+		out[1] = ((c >> 5) & 63) * 255 / 63;
+		out[2] = (c & 31) * 255 / 31;
+	}
+
+	//bounding box endpoints inset by 1/16, always 4-colour mode
+	void EncodeBC1Color(const Rgba block[16], uint8_t out[8])
+	{
+		int min[3] = { 255, 255, 255 }, max[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			const uint8_t c[3] = { block[i].r, block[i].g, block[i].b };
+			for (int k = 0; k < 3; k++) { min[k] = std::min<int>(min[k], c[k]); max[k] = std::max<int>(max[k], c[k]); }
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			int inset = (max[k] - min[k]) >> 4;
+			min[k] = std::min(255, min[k] + inset);
+			max[k] = std::max(0, max[k] - inset);
+		}
+
+		uint16_t c0 = To565(max[0], max[1], max[2]), c1 = To565(min[0], min[1], min[2]);
+		if (c0 < c1) std::swap(c0, c1);
+
+		int palette[4][3];
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		}
+
+		uint32_t selectors = 0;
+		if (c0 != c1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestDist = INT32_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = block[i].r - palette[p][0], dg = block[i].g - palette[p][1], db = block[i].b - palette[p][2];
+					int dist = dr * dr + dg * dg + db * db;
+					if (dist < bestDist) { bestDist = dist; best = p; }
+				}
+				selectors |= uint32_t(best) << (i * 2);
+			}
+		}
+
+		memcpy(out + 0, &c0, 2);
+		memcpy(out + 2, &c1, 2);
+		memcpy(out + 4, &selectors, 4);
+	}
+
+	//8-interpolant alpha block
+	void EncodeBC3Alpha(const Rgba block[16], uint8_t out[8])
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++) { a0 = std::max<int>(a0, block[i].a); a1 = std::min<int>(a1, block[i].a); }
+
+		int palette[8] = { a0, a1 };
+		for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+		uint64_t selectors = 0;
+		if (a0 != a1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestDist = INT32_MAX;
+				for (int p = 0; p < 8; p++)
+				{
+					int dist = abs(block[i].a - palette[p]);
+					if (dist < bestDist) { bestDist = dist; best = p; }
+				}
+				selectors |= uint64_t(best) << (i * 3);
+			}
+		}
+
+		out[0] = uint8_t(a0);
+		out[1] = uint8_t(a1);
+		for (int k = 0; k < 6; k++) out[2 + k] = uint8_t(selectors >> (k * 8));
+	}
+
+	void Compress(const std::vector<Rgba>& pixels, uint32_t w, uint32_t h, Cooked::TextureFormat format, std::vector<uint8_t>& out)
+	{
+		uint32_t blocksX = (w + 3) / 4, blocksY = (h + 3) / 4;
+		size_t blockSize = format == Cooked::TextureFormat::BC1 ? 8 : 16;
+		size_t start = out.size();
+		out.resize(start + blocksX * blocksY * blockSize);
+
+		Rgba block[16];
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					uint32_t x = std::min(bx * 4 + (i & 3), w - 1), y = std::min(by * 4 + (i >> 2), h - 1);
+					block[i] = pixels[y * w + x];
+				}
+
+				uint8_t* dst = &out[start + (by * blocksX + bx) * blockSize];
+				if (format == Cooked::TextureFormat::BC3)
+				{
+					EncodeBC3Alpha(block, dst);
+					dst += 8;
+				}
+				EncodeBC1Color(block, dst);
+			}
+		}
+	}
+}
+
+bool CookTexture(const tinygltf::Image& image, Cooked::TextureData& out, std::string& error)
+{
+	std::vector<Rgba> pixels;
+	if (!ToRgba8(image, pixels, error)) return false;
+
+	bool opaque = std::all_of(pixels.begin(), pixels.end(), [](const Rgba& p) { return p.a == 255; });
+
+	out.header = Cooked::TextureHeader();
+	out.header.width = (uint32_t)image.width;
+	out.header.height = (uint32_t)image.height;
+	out.header.format = opaque ? Cooked::TextureFormat::BC1 : Cooked::TextureFormat::BC3;
+	//full chain down to 1x1
+	out.header.mipCount = static_cast<uint32_t>(floor(log2(std::max(image.width, image.height))) + 1);
+	out.mips.clear();
+	out.data.clear();
+
+	uint32_t w = out.header.width, h = out.header.height;
+	for (uint32_t level = 0; level < out.header.mipCount; level++)
+	{
+		if (level > 0) pixels = Downsample(pixels, w, h, w, h);
+
+		Cooked::TextureMip mip;
+		mip.width = w;
+		mip.height = h;
+		mip.byteOffset = (uint32_t)out.data.size();
+		Compress(pixels, w, h, out.header.format, out.data);
+		mip.byteSize = (uint32_t)(out.data.size() - mip.byteOffset);
+		out.mips.push_back(mip);
+	}
+	return true;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "../CookedFormat.h"
+#include "../tinygltf/tiny_gltf.h"
+
+//rgba8 conversion -> box filtered mip chain -> BC1 (opaque) or BC3 (alpha) compression
+bool CookTexture(const tinygltf::Image& image, Cooked::TextureData& out, std::string& error);
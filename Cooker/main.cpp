@@ -0,0 +1,25 @@
+#include "Cooker.h"
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	CookerOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--models" && i + 1 < argc) options.modelsDir = argv[++i];
+		else if (arg == "--out" && i + 1 < argc) options.outputDir = argv[++i];
+		else if (arg == "--jobs" && i + 1 < argc) options.jobs = std::stoi(argv[++i]);
+		else if (arg == "--force") options.force = true;
+		else
+		{
+			std::cout << "Usage: Cooker [--models <dir>] [--out <dir>] [--jobs <n>] [--force]\n"
+				"Run from the repository root, cooks every .gltf/.glb under the models directory.\n";
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	Cooker cooker(options);
+	return cooker.Run();
+}
@@ -0,0 +1,345 @@
+#include "pch.h"
+
+namespace
+{
+	//descriptors per set a pool is sized for, by type
+	const std::vector<std::pair<VkDescriptorType, float>> POOL_RATIOS =
+	{
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+		{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.f},
+		{VK_DESCRIPTOR_TYPE_SAMPLER, 1.f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+		{VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1.f},
+	};
+
+	uint64_t HashBindings(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& bindingFlags, VkDescriptorSetLayoutCreateFlags flags)
+	{
+		uint64_t hash = Cooked::Hash(&flags, sizeof(flags));
+		for (auto& binding : bindings)
+		{
+			uint32_t fields[] = { binding.binding, (uint32_t)binding.descriptorType, binding.descriptorCount, binding.stageFlags };
+			hash = Cooked::Hash(fields, sizeof(fields), hash);
+		}
+		if (!bindingFlags.empty()) hash = Cooked::Hash(bindingFlags.data(), bindingFlags.size() * sizeof(VkDescriptorBindingFlags), hash);
+		return hash;
+	}
+
+	bool SameBindings(const std::vector<VkDescriptorSetLayoutBinding>& a, const std::vector<VkDescriptorSetLayoutBinding>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const VkDescriptorSetLayoutBinding& x, const VkDescriptorSetLayoutBinding& y)
+			{
+				return x.binding == y.binding && x.descriptorType == y.descriptorType && x.descriptorCount == y.descriptorCount && x.stageFlags == y.stageFlags;
+			});
+	}
+
+	//field by field, the structs' padding isn't guaranteed to be zeroed
+	uint64_t HashEntries(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries)
+	{
+		uint64_t hash = Cooked::Hash(&layout, sizeof(layout));
+		for (auto& entry : entries)
+		{
+			uint64_t fields[] = { entry.dstBinding, entry.dstArrayElement, entry.descriptorCount, (uint64_t)entry.descriptorType, entry.offset, entry.stride };
+			hash = Cooked::Hash(fields, sizeof(fields), hash);
+		}
+		return hash;
+	}
+
+	bool SameEntries(const std::vector<VkDescriptorUpdateTemplateEntry>& a, const std::vector<VkDescriptorUpdateTemplateEntry>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const VkDescriptorUpdateTemplateEntry& x, const VkDescriptorUpdateTemplateEntry& y)
+			{
+				return x.dstBinding == y.dstBinding && x.dstArrayElement == y.dstArrayElement && x.descriptorCount == y.descriptorCount &&
+					x.descriptorType == y.descriptorType && x.offset == y.offset && x.stride == y.stride;
+			});
+	}
+}
+
+void DescriptorLayoutCache::Destroy()
+{
+	for (auto& [hash, templates] : _templates)
+		for (auto& cached : templates) vkDestroyDescriptorUpdateTemplate(_device, cached.updateTemplate, nullptr);
+	_templates.clear();
+
+	for (auto& [hash, layouts] : _layouts)
+		for (auto& cached : layouts) vkDestroyDescriptorSetLayout(_device, cached.layout, nullptr);
+	_layouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::Get(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& bindingFlags, VkDescriptorSetLayoutCreateFlags flags)
+{
+	uint64_t hash = HashBindings(bindings, bindingFlags, flags);
+	for (auto& cached : _layouts[hash])
+		if (cached.flags == flags && cached.bindingFlags == bindingFlags && SameBindings(cached.bindings, bindings)) return cached.layout;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+	bindingFlagsCreateInfo.bindingCount = bindingFlags.size();
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	descriptorSetLayoutCreateInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsCreateInfo;
+	descriptorSetLayoutCreateInfo.flags = flags;
+	descriptorSetLayoutCreateInfo.bindingCount = bindings.size();
+	descriptorSetLayoutCreateInfo.pBindings = bindings.data();
+
+	CachedLayout cached = { bindings, bindingFlags, flags };
+	if (vkCreateDescriptorSetLayout(_device, &descriptorSetLayoutCreateInfo, nullptr, &cached.layout) != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to create a descriptor set layout with " << bindings.size() << " bindings\n";
+		return VK_NULL_HANDLE;
+	}
+
+	bool immutableSamplers = std::any_of(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& b) { return b.pImmutableSamplers != nullptr; });
+	if (!immutableSamplers) _layouts[hash].push_back(cached);
+	return cached.layout;
+}
+
+VkDescriptorUpdateTemplate DescriptorLayoutCache::GetUpdateTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries)
+{
+	//the same layout can be written from differently laid out structs, each gets its own template
+	uint64_t hash = HashEntries(layout, entries);
+	for (auto& cached : _templates[hash])
+		if (cached.layout == layout && SameEntries(cached.entries, entries)) return cached.updateTemplate;
+
+	VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+	templateCreateInfo.descriptorUpdateEntryCount = entries.size();
+	templateCreateInfo.pDescriptorUpdateEntries = entries.data();
+	templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateCreateInfo.descriptorSetLayout = layout;
+
+	VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+	if (vkCreateDescriptorUpdateTemplate(_device, &templateCreateInfo, nullptr, &updateTemplate) != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to create a descriptor update template\n";
+		return VK_NULL_HANDLE;
+	}
+
+	_templates[hash].push_back({ layout, entries, updateTemplate });
+	return updateTemplate;
+}
+
+size_t DescriptorLayoutCache::GetLayoutCount() const
+{
+	size_t count = 0;
+	for (auto& [hash, layouts] : _layouts) count += layouts.size();
+	return count;
+}
+
+bool DescriptorAllocator::Create(VkDevice device, unsigned int framesInFlight)
+{
+	_device = device;
+	_frames.resize(framesInFlight);
+	_frameSlot = 0;
+	return true;
+}
+
+void DescriptorAllocator::Destroy()
+{
+	if (!IsCreated()) return;
+
+	auto destroy = [this](FramePools& pools)
+		{
+			for (auto pool : pools.used) vkDestroyDescriptorPool(_device, pool, nullptr);
+			if (pools.current) vkDestroyDescriptorPool(_device, pools.current, nullptr);
+			pools = {};
+		};
+	destroy(_persistent);
+	for (auto& frame : _frames) destroy(frame);
+	for (auto pool : _freePools) vkDestroyDescriptorPool(_device, pool, nullptr);
+
+	_freePools.clear();
+	_frames.clear();
+	_nextPoolSets = INITIAL_POOL_SETS;
+	_poolCount = 0;
+	_device = VK_NULL_HANDLE;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool()
+{
+	std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
+	for (auto& [type, ratio] : POOL_RATIOS) descriptorPoolSizes.push_back({ type, uint32_t(ratio * _nextPoolSets) });
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	descriptorPoolCreateInfo.maxSets = _nextPoolSets;
+	descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(_device, &descriptorPoolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to create a descriptor pool for " << _nextPoolSets << " sets\n";
+		return VK_NULL_HANDLE;
+	}
+
+	//each new pool is bigger, a busy frame settles on a few large pools
+	_nextPoolSets = std::min(_nextPoolSets * 2, MAX_POOL_SETS);
+	_poolCount++;
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::GrabPool()
+{
+	if (_freePools.empty()) return CreatePool();
+
+	VkDescriptorPool pool = _freePools.back();
+	_freePools.pop_back();
+	return pool;
+}
+
+void DescriptorAllocator::BeginFrame(unsigned int frameSlot)
+{
+	_frameSlot = frameSlot;
+	FramePools& pools = _frames[_frameSlot];
+	if (pools.current) pools.used.push_back(pools.current);
+	for (auto pool : pools.used)
+	{
+		vkResetDescriptorPool(_device, pool, 0);
+		_freePools.push_back(pool);
+	}
+	pools = {};
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(FramePools& pools, VkDescriptorSetLayout layout, uint32_t variableCount)
+{
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+	variableCountAllocateInfo.descriptorSetCount = 1;
+	variableCountAllocateInfo.pDescriptorCounts = &variableCount;
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	descriptorSetAllocateInfo.pNext = variableCount ? &variableCountAllocateInfo : nullptr;
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+	descriptorSetAllocateInfo.pSetLayouts = &layout;
+
+	//a full pool moves to the used list and the allocation retries once from a fresh one
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		if (!pools.current && !(pools.current = GrabPool())) return VK_NULL_HANDLE;
+
+		descriptorSetAllocateInfo.descriptorPool = pools.current;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkResult result = vkAllocateDescriptorSets(_device, &descriptorSetAllocateInfo, &set);
+		if (result == VK_SUCCESS) return set;
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) break;
+
+		pools.used.push_back(pools.current);
+		pools.current = VK_NULL_HANDLE;
+	}
+
+	std::cout << "Error: failed to allocate a descriptor set\n";
+	return VK_NULL_HANDLE;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, uint32_t variableCount)
+{
+	return Allocate(_persistent, layout, variableCount);
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateFrame(VkDescriptorSetLayout layout, uint32_t variableCount)
+{
+	return Allocate(_frames[_frameSlot], layout, variableCount);
+}
+
+bool BindlessTextures::Create(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorLayoutCache& layoutCache)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	const VkPhysicalDeviceLimits& limits = properties.limits;
+	_capacity = std::min({ MAX_TEXTURES, limits.maxPerStageDescriptorSampledImages, limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSampledImages, limits.maxDescriptorSetSamplers });
+	_device = device;
+
+	std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings =
+	{
+		{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _capacity, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+	};
+	_layout = layoutCache.Get(descriptorSetLayoutBindings, { VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT });
+	if (!_layout) return false;
+
+	//its own pool, the array is far bigger than anything the shared pools are sized for
+	VkDescriptorPoolSize descriptorPoolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _capacity };
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	descriptorPoolCreateInfo.maxSets = 1;
+	descriptorPoolCreateInfo.poolSizeCount = 1;
+	descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+	if (vkCreateDescriptorPool(_device, &descriptorPoolCreateInfo, nullptr, &_pool) != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to create the bindless descriptor pool\n";
+		return false;
+	}
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+	variableCountAllocateInfo.descriptorSetCount = 1;
+	variableCountAllocateInfo.pDescriptorCounts = &_capacity;
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	descriptorSetAllocateInfo.pNext = &variableCountAllocateInfo;
+	descriptorSetAllocateInfo.descriptorPool = _pool;
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+	descriptorSetAllocateInfo.pSetLayouts = &_layout;
+	if (vkAllocateDescriptorSets(_device, &descriptorSetAllocateInfo, &_set) != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to allocate the bindless descriptor set\n";
+		Destroy();
+		return false;
+	}
+
+	VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	vkCreateSampler(_device, &samplerCreateInfo, nullptr, &_sampler);
+	return true;
+}
+
+void BindlessTextures::Destroy()
+{
+	if (_sampler) vkDestroySampler(_device, _sampler, nullptr);
+	if (_pool) vkDestroyDescriptorPool(_device, _pool, nullptr);
+	_sampler = VK_NULL_HANDLE;
+	_pool = VK_NULL_HANDLE;
+	_set = VK_NULL_HANDLE;
+	_layout = VK_NULL_HANDLE;
+	_count = 0;
+	_freeIndices.clear();
+}
+
+uint32_t BindlessTextures::Register(VkImageView imageView)
+{
+	if (!IsCreated()) return INVALID;
+
+	uint32_t index = _count;
+	if (!_freeIndices.empty())
+	{
+		index = _freeIndices.back();
+		_freeIndices.pop_back();
+	}
+	else if (_count == _capacity)
+	{
+		std::cout << "Warning: bindless texture array is full at " << _capacity << " textures\n";
+		return INVALID;
+	}
+	else _count++;
+
+	VkDescriptorImageInfo descriptorImageInfo = { _sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	writeDescriptorSet.dstSet = _set;
+	writeDescriptorSet.dstBinding = 0;
+	writeDescriptorSet.dstArrayElement = index;
+	writeDescriptorSet.descriptorCount = 1;
+	writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeDescriptorSet.pImageInfo = &descriptorImageInfo;
+	vkUpdateDescriptorSets(_device, 1, &writeDescriptorSet, 0, nullptr);
+	return index;
+}
+
+//partially bound, a slot nothing indexes can keep pointing at a destroyed view
+void BindlessTextures::Unregister(uint32_t index)
+{
+	if (index < _count && std::find(_freeIndices.begin(), _freeIndices.end(), index) == _freeIndices.end()) _freeIndices.push_back(index);
+}
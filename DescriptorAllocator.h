@@ -0,0 +1,106 @@
+#pragma once
+
+//descriptor set layouts and update templates shared by every node that asks for the same bindings
+class DescriptorLayoutCache
+{
+	struct CachedLayout
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		std::vector<VkDescriptorBindingFlags> bindingFlags;
+		VkDescriptorSetLayoutCreateFlags flags = 0;
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	};
+	struct CachedTemplate
+	{
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+		VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+	};
+
+	VkDevice _device = VK_NULL_HANDLE;
+	std::unordered_map<uint64_t, std::vector<CachedLayout>> _layouts; //binding hash -> layouts with that hash
+	std::unordered_map<uint64_t, std::vector<CachedTemplate>> _templates; //layout and entry hash -> templates with that hash
+
+public:
+	void Create(VkDevice device) { _device = device; }
+	void Destroy();
+
+	//bindings with immutable samplers aren't cached, their pointers can't be compared
+	VkDescriptorSetLayout Get(const std::vector<VkDescriptorSetLayoutBinding>& bindings, const std::vector<VkDescriptorBindingFlags>& bindingFlags = {}, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+	//one template per layout and entries, entries describe where each binding's info sits in the struct passed to Update
+	VkDescriptorUpdateTemplate GetUpdateTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries);
+	void Update(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const void* data) const { vkUpdateDescriptorSetWithTemplate(_device, set, updateTemplate, data); }
+
+	size_t GetLayoutCount() const;
+};
+
+//descriptor sets from pools that grow on demand instead of one pool sized per node
+//persistent sets live until Destroy, frame sets are handed back when their frame slot comes around again
+class DescriptorAllocator
+{
+	struct FramePools
+	{
+		std::vector<VkDescriptorPool> used;
+		VkDescriptorPool current = VK_NULL_HANDLE;
+	};
+
+	VkDevice _device = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> _freePools; //reset and ready to reuse
+	FramePools _persistent;
+	std::vector<FramePools> _frames;
+	unsigned int _frameSlot = 0;
+	uint32_t _nextPoolSets = INITIAL_POOL_SETS;
+	size_t _poolCount = 0;
+
+	VkDescriptorPool CreatePool();
+	VkDescriptorPool GrabPool();
+	VkDescriptorSet Allocate(FramePools& pools, VkDescriptorSetLayout layout, uint32_t variableCount);
+
+public:
+	static constexpr uint32_t INITIAL_POOL_SETS = 64;
+	static constexpr uint32_t MAX_POOL_SETS = 4096; //pools double up to this
+
+	bool Create(VkDevice device, unsigned int framesInFlight);
+	void Destroy();
+	bool IsCreated() const { return _device != VK_NULL_HANDLE; }
+
+	//call after the frame slot's fence wait, the slot's frame sets become invalid
+	void BeginFrame(unsigned int frameSlot);
+
+	//variableCount sizes a VARIABLE_DESCRIPTOR_COUNT last binding, VK_NULL_HANDLE when the device is out of memory
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout, uint32_t variableCount = 0);
+	VkDescriptorSet AllocateFrame(VkDescriptorSetLayout layout, uint32_t variableCount = 0);
+
+	size_t GetPoolCount() const { return _poolCount; }
+};
+
+//every material texture in one partially bound COMBINED_IMAGE_SAMPLER array, draws pick theirs with a push constant index
+//the set isn't update after bind, so Register and Unregister may only run while no frame using it is in flight
+class BindlessTextures
+{
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorPool _pool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout _layout = VK_NULL_HANDLE; //owned by the layout cache
+	VkDescriptorSet _set = VK_NULL_HANDLE;
+	VkSampler _sampler = VK_NULL_HANDLE;
+	uint32_t _capacity = 0, _count = 0;
+	std::vector<uint32_t> _freeIndices;
+
+public:
+	static constexpr uint32_t MAX_TEXTURES = 4096;
+	static constexpr uint32_t INVALID = UINT32_MAX;
+
+	//capacity is MAX_TEXTURES clamped to the device's per stage sampler and sampled image limits
+	bool Create(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorLayoutCache& layoutCache);
+	void Destroy();
+	bool IsCreated() const { return _set != VK_NULL_HANDLE; }
+
+	//slot in the array, INVALID when it's full
+	uint32_t Register(VkImageView imageView);
+	void Unregister(uint32_t index);
+
+	VkDescriptorSetLayout GetLayout() const { return _layout; }
+	VkDescriptorSet GetSet() const { return _set; }
+	uint32_t GetCount() const { return _count - (uint32_t)_freeIndices.size(); }
+};
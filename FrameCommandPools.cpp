@@ -0,0 +1,107 @@
+#include "pch.h"
+
+bool FrameCommandPools::Create(VkDevice device, uint32_t queueFamily, unsigned int framesInFlight, unsigned int workerThreads)
+{
+	_device = device;
+	_frames.assign(framesInFlight, std::vector<FramePool>(1 + workerThreads));
+
+	//buffers are only ever reset with their pool
+	VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = queueFamily;
+
+	for (auto& frame : _frames)
+	{
+		for (auto& thread : frame)
+		{
+			if (vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &thread.pool) != VK_SUCCESS)
+			{
+				std::cout << "Error: failed to create a frame command pool\n";
+				Destroy();
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void FrameCommandPools::Destroy()
+{
+	if (!IsCreated()) return;
+
+	//destroying a pool frees its buffers
+	for (auto& frame : _frames)
+		for (auto& thread : frame)
+			if (thread.pool) vkDestroyCommandPool(_device, thread.pool, nullptr);
+	_frames.clear();
+	_allocated = 0;
+	_device = VK_NULL_HANDLE;
+}
+
+void FrameCommandPools::BeginFrame(unsigned int frameSlot)
+{
+	_frameSlot = frameSlot;
+	for (auto& thread : _frames[_frameSlot])
+	{
+		if (thread.used[0].empty() && thread.used[1].empty()) continue;
+
+		vkResetCommandPool(_device, thread.pool, 0);
+		for (int level = 0; level < 2; level++)
+		{
+			thread.free[level].insert(thread.free[level].end(), thread.used[level].begin(), thread.used[level].end());
+			thread.used[level].clear();
+		}
+	}
+}
+
+VkCommandBuffer FrameCommandPools::Acquire(unsigned int thread, VkCommandBufferLevel level)
+{
+	FramePool& frame = _frames[_frameSlot][thread];
+	int list = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? 0 : 1;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (frame.free[list].empty())
+	{
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		commandBufferAllocateInfo.commandPool = frame.pool;
+		commandBufferAllocateInfo.level = level;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			std::cout << "Error: failed to allocate a command buffer\n";
+			return VK_NULL_HANDLE;
+		}
+		_allocated++;
+	}
+	else
+	{
+		commandBuffer = frame.free[list].back();
+		frame.free[list].pop_back();
+	}
+
+	frame.used[list].push_back(commandBuffer);
+	return commandBuffer;
+}
+
+VkCommandBuffer FrameCommandPools::Begin(unsigned int thread)
+{
+	VkCommandBuffer commandBuffer = Acquire(thread, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	if (!commandBuffer) return VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	return commandBuffer;
+}
+
+VkCommandBuffer FrameCommandPools::BeginSecondary(unsigned int thread, const VkCommandBufferInheritanceInfo& inheritance)
+{
+	VkCommandBuffer commandBuffer = Acquire(thread, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+	if (!commandBuffer) return VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = &inheritance;
+	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	return commandBuffer;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+//a command pool per frame in flight and recording thread, reset wholesale once that frame's fence has signalled
+//buffers handed out during a frame return to its free list on reset, so after warm up nothing is allocated
+class FrameCommandPools
+{
+	struct FramePool
+	{
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> free[2], used[2]; //per level, primary then secondary
+	};
+
+	VkDevice _device = VK_NULL_HANDLE;
+	std::vector<std::vector<FramePool>> _frames; //[frame slot][thread]
+	unsigned int _frameSlot = 0;
+	std::atomic<size_t> _allocated = 0;
+
+	VkCommandBuffer Acquire(unsigned int thread, VkCommandBufferLevel level);
+
+public:
+	//thread 0 is the main thread's, 1..workerThreads belong to one recording task each
+	bool Create(VkDevice device, uint32_t queueFamily, unsigned int framesInFlight, unsigned int workerThreads = 0);
+	void Destroy();
+	bool IsCreated() const { return _device != VK_NULL_HANDLE; }
+	unsigned int GetThreadCount() const { return _frames.empty() ? 0 : (unsigned int)_frames[0].size(); }
+
+	//call after the frame slot's fence wait, every buffer the slot handed out before becomes invalid
+	void BeginFrame(unsigned int frameSlot);
+
+	//a primary command buffer from this frame's pool, already begun for one time submit
+	VkCommandBuffer Begin(unsigned int thread = 0);
+	//a secondary continuing the inherited render pass, only one task may record from a thread's pool at a time
+	VkCommandBuffer BeginSecondary(unsigned int thread, const VkCommandBufferInheritanceInfo& inheritance);
+
+	//over every frame slot and thread, stays flat once each has seen its busiest frame
+	size_t GetAllocatedCount() const { return _allocated; }
+};
@@ -0,0 +1,733 @@
+#include "pch.h"
+
+namespace
+{
+	struct AccessInfo
+	{
+		VkImageLayout layout;
+		VkPipelineStageFlags2KHR stages;
+		VkAccessFlags2KHR access;
+		bool write;
+		bool discard; //the previous contents don't matter, the transition may start from UNDEFINED
+	};
+
+	//shader accesses only use the flags vkCmdPipelineBarrier also has, so the fallback can narrow them
+	AccessInfo GetAccessInfo(ResourceAccess access, VkImageAspectFlags aspect, VkPipelineStageFlags2KHR shaderStages)
+	{
+		switch (access)
+		{
+		case ResourceAccess::COLOR_WRITE:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, true, true };
+		case ResourceAccess::DEPTH_WRITE:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, true, true };
+		case ResourceAccess::DEPTH_READ:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR, false, false };
+		case ResourceAccess::SAMPLED_READ:
+		case ResourceAccess::INPUT_READ:
+			//a merged render pass leaves its input attachments in these layouts too
+			//depth is sampled in the read only depth layout so it can stay bound for depth tests too
+			return { (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStages,
+				VK_ACCESS_2_SHADER_READ_BIT_KHR, false, false };
+		case ResourceAccess::STORAGE_READ:
+			return { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_2_SHADER_READ_BIT_KHR, false, false };
+		case ResourceAccess::STORAGE_WRITE:
+			return { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_2_SHADER_READ_BIT_KHR | VK_ACCESS_2_SHADER_WRITE_BIT_KHR, true, false };
+		case ResourceAccess::TRANSFER_READ:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR, false, false };
+		case ResourceAccess::TRANSFER_WRITE:
+		default:
+			return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, true, false };
+		}
+	}
+
+	//barriers on depth/stencil formats cover both aspects
+	VkImageAspectFlags GetBarrierAspect(const FrameGraphImageResource& resource)
+	{
+		switch (resource.format)
+		{
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return resource.aspect;
+		}
+	}
+}
+
+bool FrameGraph::Compile()
+{
+	_dirty = false;
+	return FrameGraphCompiler::Compile(_nodes, _sinks, _subpassMerging, [this](QueueType type) { return Resolve(type); }, _schedule, _history, _mergeCount);
+}
+
+bool FrameGraph::IsMerged(const std::string& nodeName) const
+{
+	for (auto& node : _nodes)
+		if (node.name == nodeName) return node.mergedWith != FrameGraphNode::NOT_MERGED;
+	return false;
+}
+
+std::pair<int, int> FrameGraph::GetLifetime(const std::string& name) const
+{
+	std::pair<int, int> lifetime = { -1, -1 };
+	int pass = -1;
+	for (size_t index : _schedule)
+	{
+		const FrameGraphNode& node = _nodes[index];
+		//images only a merged pair touches live and die inside one render pass, they never need storing
+		if (node.subpass == 0) pass++;
+		bool used = std::find(node.inputResources.begin(), node.inputResources.end(), name) != node.inputResources.end()
+			|| std::find(node.outputResources.begin(), node.outputResources.end(), name) != node.outputResources.end();
+		if (!used) continue;
+
+		if (lifetime.first < 0) lifetime.first = pass;
+		lifetime.second = pass;
+	}
+	return lifetime;
+}
+
+std::vector<uint32_t> FrameGraph::GetQueueFamilies(const std::string& name) const
+{
+	std::vector<uint32_t> families;
+	for (size_t index : _schedule)
+	{
+		const FrameGraphNode& node = _nodes[index];
+		bool used = std::find(node.inputResources.begin(), node.inputResources.end(), name) != node.inputResources.end()
+			|| std::find(node.outputResources.begin(), node.outputResources.end(), name) != node.outputResources.end()
+			|| std::find(node.historyResources.begin(), node.historyResources.end(), name) != node.historyResources.end();
+		uint32_t family = GetQueueFamily(node.queue);
+		if (used && std::find(families.begin(), families.end(), family) == families.end()) families.push_back(family);
+	}
+	return families;
+}
+
+void FrameGraph::Declare()
+{
+	if (_dirty) Compile();
+	for (size_t index : _schedule)
+		if (_nodes[index].Declare) _nodes[index].Declare(_nodes[index]);
+}
+
+void FrameGraph::AllocateImages(MemoryAllocator& allocator, VkDevice device)
+{
+	struct Candidate
+	{
+		FrameGraphImageResource* resource;
+		VkMemoryRequirements requirements;
+		std::pair<int, int> lifetime;
+	};
+
+	std::vector<Candidate> candidates;
+	for (auto& resource : GetImages())
+	{
+		if (resource.image.image) continue;
+
+		//a versioned image's contents outlive the frame, it overlaps everything
+		std::pair<int, int> lifetime = resource.versions > 1 ? std::make_pair(INT_MIN, INT_MAX) : GetLifetime(resource.name);
+		resource.passLocal = resource.versions == 1 && lifetime.first == lifetime.second;
+
+		if (resource.passLocal)
+		{
+			//nothing samples or copies it, so only the attachment usages are kept
+			VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+			resource.usage = (resource.usage & attachmentUsage) | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+			//dedicated so its commitment can be queried on its own
+			resource.lazy = allocator.CreateImage(resource.extent, 1, VK_SAMPLE_COUNT_1_BIT, resource.format, VK_IMAGE_TILING_OPTIMAL, resource.usage,
+				VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, resource.image, resource.name, true) == VK_SUCCESS;
+			if (resource.lazy)
+			{
+				_transientRequested += resource.image.allocation.size;
+				_transientAllocated += resource.image.allocation.size;
+				GvkHelper::create_image_view(device, resource.image.image, resource.format, resource.aspect, 1, nullptr, &resource.image.imageView);
+				continue;
+			}
+		}
+
+		VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.extent = resource.extent;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.format = resource.format;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageCreateInfo.usage = resource.usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		//used on several queue families, shared so the timeline waits are all that orders the uses, no ownership transfers
+		std::vector<uint32_t> families = GetQueueFamilies(resource.name);
+		if (families.size() > 1)
+		{
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+			imageCreateInfo.pQueueFamilyIndices = families.data();
+		}
+		vkCreateImage(device, &imageCreateInfo, nullptr, &resource.image.image);
+
+		Candidate candidate = { &resource, {}, lifetime };
+		vkGetImageMemoryRequirements(device, resource.image.image, &candidate.requirements);
+		candidates.push_back(candidate);
+		_transientRequested += candidate.requirements.size;
+	}
+
+	//largest first, each image joins the first slot it fits in type wise whose users are all dead before it starts or born after it ends
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.requirements.size > b.requirements.size; });
+
+	struct Slot
+	{
+		VkMemoryRequirements requirements;
+		std::vector<Candidate*> users;
+	};
+	std::vector<Slot> slots;
+
+	for (auto& candidate : candidates)
+	{
+		Slot* slot = nullptr;
+		for (auto& existing : slots)
+		{
+			if (!(existing.requirements.memoryTypeBits & candidate.requirements.memoryTypeBits)) continue;
+
+			bool overlaps = std::any_of(existing.users.begin(), existing.users.end(), [&candidate](const Candidate* user)
+				{ return user->lifetime.first <= candidate.lifetime.second && candidate.lifetime.first <= user->lifetime.second; });
+			if (overlaps) continue;
+
+			slot = &existing;
+			break;
+		}
+
+		if (!slot)
+		{
+			slots.push_back({ candidate.requirements });
+			slot = &slots.back();
+		}
+
+		slot->requirements.size = std::max(slot->requirements.size, candidate.requirements.size);
+		slot->requirements.alignment = std::max(slot->requirements.alignment, candidate.requirements.alignment);
+		slot->requirements.memoryTypeBits &= candidate.requirements.memoryTypeBits;
+		slot->users.push_back(&candidate);
+	}
+
+	for (auto& slot : slots)
+	{
+		std::string owner = "Frame Graph:";
+		for (auto user : slot.users) owner += " " + user->resource->name;
+
+		Allocation allocation;
+		if (allocator.Allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, owner, allocation) != VK_SUCCESS)
+		{
+			std::cout << "Error: can't allocate " << slot.requirements.size << " bytes for" << owner.substr(owner.find(':') + 1) << '\n';
+			continue;
+		}
+		_aliasSlots.push_back(allocation);
+		_slotOccupants.push_back(UINT32_MAX);
+		_transientAllocated += allocation.size;
+
+		for (auto user : slot.users)
+		{
+			FrameGraphImageResource& resource = *user->resource;
+			resource.aliasSlot = static_cast<uint32_t>(_aliasSlots.size() - 1);
+			vkBindImageMemory(device, resource.image.image, allocation.memory, allocation.offset);
+			GvkHelper::create_image_view(device, resource.image.image, resource.format, resource.aspect, 1, nullptr, &resource.image.imageView);
+		}
+	}
+}
+
+void FrameGraph::DestroyImages(MemoryAllocator& allocator)
+{
+	//aliased images hold no allocation of their own, their slots are freed after
+	for (auto& resource : GetImages())
+	{
+		allocator.DestroyImage(resource.image);
+		resource.state = {};
+		resource.aliasSlot = FrameGraphImageResource::OWN_MEMORY;
+	}
+	for (auto& slot : _aliasSlots) allocator.Free(slot);
+
+	_aliasSlots.clear();
+	_slotOccupants.clear();
+	_transientRequested = _transientAllocated = 0;
+}
+
+VkDeviceSize FrameGraph::GetTransientSavings(VkDevice device) const
+{
+	VkDeviceSize savings = _transientRequested - _transientAllocated;
+	for (auto& resource : GetImages())
+	{
+		if (!resource.lazy) continue;
+
+		VkDeviceSize committed = 0;
+		vkGetDeviceMemoryCommitment(device, resource.image.allocation.memory, &committed);
+		savings += resource.image.allocation.size - std::min(committed, resource.image.allocation.size);
+	}
+	return savings;
+}
+
+VkCommandBuffer FrameGraph::GetRecorded(FrameGraphNode& node, uint64_t key, uint64_t tag, VkDevice device, VkCommandPool commandPool, const std::function<void(VkCommandBuffer)>& record)
+{
+	RecordedCommands& recorded = node.recorded[key];
+	if (recorded.valid && recorded.tag == tag) return recorded.commandBuffer;
+
+	if (!recorded.commandBuffer)
+	{
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		commandBufferAllocateInfo.commandPool = commandPool;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &recorded.commandBuffer) != VK_SUCCESS) return VK_NULL_HANDLE;
+	}
+
+	//begin resets it, the pool allows resetting single buffers
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	vkBeginCommandBuffer(recorded.commandBuffer, &commandBufferBeginInfo);
+	record(recorded.commandBuffer);
+	vkEndCommandBuffer(recorded.commandBuffer);
+
+	recorded.tag = tag;
+	recorded.valid = true;
+	_recordings++;
+	return recorded.commandBuffer;
+}
+
+void FrameGraph::Invalidate()
+{
+	for (auto& node : _nodes)
+		for (auto& [key, recorded] : node.recorded) recorded.valid = false;
+}
+
+void FrameGraph::Invalidate(const std::string& nodeName)
+{
+	for (auto& node : _nodes)
+	{
+		if (node.name != nodeName) continue;
+		for (auto& [key, recorded] : node.recorded) recorded.valid = false;
+	}
+}
+
+void FrameGraph::FreeRecorded(VkDevice device, VkCommandPool commandPool)
+{
+	for (auto& node : _nodes)
+	{
+		for (auto& [key, recorded] : node.recorded) vkFreeCommandBuffers(device, commandPool, 1, &recorded.commandBuffer);
+		node.recorded.clear();
+	}
+}
+
+ResourceAccess FrameGraph::GetAccess(const FrameGraphNode& node, const std::string& name, ImageHandle image, bool output) const
+{
+	auto declared = node.access.find(name);
+	if (declared != node.access.end()) return declared->second;
+	if (!output) return ResourceAccess::SAMPLED_READ;
+	return (GetImages()[image.index].aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? ResourceAccess::DEPTH_WRITE : ResourceAccess::COLOR_WRITE;
+}
+
+void FrameGraph::ResolveImageUses(FrameGraphNode& node)
+{
+	node.imageUses.clear();
+
+	//inputs then outputs so the batch and its hash come out the same every frame, a resource listed as both is written
+	auto resolve = [&](const std::string& name, bool output)
+		{
+			//buffers and images FrameGraph doesn't own, e.g. the swapchain, are synchronized by whoever owns them
+			ImageHandle image = GetHandle<FrameGraphImageResource>(name);
+			if (image.IsValid()) node.imageUses.push_back({ image, GetAccess(node, name, image, output) });
+		};
+	for (auto& history : node.historyResources)
+	{
+		ImageHandle image = GetHandle<FrameGraphImageResource>(history);
+		if (image.IsValid()) node.imageUses.push_back({ image, ResourceAccess::SAMPLED_READ, true });
+	}
+	for (auto& input : node.inputResources)
+		if (std::find(node.outputResources.begin(), node.outputResources.end(), input) == node.outputResources.end()) resolve(input, false);
+	for (auto& output : node.outputResources) resolve(output, true);
+}
+
+void FrameGraph::Transition(FrameGraphNode& node)
+{
+	//cleared rather than rebuilt so the vector's capacity carries over between frames
+	BarrierBatch& batch = node.barriers;
+	batch.images.clear();
+	batch.hash = 0;
+	node.submission.Clear();
+
+	const size_t queue = (size_t)Resolve(node.queue);
+	node.timelineValue = ++_queues[queue].value;
+	uint64_t waitValues[(size_t)QueueType::COUNT] = {};
+	VkPipelineStageFlags waitStages[(size_t)QueueType::COUNT] = {};
+
+	for (auto& use : node.imageUses)
+	{
+		//the first frame's history is whatever the image started with, it goes from UNDEFINED like a discard
+		FrameGraphImageResource& resource = use.history ? GetHistory(use.image) : Get(use.image);
+		if (!resource.image.image) continue;
+
+		ImageState& state = resource.state;
+		AccessInfo info = GetAccessInfo(use.access, resource.aspect, node.shaderStages);
+
+		//the first use of a new occupant of shared memory also waits for everything the last one did, on any queue
+		//versioned images sit alone in their slots, so only ever follow themselves
+		VkPipelineStageFlags2KHR aliasStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		VkAccessFlags2KHR aliasAccess = VK_ACCESS_2_NONE_KHR;
+		if (resource.aliasSlot != FrameGraphImageResource::OWN_MEMORY)
+		{
+			const uint32_t image = static_cast<uint32_t>(&resource - GetImages().data());
+			uint32_t& occupant = _slotOccupants[resource.aliasSlot];
+			if (occupant != UINT32_MAX && occupant != image)
+			{
+				const ImageState& previous = GetImages()[occupant].state;
+				aliasStages = previous.writeStages | previous.readStages;
+				aliasAccess = previous.writeAccess;
+				for (size_t other = 0; other < (size_t)QueueType::COUNT; other++)
+					if (other != queue) state.queueUses[other] = std::max(state.queueUses[other], previous.queueUses[other]);
+			}
+			occupant = image;
+		}
+
+		//uses on other queues are waited for at this use's stages, one wait per queue for its latest value
+		bool waited = false;
+		for (size_t other = 0; other < (size_t)QueueType::COUNT; other++)
+		{
+			if (other == queue || !state.queueUses[other]) continue;
+			waitValues[other] = std::max(waitValues[other], state.queueUses[other]);
+			waitStages[other] |= static_cast<VkPipelineStageFlags>(info.stages);
+			state.queueUses[other] = 0;
+			waited = true;
+		}
+		state.queueUses[queue] = node.timelineValue;
+
+		//the semaphore made everything the other queue did visible to these stages, a barrier only has to chain off the wait
+		//the other queue's stages can't go in this queue's barriers anyway
+		if (waited)
+		{
+			state.writeStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+			state.writeAccess = VK_ACCESS_2_NONE_KHR;
+			state.readStages = info.stages;
+		}
+
+		//reads of an image already in the right layout, with the last write visible to their stages, need nothing
+		if (!info.write && !aliasStages && state.layout == info.layout && (info.stages & ~state.readStages) == 0) continue;
+
+		VkImageMemoryBarrier2KHR barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+		barrier.srcStageMask = state.writeStages | aliasStages;
+		barrier.srcAccessMask = state.writeAccess | aliasAccess;
+		barrier.dstStageMask = info.stages;
+		barrier.dstAccessMask = info.access;
+		barrier.oldLayout = info.discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+		barrier.newLayout = info.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image.image;
+		barrier.subresourceRange = { GetBarrierAspect(resource), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+		//writes and layout changes also wait for the reads before them, those need no availability
+		if (info.write || state.layout != info.layout) barrier.srcStageMask |= state.readStages;
+
+		if (info.write)
+		{
+			state.writeStages = info.stages;
+			state.writeAccess = info.access;
+			state.readStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+		}
+		else if (state.layout != info.layout) state.readStages = info.stages;
+		else state.readStages |= info.stages;
+		state.layout = info.layout;
+
+		//inside a merged render pass the subpass dependency does what the barrier would, the state still advances
+		if (node.subpass > 0 && use.access == ResourceAccess::INPUT_READ) continue;
+
+		batch.images.push_back(barrier);
+		batch.hash = Cooked::Hash(&barrier.srcStageMask, sizeof(barrier.srcStageMask), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.srcAccessMask, sizeof(barrier.srcAccessMask), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.dstStageMask, sizeof(barrier.dstStageMask), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.dstAccessMask, sizeof(barrier.dstAccessMask), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.oldLayout, sizeof(barrier.oldLayout), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.newLayout, sizeof(barrier.newLayout), batch.hash);
+		batch.hash = Cooked::Hash(&barrier.image, sizeof(barrier.image), batch.hash);
+	}
+
+	for (size_t other = 0; other < (size_t)QueueType::COUNT; other++)
+		if (waitValues[other]) node.submission.WaitTimeline(_queues[other].timeline, waitStages[other], waitValues[other]);
+}
+
+void FrameGraph::EnableSynchronization2(VkDevice device)
+{
+	_pipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR"));
+}
+
+void FrameGraph::RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch)
+{
+	if (batch.images.empty()) return;
+
+	if (_pipelineBarrier2)
+	{
+		VkDependencyInfoKHR dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(batch.images.size());
+		dependencyInfo.pImageMemoryBarriers = batch.images.data();
+		_pipelineBarrier2(commandBuffer, &dependencyInfo);
+		return;
+	}
+
+	//one vkCmdPipelineBarrier takes the union of every barrier's stages, the stage and access bits used match the legacy ones
+	VkPipelineStageFlags srcStages = 0, dstStages = 0;
+	_legacyBarriers.clear();
+	for (auto& image : batch.images)
+	{
+		srcStages |= static_cast<VkPipelineStageFlags>(image.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(image.dstStageMask);
+
+		VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.srcAccessMask = static_cast<VkAccessFlags>(image.srcAccessMask);
+		barrier.dstAccessMask = static_cast<VkAccessFlags>(image.dstAccessMask);
+		barrier.oldLayout = image.oldLayout;
+		barrier.newLayout = image.newLayout;
+		barrier.srcQueueFamilyIndex = image.srcQueueFamilyIndex;
+		barrier.dstQueueFamilyIndex = image.dstQueueFamilyIndex;
+		barrier.image = image.image;
+		barrier.subresourceRange = image.subresourceRange;
+		_legacyBarriers.push_back(barrier);
+	}
+
+	//an image's first use has nothing to wait for, which the legacy call spells TOP_OF_PIPE
+	vkCmdPipelineBarrier(commandBuffer, srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(_legacyBarriers.size()), _legacyBarriers.data());
+}
+
+void FrameGraph::SetQueue(QueueType type, VkQueue queue, uint32_t family)
+{
+	_queues[(size_t)type].queue = queue;
+	_queues[(size_t)type].family = family;
+}
+
+void FrameGraph::CreateTimelines(VkPhysicalDevice physicalDevice, VkDevice device, unsigned int framesInFlight)
+{
+	_device = device;
+	_framesInFlight = framesInFlight;
+	_slotValues.assign(framesInFlight * (size_t)QueueType::COUNT, 0);
+
+	size_t queueCount = std::count_if(std::begin(_queues), std::end(_queues), [](const Queue& queue) { return queue.queue != VK_NULL_HANDLE; });
+	if (queueCount > 1)
+	{
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+		for (auto& queue : _queues)
+			if (queue.queue) vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &queue.timeline);
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	if (!properties.limits.timestampComputeAndGraphics || _nodes.empty()) return;
+
+	//queries are reset in the node's own command buffer, which transfer only families can't do, their nodes go untimed
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+	for (auto& queue : _queues)
+	{
+		queue.timestamps = queue.queue && queue.family < familyCount && families[queue.family].timestampValidBits > 0
+			&& (families[queue.family].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+	}
+
+	_timestampPeriod = properties.limits.timestampPeriod;
+	_timedNodes = _nodes.size();
+	_timestampsSubmitted.assign(framesInFlight * _timedNodes, false);
+	_timeline.reserve(2 * TIMELINE_FRAMES * _timedNodes);
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = static_cast<uint32_t>(framesInFlight * _timedNodes * 2);
+	vkCreateQueryPool(_device, &queryPoolCreateInfo, nullptr, &_timestampPool);
+}
+
+void FrameGraph::DestroyTimelines()
+{
+	if (!_device) return;
+
+	for (auto& queue : _queues)
+	{
+		if (queue.timeline) vkDestroySemaphore(_device, queue.timeline, nullptr);
+		queue.timeline = VK_NULL_HANDLE;
+	}
+	if (_timestampPool) vkDestroyQueryPool(_device, _timestampPool, nullptr);
+	_timestampPool = VK_NULL_HANDLE;
+	_device = VK_NULL_HANDLE;
+}
+
+void FrameGraph::BeginFrame(unsigned int frameSlot)
+{
+	_frameSlot = frameSlot;
+	_frame++;
+
+	//the fence only covers the queue the slot's last batch went to, by now the others are normally long done
+	if (_queues[(size_t)QueueType::GRAPHICS].timeline)
+	{
+		VkSemaphore semaphores[(size_t)QueueType::COUNT];
+		uint64_t values[(size_t)QueueType::COUNT];
+		uint32_t count = 0;
+		for (size_t queue = 0; queue < (size_t)QueueType::COUNT; queue++)
+		{
+			uint64_t value = _slotValues[frameSlot * (size_t)QueueType::COUNT + queue];
+			if (!value) continue;
+			semaphores[count] = _queues[queue].timeline;
+			values[count++] = value;
+		}
+
+		VkSemaphoreWaitInfo semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		semaphoreWaitInfo.semaphoreCount = count;
+		semaphoreWaitInfo.pSemaphores = semaphores;
+		semaphoreWaitInfo.pValues = values;
+		if (count) vkWaitSemaphores(_device, &semaphoreWaitInfo, UINT64_MAX);
+	}
+
+	ReadTimestamps(frameSlot);
+}
+
+void FrameGraph::ReadTimestamps(unsigned int frameSlot)
+{
+	_asyncMs = _overlapMs = 0.f;
+	if (!_timestampPool) return;
+
+	//trimmed in bulk, anything past TIMELINE_FRAMES is only dropped once there are twice as many
+	if (_timeline.size() >= 2 * TIMELINE_FRAMES * _timedNodes) _timeline.erase(_timeline.begin(), _timeline.end() - TIMELINE_FRAMES * _timedNodes);
+
+	size_t first = _timeline.size();
+	for (size_t index = 0; index < _timedNodes; index++)
+	{
+		size_t submitted = frameSlot * _timedNodes + index;
+		if (!_timestampsSubmitted[submitted]) continue;
+		_timestampsSubmitted[submitted] = false;
+
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(_device, _timestampPool, static_cast<uint32_t>(submitted * 2), 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) continue;
+		_timeline.push_back({ index, Resolve(_nodes[index].queue), _frame - _framesInFlight,
+			static_cast<uint64_t>(timestamps[0] * (double)_timestampPeriod), static_cast<uint64_t>(timestamps[1] * (double)_timestampPeriod) });
+	}
+
+	//every node off the graphics queue against every graphics node of the same frame
+	for (size_t i = first; i < _timeline.size(); i++)
+	{
+		const NodeTiming& async = _timeline[i];
+		if (async.queue == QueueType::GRAPHICS || async.end <= async.begin) continue;
+		_asyncMs += (async.end - async.begin) / 1000000.f;
+
+		for (size_t j = first; j < _timeline.size(); j++)
+		{
+			const NodeTiming& graphics = _timeline[j];
+			if (graphics.queue != QueueType::GRAPHICS) continue;
+			uint64_t begin = std::max(async.begin, graphics.begin), end = std::min(async.end, graphics.end);
+			if (end > begin) _overlapMs += (end - begin) / 1000000.f;
+		}
+	}
+}
+
+void FrameGraph::WriteTimestamp(VkCommandBuffer commandBuffer, FrameGraphNode& node, bool end)
+{
+	size_t index = &node - _nodes.data();
+	if (!_timestampPool || index >= _timedNodes || !_queues[(size_t)Resolve(node.queue)].timestamps) return;
+
+	uint32_t query = static_cast<uint32_t>((_frameSlot * _timedNodes + index) * 2);
+	if (end)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampPool, query + 1);
+		node.timed = true;
+		return;
+	}
+
+	//queries can't be reset inside a render pass, the producer of a merged pair resets its consumer's too
+	if (node.subpass == 0)
+	{
+		vkCmdResetQueryPool(commandBuffer, _timestampPool, query, 2);
+		if (node.mergedWith < _timedNodes) vkCmdResetQueryPool(commandBuffer, _timestampPool, static_cast<uint32_t>((_frameSlot * _timedNodes + node.mergedWith) * 2), 2);
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestampPool, query);
+}
+
+nlohmann::json FrameGraph::GetTimelineReport() const
+{
+	static const char* queueNames[] = { "Graphics", "Compute", "Transfer" };
+
+	nlohmann::json events = nlohmann::json::array();
+	for (size_t queue = 0; queue < (size_t)QueueType::COUNT; queue++)
+		events.push_back({ {"ph", "M"}, {"name", "thread_name"}, {"pid", 0}, {"tid", queue}, {"args", {{"name", queueNames[queue]}}} });
+
+	//trace timestamps are microseconds, counted from the oldest node kept
+	uint64_t origin = UINT64_MAX;
+	for (auto& timing : _timeline) origin = std::min(origin, timing.begin);
+	for (auto& timing : _timeline)
+	{
+		events.push_back({ {"ph", "X"}, {"name", _nodes[timing.node].name}, {"pid", 0}, {"tid", (size_t)timing.queue},
+			{"ts", (timing.begin - origin) / 1000.0}, {"dur", (timing.end - timing.begin) / 1000.0}, {"args", {{"frame", timing.frame}}} });
+	}
+
+	return { {"traceEvents", events}, {"displayTimeUnit", "ms"} };
+}
+
+void FrameGraph::Submit(VkFence fence)
+{
+	//sized up front, the submit infos point into the timeline infos until the last vkQueueSubmit
+	_submitInfos.resize(_schedule.size());
+	_timelineInfos.resize(_schedule.size());
+
+	size_t count = 0, first = 0;
+	size_t batchQueue = (size_t)QueueType::GRAPHICS;
+	uint64_t signalled[(size_t)QueueType::COUNT] = {};
+	for (size_t index : _schedule)
+	{
+		FrameGraphNode& node = _nodes[index];
+		NodeSubmission& submission = node.submission;
+
+		//the consumer recorded into the producer's command buffer, so whatever it waits for and signals has to go with it
+		if (node.subpass == 0 && node.mergedWith != FrameGraphNode::NOT_MERGED)
+		{
+			submission.Append(_nodes[node.mergedWith].submission);
+			_nodes[node.mergedWith].submission.Clear();
+		}
+		if (submission.IsEmpty() && node.imageUses.empty()) continue;
+
+		size_t queue = (size_t)Resolve(node.queue);
+		if (queue != batchQueue && count > first)
+		{
+			vkQueueSubmit(_queues[batchQueue].queue, static_cast<uint32_t>(count - first), &_submitInfos[first], VK_NULL_HANDLE);
+			first = count;
+		}
+		batchQueue = queue;
+
+		//what later uses of its images on other queues wait for
+		if (_queues[queue].timeline)
+		{
+			submission.SignalTimeline(_queues[queue].timeline, node.timelineValue);
+			signalled[queue] = node.timelineValue;
+		}
+
+		VkTimelineSemaphoreSubmitInfo& timelineInfo = _timelineInfos[count];
+		timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(submission.waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = submission.waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(submission.signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = submission.signalValues.data();
+
+		VkSubmitInfo& submitInfo = _submitInfos[count++];
+		submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submitInfo.pNext = submission.timeline ? &timelineInfo : nullptr;
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(submission.waitSemaphores.size());
+		submitInfo.pWaitSemaphores = submission.waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = submission.waitStages.data();
+		submitInfo.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+		submitInfo.pCommandBuffers = submission.commandBuffers.data();
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(submission.signalSemaphores.size());
+		submitInfo.pSignalSemaphores = submission.signalSemaphores.data();
+
+		if (node.timed && index < _timedNodes) _timestampsSubmitted[_frameSlot * _timedNodes + index] = true;
+	}
+
+	//an empty frame still signals its fence
+	if (count > first || fence) vkQueueSubmit(_queues[batchQueue].queue, static_cast<uint32_t>(count - first), count > first ? &_submitInfos[first] : nullptr, fence);
+
+	if (_slotValues.empty()) return;
+	for (size_t queue = 0; queue < (size_t)QueueType::COUNT; queue++) _slotValues[_frameSlot * (size_t)QueueType::COUNT + queue] = signalled[queue];
+}
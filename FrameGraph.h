@@ -7,15 +7,33 @@ struct FrameGraphResource
 	std::string parent = "";
 	//bool isExternal = false; // don't need?
 	bool prepared = false;
+	unsigned int versions = 1; //copies frames rotate through, see FrameGraph::AddResource
+};
 
-	virtual ~FrameGraphResource() = default; // Virtual destructor
+//where an image was last left, in submission order
+struct ImageState
+{
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags2KHR writeStages = VK_PIPELINE_STAGE_2_NONE_KHR;
+	VkAccessFlags2KHR writeAccess = VK_ACCESS_2_NONE_KHR;
+	VkPipelineStageFlags2KHR readStages = VK_PIPELINE_STAGE_2_NONE_KHR; //reads since the last write, the write is visible to them
+	uint64_t queueUses[(size_t)QueueType::COUNT] = {}; //timeline value of the last use on each queue, 0 once another queue waited for it
 };
 
+//registered without memory, FrameGraph::AllocateImages creates and places them
 struct FrameGraphImageResource : FrameGraphResource
 {
+	static constexpr uint32_t OWN_MEMORY = UINT32_MAX;
+
 	Image image;
 	VkFormat format;
 	VkExtent3D extent;
+	VkImageUsageFlags usage = 0;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	bool passLocal = false; //never read outside the node that writes it, so it doesn't need storing
+	bool lazy = false; //backed by lazily allocated memory
+	uint32_t aliasSlot = OWN_MEMORY; //the alias slot its memory is in, shared with images whose lifetimes don't overlap
+	ImageState state;
 };
 
 template <typename T>
@@ -25,32 +43,194 @@ struct FrameGraphBufferResource : FrameGraphResource
 	std::vector<Buffer> buffers;
 };
 
-using BufferDataVariants = std::variant<
-	FrameGraphBufferResource<UniformBufferOffscreen>,
-	FrameGraphBufferResource<UniformBufferFinal>,
-	FrameGraphBufferResource<Vertex>,
-	FrameGraphBufferResource<unsigned int>
+//index into the frame graph's dense array of T, resources are replaced in place but never removed so handles stay valid
+template <typename T>
+struct ResourceHandle
+{
+	uint32_t index = UINT32_MAX;
+	bool IsValid() const { return index != UINT32_MAX; }
+};
+
+using ImageHandle = ResourceHandle<FrameGraphImageResource>;
+template <typename T>
+using BufferHandle = ResourceHandle<FrameGraphBufferResource<T>>;
+
+template <typename T>
+struct ResourceArray
+{
+	std::vector<T> resources;
+	std::unordered_map<std::string, uint32_t> indices; //only looked up while nodes set up
+	std::vector<std::vector<uint32_t>> versions; //[index] every copy of a versioned resource in rotation order, itself first, empty for single ones
+};
+
+//one array per resource type, a type missing here won't compile
+using ResourceArrays = std::tuple<
+	ResourceArray<FrameGraphImageResource>,
+	ResourceArray<FrameGraphBufferResource<UniformBufferOffscreen>>,
+	ResourceArray<FrameGraphBufferResource<UniformBufferFinal>>,
+	ResourceArray<FrameGraphBufferResource<Vertex>>,
+	ResourceArray<FrameGraphBufferResource<unsigned int>>
 >;
 
-struct FrameGraphNode
+//a command buffer a static pass recorded once and replays
+struct RecordedCommands
+{
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	uint64_t tag = 0; //whatever per frame value the recording baked in, e.g. a dynamic uniform offset
+	bool valid = false;
+};
+
+//every image barrier a node needs before its work, recorded with one call
+struct BarrierBatch
+{
+	std::vector<VkImageMemoryBarrier2KHR> images;
+	uint64_t hash = 0; //of the barriers, changes whenever a recorded pass would have to record different ones
+};
+
+//what a node hands to FrameGraph::Submit, cleared before its Execute every frame
+//Execute adds its command buffers and semaphores from outside the graph, e.g. the swapchain's, the graph adds its own timeline waits
+struct NodeSubmission
+{
+	std::vector<VkCommandBuffer> commandBuffers;
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<VkPipelineStageFlags> waitStages;
+	std::vector<uint64_t> waitValues; //ignored for binary semaphores
+	std::vector<VkSemaphore> signalSemaphores;
+	std::vector<uint64_t> signalValues;
+	bool timeline = false; //some semaphore is a timeline, the values go in a VkTimelineSemaphoreSubmitInfo
+
+	void Wait(VkSemaphore semaphore, VkPipelineStageFlags stages)
+	{
+		waitSemaphores.push_back(semaphore);
+		waitStages.push_back(stages);
+		waitValues.push_back(0);
+	}
+	void WaitTimeline(VkSemaphore semaphore, VkPipelineStageFlags stages, uint64_t value) { Wait(semaphore, stages); waitValues.back() = value; timeline = true; }
+	void Signal(VkSemaphore semaphore) { signalSemaphores.push_back(semaphore); signalValues.push_back(0); }
+	void Append(const NodeSubmission& other)
+	{
+		commandBuffers.insert(commandBuffers.end(), other.commandBuffers.begin(), other.commandBuffers.end());
+		waitSemaphores.insert(waitSemaphores.end(), other.waitSemaphores.begin(), other.waitSemaphores.end());
+		waitStages.insert(waitStages.end(), other.waitStages.begin(), other.waitStages.end());
+		waitValues.insert(waitValues.end(), other.waitValues.begin(), other.waitValues.end());
+		signalSemaphores.insert(signalSemaphores.end(), other.signalSemaphores.begin(), other.signalSemaphores.end());
+		signalValues.insert(signalValues.end(), other.signalValues.begin(), other.signalValues.end());
+		timeline |= other.timeline;
+	}
+	void SignalTimeline(VkSemaphore semaphore, uint64_t value) { Signal(semaphore); signalValues.back() = value; timeline = true; }
+	bool IsEmpty() const { return commandBuffers.empty() && waitSemaphores.empty() && signalSemaphores.empty(); }
+	//keeps the capacity
+	void Clear()
+	{
+		commandBuffers.clear();
+		waitSemaphores.clear();
+		waitStages.clear();
+		waitValues.clear();
+		signalSemaphores.clear();
+		signalValues.clear();
+		timeline = false;
+	}
+};
+
+//a node's gpu time on its queue, in nanoseconds of the device's timestamp clock, which every queue shares
+struct NodeTiming
+{
+	size_t node;
+	QueueType queue;
+	unsigned long long frame;
+	uint64_t begin, end;
+};
+
+//an image a node touches, resolved from its resource names once it's set up
+struct ImageUse
+{
+	ImageHandle image;
+	ResourceAccess access;
+	bool history = false; //the previous frame's version
+};
+
+struct FrameGraphNode : FrameGraphNodeInfo
 {
-	std::string name; //node name
-	bool shouldExecute = false;
 	bool isSetupComplete = false;
 	FrameBufferT frameBuffer;
-	std::vector<std::string> inputResources;
-	std::vector<std::string> outputResources;
+	//registers the node's images, run for every node by FrameGraph::Declare before AllocateImages so they're all placed together
+	std::function<void(FrameGraphNode&)> Declare;
+	//the rest of its one time setup, its images have memory by then
 	std::function<void(FrameGraphNode&)> Setup;
 	std::function<void(VkCommandBuffer&, FrameGraphNode&)> Execute;
+	std::unordered_map<uint64_t, RecordedCommands> recorded; //static passes only, see FrameGraph::GetRecorded
+	VkPipelineStageFlags2KHR shaderStages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR; //where its sampled and storage accesses happen
+	std::vector<ImageUse> imageUses; //what the barriers are computed from every frame
+	BarrierBatch barriers; //filled by FrameGraph::Execute, the node records them before its render pass
+	NodeSubmission submission; //what FrameGraph::Submit sends to its queue, even empty when it touches images so its value gets signalled
+	uint64_t timelineValue = 0; //its queue's timeline reaches this once its commands complete
+	bool timed = false; //its command buffers write FrameGraph timestamps
 };
 
 class FrameGraph
 {
+	struct Queue
+	{
+		VkQueue queue = VK_NULL_HANDLE;
+		uint32_t family = VK_QUEUE_FAMILY_IGNORED;
+		VkSemaphore timeline = VK_NULL_HANDLE; //only with more than one queue, every submission to it signals its node's value
+		uint64_t value = 0; //the last value handed to a node
+		bool timestamps = false; //its family has valid timestamp bits
+	};
+
 	static inline FrameGraph* _frameGraph = nullptr;
 	std::vector<FrameGraphNode> _nodes;
+	std::vector<std::string> _sinks; //resources consumed outside the graph
+	std::vector<size_t> _schedule; //node indices in execution order, empty if the last Compile failed
+	bool _dirty = true; //nodes or sinks changed since the last Compile
+	std::set<std::string> _history; //resources a scheduled node reads the previous frame's version of
 	std::vector<VkSemaphore> _semaphores;
-	std::unordered_map<std::string, BufferDataVariants> _bufferResources;
-	std::unordered_map<std::string, FrameGraphImageResource> _imageResources;
+	ResourceArrays _resources;
+
+	//images with disjoint lifetimes share one of these
+	std::vector<Allocation> _aliasSlots;
+	std::vector<uint32_t> _slotOccupants; //[alias slot] image index of the slot's last use, its accesses are what the next occupant waits for
+	VkDeviceSize _transientRequested = 0, _transientAllocated = 0;
+	unsigned long long _recordings = 0; //static pass recordings since startup
+	PFN_vkCmdPipelineBarrier2KHR _pipelineBarrier2 = nullptr;
+	unsigned int _barrierCount = 0; //image barriers computed by the last Execute
+	bool _subpassMerging = true;
+	size_t _mergeCount = 0;
+
+	std::vector<VkImageMemoryBarrier> _legacyBarriers; //reused by RecordBarriers without synchronization2
+
+	Queue _queues[(size_t)QueueType::COUNT];
+	VkDevice _device = VK_NULL_HANDLE;
+	unsigned int _framesInFlight = 1, _frameSlot = 0;
+	unsigned long long _frame = 0;
+	std::vector<uint64_t> _slotValues; //[frame slot][queue], what each timeline reaches once the slot's frame is done
+	std::vector<VkSubmitInfo> _submitInfos; //reused by Submit
+	std::vector<VkTimelineSemaphoreSubmitInfo> _timelineInfos;
+
+	//a begin and end timestamp per node and frame slot
+	VkQueryPool _timestampPool = VK_NULL_HANDLE;
+	float _timestampPeriod = 1.f;
+	size_t _timedNodes = 0; //nodes the pool has room for
+	std::vector<bool> _timestampsSubmitted; //[frame slot][node]
+	std::vector<NodeTiming> _timeline; //the last frames' node timings, oldest first
+	float _asyncMs = 0.f, _overlapMs = 0.f;
+
+	template <typename T>
+	ResourceArray<T>& GetArray() { return std::get<ResourceArray<T>>(_resources); }
+	template <typename T>
+	const ResourceArray<T>& GetArray() const { return std::get<ResourceArray<T>>(_resources); }
+	std::vector<FrameGraphImageResource>& GetImages() { return GetArray<FrameGraphImageResource>().resources; }
+	const std::vector<FrameGraphImageResource>& GetImages() const { return GetArray<FrameGraphImageResource>().resources; }
+
+	QueueType Resolve(QueueType type) const { return _queues[(size_t)type].queue ? type : QueueType::GRAPHICS; }
+	//distinct families of the scheduled nodes that list the resource
+	std::vector<uint32_t> GetQueueFamilies(const std::string& name) const;
+	void ReadTimestamps(unsigned int frameSlot);
+
+	ResourceAccess GetAccess(const FrameGraphNode& node, const std::string& name, ImageHandle image, bool output) const;
+	void ResolveImageUses(FrameGraphNode& node);
+	//fills node.barriers with what brings every image the node touches from its last use into this one, advances their states
+	void Transition(FrameGraphNode& node);
 
 	FrameGraph() {};
 	~FrameGraph() {};
@@ -64,6 +244,13 @@ public:
 		return _frameGraph;
 	}
 
+	//the next GetInstance starts an empty graph, once the renderer whose nodes and images these are is gone
+	static void DestroyInstance()
+	{
+		delete _frameGraph;
+		_frameGraph = nullptr;
+	}
+
 	int GetNodeCount() const
 	{
 		return _nodes.size();
@@ -72,40 +259,230 @@ public:
 	void AddNode(const FrameGraphNode& frameGraphNode)
 	{
 		_nodes.push_back(frameGraphNode);
+		_dirty = true;
 	}
 
+	//e.g. the presented image, passes that don't contribute to any sink are culled
+	void AddSink(const std::string& resourceName)
+	{
+		_sinks.push_back(resourceName);
+		_dirty = true;
+	}
+
+	//orders the enabled nodes so producers run before their consumers, ties keep insertion order, and culls the ones no sink
+	//depends on. false on a cycle, a missing producer or a resource with two producers, nothing executes until it succeeds
+	//the schedule is kept until a node or sink is added, merged pairs sit next to each other in it
+	bool Compile();
+	size_t GetScheduledCount() const { return _schedule.size(); }
+
+	//on by default, both halves of a merge need to know before they set up, so it can't change after the first Execute
+	void SetSubpassMerging(bool enabled)
+	{
+		_subpassMerging = enabled;
+		_dirty = true;
+	}
+	size_t GetMergeCount() const { return _mergeCount; }
+	bool IsMerged(const std::string& nodeName) const;
+	//the other half of the node's render pass, nullptr when it has its own
+	FrameGraphNode* GetMergedNode(const FrameGraphNode& node) { return node.mergedWith == FrameGraphNode::NOT_MERGED ? nullptr : &_nodes[node.mergedWith]; }
+
+	//registering a name again replaces the resource, every version of it, and keeps its handle
+	//with more than one version the resource is copied that many times and Get rotates through the copies frame by frame.
+	//a copy is reused versions frames later, at least frames in flight later is after its fence for anything the cpu writes.
+	//versions only ever grow, the graph fills its own images' copies, the rest are filled through GetVersion
 	template <typename T>
-	void AddBufferResource(const std::string& name, FrameGraphBufferResource<T>& resource)
+	ResourceHandle<T> AddResource(const std::string& name, const T& resource)
 	{
-		_bufferResources[name] = resource;
+		ResourceArray<T>& array = GetArray<T>();
+		auto [found, inserted] = array.indices.emplace(name, static_cast<uint32_t>(array.resources.size()));
+		uint32_t index = found->second;
+		if (inserted)
+		{
+			array.resources.push_back(resource);
+			array.versions.emplace_back();
+		}
+
+		unsigned int versions = std::max<unsigned int>({ 1u, resource.versions, static_cast<unsigned int>(array.versions[index].size()) });
+		if (versions > 1 && array.versions[index].empty()) array.versions[index].push_back(index);
+		while (array.versions[index].size() < versions)
+		{
+			array.versions[index].push_back(static_cast<uint32_t>(array.resources.size()));
+			array.resources.push_back(resource);
+			array.versions.emplace_back();
+		}
+
+		if (versions == 1) array.resources[index] = resource;
+		for (uint32_t copy : array.versions[index])
+		{
+			array.resources[copy] = resource;
+			array.resources[copy].versions = versions;
+		}
+		return { index };
 	}
 
-	void AddImageResource(const std::string& name, FrameGraphImageResource& resource)
+	template <typename T>
+	BufferHandle<T> AddBufferResource(const std::string& name, FrameGraphBufferResource<T>& resource)
 	{
-		_imageResources[name] = resource;
+		return AddResource(name, resource);
+	}
+
+	//images some node reads the history of get at least two versions, the rest stay single unless they ask for more
+	ImageHandle AddImageResource(const std::string& name, FrameGraphImageResource& resource)
+	{
+		if (_history.count(name)) resource.versions = std::max(resource.versions, 2u);
+		return AddResource(name, resource);
+	}
+
+	//name lookups are for setup, invalid if nothing of that type is registered under it
+	template <typename T>
+	ResourceHandle<T> GetHandle(const std::string& name) const
+	{
+		const ResourceArray<T>& array = GetArray<T>();
+		auto found = array.indices.find(name);
+		return found == array.indices.end() ? ResourceHandle<T>() : ResourceHandle<T>{ found->second };
+	}
+
+	//what frames use, a plain array index, this frame's version of a versioned resource
+	template <typename T>
+	T& Get(ResourceHandle<T> handle)
+	{
+		return GetVersion(handle, 0);
+	}
+
+	//the version the frame before this one used, the same as Get for single resources
+	template <typename T>
+	T& GetHistory(ResourceHandle<T> handle)
+	{
+		return GetVersion(handle, -1);
+	}
+
+	//the version frameOffset frames from this one, e.g. to fill every copy once: 0 to versions - 1
+	template <typename T>
+	T& GetVersion(ResourceHandle<T> handle, int frameOffset)
+	{
+		ResourceArray<T>& array = GetArray<T>();
+		const std::vector<uint32_t>& versions = array.versions[handle.index];
+		if (versions.empty()) return array.resources[handle.index];
+
+		return array.resources[versions[FrameGraphCompiler::VersionIndex(_frame, versions.size(), frameOffset)]];
+	}
+
+	//versions of the resource, 1 when it isn't versioned
+	template <typename T>
+	unsigned int GetVersionCount(ResourceHandle<T> handle) const
+	{
+		size_t count = GetArray<T>().versions[handle.index].size();
+		return count ? static_cast<unsigned int>(count) : 1;
 	}
 
 	template <typename T>
 	FrameGraphBufferResource<T>& GetBufferResource(const std::string& name)
 	{
-		return std::get<FrameGraphBufferResource<T>>(_bufferResources.at(name));
+		auto& array = GetArray<FrameGraphBufferResource<T>>();
+		return array.resources[array.indices.at(name)];
 	}
 
 	FrameGraphImageResource& GetImageResource(const std::string& name)
 	{
-		return _imageResources.at(name);
+		auto& array = GetArray<FrameGraphImageResource>();
+		return array.resources[array.indices.at(name)];
 	}
 
+	//first and last render pass that lists the resource as an input or output, counted in schedule order with a merged pair
+	//counting once, { -1, -1 } if none does
+	std::pair<int, int> GetLifetime(const std::string& name) const;
+
+	//runs Declare of every scheduled node, after Compile and before AllocateImages
+	void Declare();
+
+	//creates every registered image that has no memory yet, every version of it
+	//images only their own node touches become transient attachments in lazily allocated memory when the device has it,
+	//the rest share memory with images whose lifetimes don't overlap, so each must start UNDEFINED in its first pass.
+	//versioned images are kept from frame to frame, they get memory of their own
+	void AllocateImages(MemoryAllocator& allocator, VkDevice device);
+	void DestroyImages(MemoryAllocator& allocator);
+	//what aliasing plus the uncommitted part of lazily allocated memory saves over one allocation per image, the commitment can change every frame
+	VkDeviceSize GetTransientSavings(VkDevice device) const;
+	VkDeviceSize GetTransientRequested() const { return _transientRequested; }
+
+	//for passes whose commands don't change between frames: returns the buffer recorded for key, recording it first when it's
+	//missing, invalidated or was recorded with another tag. keys must tell frames in flight apart, a buffer is only ever
+	//re-recorded by the frame that submits it, after that frame's fence
+	VkCommandBuffer GetRecorded(FrameGraphNode& node, uint64_t key, uint64_t tag, VkDevice device, VkCommandPool commandPool, const std::function<void(VkCommandBuffer)>& record);
+	//swapchain rebuilt, pipeline reloaded or descriptors rewritten, static passes record again on their next Execute
+	void Invalidate();
+	void Invalidate(const std::string& nodeName);
+	void FreeRecorded(VkDevice device, VkCommandPool commandPool);
+	unsigned long long GetRecordingCount() const { return _recordings; }
+
+	//device created with VK_KHR_synchronization2, barriers are recorded with vkCmdPipelineBarrier2KHR instead of vkCmdPipelineBarrier
+	void EnableSynchronization2(VkDevice device);
+	void RecordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+	unsigned int GetBarrierCount() const { return _barrierCount; }
+
+	//graphics has to be set, nodes asking for a queue that isn't run on graphics
+	void SetQueue(QueueType type, VkQueue queue, uint32_t family);
+	uint32_t GetQueueFamily(QueueType type) const { return _queues[(size_t)Resolve(type)].family; }
+	//nodes asking for it get their own hardware queue instead of graphics
+	bool IsAsync(QueueType type) const { return Resolve(type) != QueueType::GRAPHICS; }
+
+	//after the queues are set: a timeline semaphore per queue once there's more than one, which needs timeline semaphore
+	//support, and a timestamp pair per node and frame slot when the device has timestamps on graphics and compute
+	void CreateTimelines(VkPhysicalDevice physicalDevice, VkDevice device, unsigned int framesInFlight);
+	void DestroyTimelines();
+
+	//call after the frame slot's fence wait, waits for the slot's work on the other queues and reads its timestamps
+	void BeginFrame(unsigned int frameSlot);
+	//outside render passes, begin as the node's first command and end as its last. a recorded pass may write them, the
+	//queries only depend on the node and frame slot
+	void WriteTimestamp(VkCommandBuffer commandBuffer, FrameGraphNode& node, bool end);
+	//from the frame slot's timestamps as of its last BeginFrame: gpu time of nodes on their own queues, and how much of it
+	//ran while graphics nodes did
+	float GetAsyncMs() const { return _asyncMs; }
+	float GetOverlapMs() const { return _overlapMs; }
+	//trace event json of the last TIMELINE_FRAMES frames, a track per queue, loads in chrome://tracing or Perfetto
+	nlohmann::json GetTimelineReport() const;
+	static constexpr size_t TIMELINE_FRAMES = 120;
+
+	//after Execute, every node's submission in schedule order, runs of nodes on the same queue share a vkQueueSubmit
+	//fence goes with the last one, BeginFrame covers the other queues
+	void Submit(VkFence fence);
+
+	//barrier states advance in schedule order, which has to be the order their command buffers are submitted in
+	//once set up, nodes are walked through the schedule and handles, nothing is looked up by name or allocated
 	void Execute(VkCommandBuffer& commandBuffer)
 	{
-		for (auto& node : _nodes) {
-			// Ensure input resources are prepared here if needed
-			if (node.shouldExecute)
+		_barrierCount = 0;
+		if (_dirty) Compile();
+
+		auto setup = [&](FrameGraphNode& node)
 			{
-				if (!node.isSetupComplete) node.Setup(node);
+				if (node.isSetupComplete) return;
+				node.Setup(node);
+				ResolveImageUses(node);
+			};
 
-				node.Execute(commandBuffer, node);
+		for (size_t index : _schedule) {
+			FrameGraphNode& node = _nodes[index];
+			setup(node);
+
+			//a merged consumer's barriers have to be recorded before the render pass it shares begins, they go with the producer's
+			if (node.subpass == 0)
+			{
+				Transition(node);
+				if (FrameGraphNode* consumer = GetMergedNode(node))
+				{
+					setup(*consumer);
+					Transition(*consumer);
+					node.barriers.images.insert(node.barriers.images.end(), consumer->barriers.images.begin(), consumer->barriers.images.end());
+					node.barriers.hash = Cooked::Hash(&consumer->barriers.hash, sizeof(consumer->barriers.hash), node.barriers.hash);
+					consumer->barriers.images.clear();
+				}
 			}
+
+			_barrierCount += node.barriers.images.size();
+			//the consumer continues in the command buffer the producer left in commandBuffer
+			node.Execute(commandBuffer, node);
 		}
 	}
 };
\ No newline at end of file
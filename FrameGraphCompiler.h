@@ -0,0 +1,238 @@
+#pragma once
+
+// Compiling the frame graph's nodes into a schedule, templated over the node type FrameGraph adds its vulkan state to,
+// and which copy of a versioned resource a frame uses
+// Header only and free of vulkan, so the CPU-only tests build it without a device
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//how a node touches an image, FrameGraph derives the layout, stages and barriers from it
+//color and depth writes expect the pass to clear or cover the whole attachment, the old contents are discarded
+enum class ResourceAccess
+{
+	COLOR_WRITE,
+	DEPTH_WRITE,
+	DEPTH_READ, //depth tested without writing
+	SAMPLED_READ,
+	INPUT_READ, //only at the fragment's own pixel, an input attachment once Compile merges the node into its producer's render pass, sampled until then
+	STORAGE_READ,
+	STORAGE_WRITE,
+	TRANSFER_READ,
+	TRANSFER_WRITE
+};
+
+//which queue a node is submitted to, one the device has no queue for runs on graphics
+enum class QueueType
+{
+	GRAPHICS,
+	COMPUTE, //async compute, a family without graphics
+	TRANSFER,
+	COUNT
+};
+
+//what compiling reads and writes of a node
+struct FrameGraphNodeInfo
+{
+	std::string name; //node name
+	bool shouldExecute = false; //disabled nodes are left out when the graph compiles
+	std::vector<std::string> inputResources;
+	std::vector<std::string> outputResources;
+	//read as the previous frame left them, sampled. not a dependency, so a node may read its own output's history, but their
+	//producer is kept alive and the images get a version per frame so this frame's writes don't touch them
+	std::vector<std::string> historyResources;
+	//image resources it doesn't list here are written as attachments when outputs and sampled when inputs
+	std::unordered_map<std::string, ResourceAccess> access;
+	QueueType queue = QueueType::GRAPHICS;
+
+	//set by Compile, the producer begins the shared render pass and the consumer records its subpass into the same command buffer
+	static constexpr size_t NOT_MERGED = SIZE_MAX;
+	size_t mergedWith = NOT_MERGED; //node index of the other half
+	uint32_t subpass = 0;
+};
+
+namespace FrameGraphCompiler
+{
+	//which of count copies a frame frameOffset frames from frame uses, the copies rotate so the one before frame 0 is the last
+	inline size_t VersionIndex(unsigned long long frame, size_t count, int frameOffset)
+	{
+		long long copies = static_cast<long long>(count);
+		return static_cast<size_t>((static_cast<long long>(frame % count) + frameOffset % copies + copies) % copies);
+	}
+
+	//resolve maps a node's queue to the one it's submitted to
+	//pairs a graphics node with the one producing all of its INPUT_READ images, the producer moves up to just before it
+	//consumers with an input from another queue are left alone so that queue's work keeps overlapping the producer
+	template <typename Node, typename Resolve>
+	void MergeSubpasses(std::vector<Node>& nodes, std::vector<size_t>& schedule, Resolve resolve, size_t& mergeCount)
+	{
+		std::unordered_map<std::string, size_t> producers;
+		for (size_t index : schedule)
+			for (auto& output : nodes[index].outputResources) producers[output] = index;
+
+		for (size_t position = 0; position < schedule.size(); position++)
+		{
+			Node& consumer = nodes[schedule[position]];
+			if (consumer.mergedWith != FrameGraphNodeInfo::NOT_MERGED || resolve(consumer.queue) != QueueType::GRAPHICS) continue;
+
+			//every image read at the same pixel has to come from one producer, written there as an attachment
+			//a consumer waiting on another queue would pull that wait into the producer's submission and stall it, so it stays separate
+			size_t producerIndex = FrameGraphNodeInfo::NOT_MERGED;
+			bool mergeable = true;
+			for (auto& input : consumer.inputResources)
+			{
+				mergeable &= resolve(nodes[producers.at(input)].queue) == QueueType::GRAPHICS;
+
+				auto access = consumer.access.find(input);
+				if (access == consumer.access.end() || access->second != ResourceAccess::INPUT_READ) continue;
+
+				size_t producer = producers.at(input);
+				auto written = nodes[producer].access.find(input);
+				bool attachment = written == nodes[producer].access.end() || written->second == ResourceAccess::COLOR_WRITE || written->second == ResourceAccess::DEPTH_WRITE;
+				mergeable &= attachment && (producerIndex == FrameGraphNodeInfo::NOT_MERGED || producerIndex == producer);
+				producerIndex = producer;
+			}
+			if (!mergeable || producerIndex == FrameGraphNodeInfo::NOT_MERGED) continue;
+
+			Node& producer = nodes[producerIndex];
+			if (producer.mergedWith != FrameGraphNodeInfo::NOT_MERGED || resolve(producer.queue) != QueueType::GRAPHICS) continue;
+
+			//a render pass can't be interrupted, so the producer moves up to the consumer, nothing in between may read what it writes
+			auto producerAt = std::find(schedule.begin(), schedule.end(), producerIndex);
+			bool blocked = false;
+			for (auto between = producerAt + 1; between != schedule.begin() + position; ++between)
+				for (auto& input : nodes[*between].inputResources)
+					blocked |= producers.at(input) == producerIndex;
+			if (blocked) continue;
+
+			schedule.erase(producerAt);
+			schedule.insert(schedule.begin() + position - 1, producerIndex);
+
+			producer.mergedWith = schedule[position];
+			consumer.mergedWith = producerIndex;
+			consumer.subpass = 1;
+			mergeCount++;
+		}
+	}
+
+	//fills schedule with the enabled nodes the sinks depend on, in dependency order, and history with the resources they read last frame's version of
+	//false and an empty schedule on a cycle, a resource produced twice or one nothing produces
+	template <typename Node, typename Resolve>
+	bool Compile(std::vector<Node>& nodes, const std::vector<std::string>& sinks, bool mergeSubpasses, Resolve resolve,
+		std::vector<size_t>& schedule, std::set<std::string>& history, size_t& mergeCount)
+	{
+		schedule.clear();
+		history.clear();
+		mergeCount = 0;
+		for (auto& node : nodes)
+		{
+			node.mergedWith = FrameGraphNodeInfo::NOT_MERGED;
+			node.subpass = 0;
+		}
+
+		//disabled nodes take no part, whatever only they produce is missing
+		std::unordered_map<std::string, size_t> producers;
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (!nodes[i].shouldExecute) continue;
+			for (auto& output : nodes[i].outputResources)
+			{
+				auto [producer, inserted] = producers.emplace(output, i);
+				if (inserted) continue;
+				std::cout << "Error: frame graph resource " << output << " is produced by both " << nodes[producer->second].name << " and " << nodes[i].name << '\n';
+				return false;
+			}
+		}
+
+		//live nodes are the ones a sink depends on, found walking back from the sinks' producers
+		std::vector<bool> live(nodes.size(), false);
+		std::vector<size_t> pending;
+		for (auto& sink : sinks)
+		{
+			auto producer = producers.find(sink);
+			if (producer == producers.end())
+			{
+				std::cout << "Error: no frame graph node produces sink " << sink << '\n';
+				return false;
+			}
+			pending.push_back(producer->second);
+		}
+		if (sinks.empty())
+		{
+			std::cout << "Warning: frame graph has no sinks, nothing is culled\n";
+			for (size_t i = 0; i < nodes.size(); i++)
+				if (nodes[i].shouldExecute) pending.push_back(i);
+		}
+
+		while (!pending.empty())
+		{
+			size_t index = pending.back();
+			pending.pop_back();
+			if (live[index]) continue;
+			live[index] = true;
+
+			//there's no history without its producer, but it ran last frame, so that's no edge for the schedule
+			std::vector<std::string> reads = nodes[index].inputResources;
+			reads.insert(reads.end(), nodes[index].historyResources.begin(), nodes[index].historyResources.end());
+			for (auto& input : reads)
+			{
+				auto producer = producers.find(input);
+				if (producer == producers.end())
+				{
+					std::cout << "Error: frame graph node " << nodes[index].name << " reads " << input << " which no enabled node produces\n";
+					return false;
+				}
+				pending.push_back(producer->second);
+			}
+			history.insert(nodes[index].historyResources.begin(), nodes[index].historyResources.end());
+		}
+
+		//Kahn's algorithm, the lowest ready index goes first so independent nodes keep the order they were added in
+		std::vector<unsigned int> dependencies(nodes.size(), 0);
+		std::vector<std::vector<size_t>> consumers(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (!live[i]) continue;
+			for (auto& input : nodes[i].inputResources)
+			{
+				consumers[producers.at(input)].push_back(i);
+				dependencies[i]++;
+			}
+		}
+
+		std::set<size_t> ready;
+		for (size_t i = 0; i < nodes.size(); i++)
+			if (live[i] && dependencies[i] == 0) ready.insert(i);
+
+		while (!ready.empty())
+		{
+			size_t index = *ready.begin();
+			ready.erase(ready.begin());
+			schedule.push_back(index);
+
+			for (size_t consumer : consumers[index])
+				if (--dependencies[consumer] == 0) ready.insert(consumer);
+		}
+
+		size_t liveCount = std::count(live.begin(), live.end(), true);
+		if (schedule.size() < liveCount)
+		{
+			std::string cycle;
+			for (size_t i = 0; i < nodes.size(); i++)
+				if (live[i] && dependencies[i] > 0) cycle += (cycle.empty() ? "" : ", ") + nodes[i].name;
+			std::cout << "Error: frame graph has a cycle, can't schedule " << cycle << ", nothing executes\n";
+			schedule.clear();
+			return false;
+		}
+
+		for (size_t i = 0; i < nodes.size(); i++)
+			if (nodes[i].shouldExecute && !live[i]) std::cout << "Warning: frame graph node " << nodes[i].name << " feeds no sink and is culled\n";
+
+		if (mergeSubpasses) MergeSubpasses(nodes, schedule, resolve, mergeCount);
+		return true;
+	}
+}
@@ -71962,6 +71962,11 @@ namespace GvkHelper {
 	inline VkResult get_best_gpu(const VkSurfaceKHR& _surface, const uint32_t& _totalDevices, VkPhysicalDevice* _allPhysicalDevices, const uint32_t& _totalDeviceExtensions, const char** _deviceExtensions, uint32_t* outIndex);
 	inline VkResult get_best_queue_family_indices(const VkPhysicalDevice& _physicalDevice, const VkSurfaceKHR& _surface, int** _outIndices, VkBool32* _outCanCompute);
 	inline VkResult get_best_msaa_format(const VkPhysicalDevice& _physicalDevice, const VkSampleCountFlagBits& _idealMSAAFlag, VkSampleCountFlagBits* _outMSAAFlag);
+	/*CUSTOM*/
+	inline VkResult find_dedicated_transfer_queue_family(const VkPhysicalDevice& _physicalDevice, uint32_t* _outIndex);
+	inline VkResult find_dedicated_compute_queue_family(const VkPhysicalDevice& _physicalDevice, uint32_t* _outIndex);
+	inline VkBool32 supports_timeline_semaphores(const VkPhysicalDevice& _physicalDevice);
+	inline VkBool32 supports_synchronization2(const VkPhysicalDevice& _physicalDevice);
 
 	//Command Help
 	inline VkResult signal_command_start(const VkDevice& _device, const VkCommandPool& _commandPool, VkCommandBuffer* _outCommandBuffer);
@@ -72701,6 +72706,88 @@ VkResult get_best_queue_family_indices(const VkPhysicalDevice &_physicalDevice,
 	delete[] queue_family_properties;
 	return VK_RESULT_MAX_ENUM;
 }
+/*CUSTOM*/
+//a family with transfer but neither graphics nor compute, i.e. the copy engine
+VkResult find_dedicated_transfer_queue_family(const VkPhysicalDevice& _physicalDevice, uint32_t* _outIndex)
+{
+	uint32_t count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_family_properties(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &count, queue_family_properties.data());
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		VkQueueFlags flags = queue_family_properties[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && queue_family_properties[i].queueCount)
+		{
+			*_outIndex = i;
+			return VK_SUCCESS;
+		}
+	}
+
+	*_outIndex = VK_QUEUE_FAMILY_IGNORED;
+	return VK_ERROR_FEATURE_NOT_PRESENT;
+}
+/*CUSTOM*/
+//a family with compute but not graphics, work on it can overlap the graphics queue's
+VkResult find_dedicated_compute_queue_family(const VkPhysicalDevice& _physicalDevice, uint32_t* _outIndex)
+{
+	uint32_t count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_family_properties(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &count, queue_family_properties.data());
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		VkQueueFlags flags = queue_family_properties[i].queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && queue_family_properties[i].queueCount)
+		{
+			*_outIndex = i;
+			return VK_SUCCESS;
+		}
+	}
+
+	*_outIndex = VK_QUEUE_FAMILY_IGNORED;
+	return VK_ERROR_FEATURE_NOT_PRESENT;
+}
+/*CUSTOM*/
+//core timeline semaphores need a 1.2 device as well as the feature
+VkBool32 supports_timeline_semaphores(const VkPhysicalDevice& _physicalDevice)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2) return VK_FALSE;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {};
+	timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &timeline_features;
+	vkGetPhysicalDeviceFeatures2(_physicalDevice, &features);
+	return timeline_features.timelineSemaphore;
+}
+/*CUSTOM*/
+//VK_KHR_synchronization2 is an extension on 1.2 devices, the extension and its feature both have to be there
+VkBool32 supports_synchronization2(const VkPhysicalDevice& _physicalDevice)
+{
+	uint32_t extension_count = 0;
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> extensions(extension_count);
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extension_count, extensions.data());
+
+	bool found = false;
+	for (const auto& extension : extensions)
+		if (strcmp(extension.extensionName, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0) found = true;
+	if (!found) return VK_FALSE;
+
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features = {};
+	synchronization2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &synchronization2_features;
+	vkGetPhysicalDeviceFeatures2(_physicalDevice, &features);
+	return synchronization2_features.synchronization2;
+}
 VkResult get_best_msaa_format(const VkPhysicalDevice& _physicalDevice, const VkSampleCountFlagBits&_idealMSAAFlag, VkSampleCountFlagBits *_outMSAAFlag)
 {
 	//Gather all physical device
@@ -74272,7 +74359,7 @@ namespace GW
 				//Application Information (Will come back to this for Gateware Version. Maybe used for RenderDoc)
 				VkApplicationInfo app_info = {};
 				app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-				app_info.apiVersion = VK_API_VERSION_1_1;
+				app_info.apiVersion = VK_API_VERSION_1_2; /*CUSTOM*/ //timeline semaphores
 				app_info.pApplicationName = m_WindowName;
 				app_info.applicationVersion = 1;
 				app_info.pEngineName = "Gateware";
@@ -74348,7 +74435,16 @@ namespace GW
 					qf_createsize = 2;						
 				else										
 					qf_createsize = 1;						
-				VkDeviceQueueCreateInfo* queue_create_info_array = new VkDeviceQueueCreateInfo[qf_createsize];
+
+				/*CUSTOM*/
+				//a queue on the copy engine for async uploads, fetched by the renderer with vkGetDeviceQueue
+				uint32_t transfer_family = VK_QUEUE_FAMILY_IGNORED;
+				GvkHelper::find_dedicated_transfer_queue_family(m_VkPhysicalDevice, &transfer_family);
+				//and one on an async compute family for frame graph nodes that run off the graphics queue
+				uint32_t compute_family = VK_QUEUE_FAMILY_IGNORED;
+				GvkHelper::find_dedicated_compute_queue_family(m_VkPhysicalDevice, &compute_family);
+
+				VkDeviceQueueCreateInfo* queue_create_info_array = new VkDeviceQueueCreateInfo[qf_createsize + 2];
 
 				//Set up Create Info for all unique queue families
 				float priority = 1.0f;
@@ -74362,6 +74458,27 @@ namespace GW
 					queue_create_info_array[i] = create_info;
 				}
 
+				/*CUSTOM*/
+				if (transfer_family != VK_QUEUE_FAMILY_IGNORED) {
+					VkDeviceQueueCreateInfo create_info = {};
+
+					create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+					create_info.queueFamilyIndex = transfer_family;
+					create_info.queueCount = 1;
+					create_info.pQueuePriorities = &priority;
+					queue_create_info_array[qf_createsize++] = create_info;
+				}
+				//a compute family that can present already has its queue
+				if (compute_family != VK_QUEUE_FAMILY_IGNORED && compute_family != static_cast<uint32_t>(m_QueueFamilyIndices[1])) {
+					VkDeviceQueueCreateInfo create_info = {};
+
+					create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+					create_info.queueFamilyIndex = compute_family;
+					create_info.queueCount = 1;
+					create_info.pQueuePriorities = &priority;
+					queue_create_info_array[qf_createsize++] = create_info;
+				}
+
 				//Get all available device features
 				VkPhysicalDeviceFeatures all_device_features;
 				vkGetPhysicalDeviceFeatures(m_VkPhysicalDevice, &all_device_features);
@@ -74403,6 +74520,25 @@ namespace GW
 				create_info.ppEnabledExtensionNames = m_DeviceExtensions;
 				//create_info.pNext = &hostQueryResetFeatures;
 
+				/*CUSTOM*/
+				VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+				timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+				if (GvkHelper::supports_timeline_semaphores(m_VkPhysicalDevice))
+					create_info.pNext = &timelineSemaphoreFeatures;
+
+				/*CUSTOM*/
+				//synchronization2 whenever the device has it, without it the frame graph falls back to vkCmdPipelineBarrier
+				std::vector<const char*> device_extensions(m_DeviceExtensions, m_DeviceExtensions + m_DeviceExtensionCount);
+				VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+				synchronization2Features.synchronization2 = VK_TRUE;
+				if (GvkHelper::supports_synchronization2(m_VkPhysicalDevice)) {
+					device_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+					synchronization2Features.pNext = const_cast<void*>(create_info.pNext);
+					create_info.pNext = &synchronization2Features;
+				}
+				create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+				create_info.ppEnabledExtensionNames = device_extensions.data();
+
 				// add bindless support if requested
 				VkPhysicalDeviceDescriptorIndexingFeaturesEXT physicalDeviceDescriptorIndexingFeatures{};
 				if (m_InitMask & GRAPHICS::BINDLESS_SUPPORT) {
@@ -74411,6 +74547,7 @@ namespace GW
 					physicalDeviceDescriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
 					physicalDeviceDescriptorIndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
 					physicalDeviceDescriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+					physicalDeviceDescriptorIndexingFeatures.pNext = const_cast<void*>(create_info.pNext); /*CUSTOM*/
 					create_info.pNext = &physicalDeviceDescriptorIndexingFeatures;
 				}
 				//Create the Surface (With Results) [VK_SUCCESS = 0]
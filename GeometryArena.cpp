@@ -0,0 +1,221 @@
+#include "pch.h"
+
+bool GeometryArena::Create(MemoryAllocator& allocator, StagingRing& staging, uint32_t vertexCapacity, uint32_t indexCapacity, unsigned int framesInFlight)
+{
+	_allocator = &allocator;
+	_staging = &staging;
+	_framesInFlight = framesInFlight;
+
+	//transfer src as well as dst, compaction copies within the same buffer
+	VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		if (_allocator->CreateBuffer(VERTEX_STRIDES[i] * vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | transfer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vertexBuffers[i], STREAM_NAMES[i]) != VK_SUCCESS) return false;
+	}
+
+	if (_allocator->CreateBuffer(sizeof(unsigned int) * indexCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transfer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _indexBuffer, "Geometry Arena: Indices") != VK_SUCCESS) return false;
+
+	_vertices.Reset(vertexCapacity);
+	_indices.Reset(indexCapacity);
+	return true;
+}
+
+void GeometryArena::Destroy()
+{
+	if (!IsCreated()) return;
+
+	for (unsigned int i = 0; i < 4; i++) _allocator->DestroyBuffer(_vertexBuffers[i]);
+	_allocator->DestroyBuffer(_indexBuffer);
+
+	for (auto& moves : _moves) moves.clear();
+	_meshes.clear();
+	_retired.clear();
+	_draws.clear();
+	_pendingMeshes = 0;
+	_completedValue = 0;
+	_allocator = nullptr;
+	_staging = nullptr;
+}
+
+unsigned int GeometryArena::AddMesh(const GeometryData& data, const std::vector<DrawInfo>& draws)
+{
+	ArenaMesh mesh;
+	mesh.vertexCount = data.positions.size();
+	mesh.indexCount = data.indices.size();
+	mesh.draws = draws;
+
+	if (!_vertices.Allocate(mesh.vertexCount, mesh.vertexOffset)) return 0;
+	if (!_indices.Allocate(mesh.indexCount, mesh.indexOffset))
+	{
+		_vertices.Release(mesh.vertexOffset, mesh.vertexCount);
+		return 0;
+	}
+
+	//fresh ranges were never handed to the gpu since their last retirement, so they can be written straight away
+	const void* streams[4] = { data.positions.data(), data.normals.data(), data.texCoords.data(), data.tangents.data() };
+	for (unsigned int i = 0; i < 4; i++)
+		mesh.uploadValue = std::max(mesh.uploadValue, _staging->Upload(_vertexBuffers[i].buffer, VERTEX_STRIDES[i] * mesh.vertexOffset, streams[i], VERTEX_STRIDES[i] * mesh.vertexCount));
+	mesh.uploadValue = std::max(mesh.uploadValue, _staging->Upload(_indexBuffer.buffer, sizeof(unsigned int) * mesh.indexOffset, data.indices.data(), sizeof(unsigned int) * mesh.indexCount));
+	if (!IsReady(mesh)) _pendingMeshes++;
+
+	unsigned int id = _nextMeshId++;
+	_meshes[id] = std::move(mesh);
+	_changedThisFrame = true;
+	_drawsDirty = true;
+	return id;
+}
+
+void GeometryArena::RemoveMesh(unsigned int id)
+{
+	auto it = _meshes.find(id);
+	if (it == _meshes.end()) return;
+
+	Retire(_vertices, it->second.vertexOffset, it->second.vertexCount, it->second.uploadValue);
+	Retire(_indices, it->second.indexOffset, it->second.indexCount, it->second.uploadValue);
+	_meshes.erase(it);
+	_changedThisFrame = true;
+	_drawsDirty = true;
+}
+
+void GeometryArena::Retire(RangeAllocator& allocator, uint32_t offset, uint32_t count, uint64_t uploadValue)
+{
+	_retired.push_back({ &allocator, offset, count, _frame, uploadValue });
+}
+
+void GeometryArena::BeginFrame()
+{
+	_frame++;
+
+	uint64_t completedValue = _staging->GetCompletedValue();
+	if (completedValue != _completedValue && _pendingMeshes)
+	{
+		_pendingMeshes = 0;
+		for (auto& [id, mesh] : _meshes) _pendingMeshes += mesh.uploadValue > completedValue;
+		_drawsDirty = true;
+	}
+	_completedValue = completedValue;
+
+	for (size_t i = 0; i < _retired.size();)
+	{
+		if (_frame >= _retired[i].frame + _framesInFlight && _retired[i].uploadValue <= _completedValue)
+		{
+			_retired[i].allocator->Release(_retired[i].offset, _retired[i].count);
+			_retired[i] = _retired.back();
+			_retired.pop_back();
+		}
+		else i++;
+	}
+
+	if (!_changedThisFrame) Compact(COMPACTION_BUDGET);
+	_changedThisFrame = false;
+}
+
+VkDeviceSize GeometryArena::MoveVertices(ArenaMesh& mesh, uint32_t newOffset)
+{
+	VkDeviceSize moved = 0;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		_moves[i].push_back({ VERTEX_STRIDES[i] * mesh.vertexOffset, VERTEX_STRIDES[i] * newOffset, VERTEX_STRIDES[i] * mesh.vertexCount });
+		moved += VERTEX_STRIDES[i] * mesh.vertexCount;
+	}
+
+	Retire(_vertices, mesh.vertexOffset, mesh.vertexCount);
+	mesh.vertexOffset = newOffset;
+	return moved;
+}
+
+VkDeviceSize GeometryArena::MoveIndices(ArenaMesh& mesh, uint32_t newOffset)
+{
+	_moves[4].push_back({ sizeof(unsigned int) * mesh.indexOffset, sizeof(unsigned int) * newOffset, sizeof(unsigned int) * mesh.indexCount });
+
+	Retire(_indices, mesh.indexOffset, mesh.indexCount);
+	mesh.indexOffset = newOffset;
+	return sizeof(unsigned int) * mesh.indexCount;
+}
+
+//slides the highest meshes into holes further down, old ranges are retired rather than freed so in-flight frames keep reading valid data
+//the copies themselves happen on the gpu in RecordCopies
+void GeometryArena::Compact(VkDeviceSize budget)
+{
+	if (_vertices.GetFreeRangeCount() <= 1 && _indices.GetFreeRangeCount() <= 1) return;
+
+	std::vector<ArenaMesh*> meshes;
+	//meshes still being uploaded stay put, a gpu move could race the transfer queue's write
+	for (auto& mesh : _meshes) if (IsReady(mesh.second)) meshes.push_back(&mesh.second);
+
+	VkDeviceSize moved = 0;
+
+	std::sort(meshes.begin(), meshes.end(), [](const ArenaMesh* a, const ArenaMesh* b) { return a->vertexOffset > b->vertexOffset; });
+	for (auto mesh : meshes)
+	{
+		if (moved >= budget) break;
+
+		uint32_t offset;
+		if (_vertices.Allocate(mesh->vertexCount, offset, mesh->vertexOffset))
+		{
+			moved += MoveVertices(*mesh, offset);
+			_drawsDirty = true;
+		}
+	}
+
+	std::sort(meshes.begin(), meshes.end(), [](const ArenaMesh* a, const ArenaMesh* b) { return a->indexOffset > b->indexOffset; });
+	for (auto mesh : meshes)
+	{
+		if (moved >= budget) break;
+
+		uint32_t offset;
+		if (_indices.Allocate(mesh->indexCount, offset, mesh->indexOffset))
+		{
+			moved += MoveIndices(*mesh, offset);
+			_drawsDirty = true;
+		}
+	}
+}
+
+//sources are live ranges and destinations were free, and vacated ranges are retired rather than reused, so no two regions overlap
+void GeometryArena::RecordCopies(VkCommandBuffer commandBuffer)
+{
+	bool recorded = false;
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		if (_moves[i].empty()) continue;
+
+		VkBuffer buffer = i < 4 ? _vertexBuffers[i].buffer : _indexBuffer.buffer;
+		vkCmdCopyBuffer(commandBuffer, buffer, buffer, _moves[i].size(), _moves[i].data());
+		_moves[i].clear();
+		recorded = true;
+	}
+	if (!recorded) return;
+
+	VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+const std::vector<DrawInfo>& GeometryArena::GetDraws()
+{
+	if (!_drawsDirty) return _draws;
+
+	_draws.clear();
+	for (auto& [id, mesh] : _meshes)
+	{
+		if (!IsReady(mesh)) continue;
+		for (DrawInfo di : mesh.draws)
+		{
+			di.firstIdx += mesh.indexOffset;
+			di.vertexOffset += mesh.vertexOffset;
+			_draws.push_back(di);
+		}
+	}
+
+	_drawsDirty = false;
+	return _draws;
+}
+
+VkDeviceSize GeometryArena::GetUsedBytes() const
+{
+	VkDeviceSize vertexStride = 0;
+	for (auto stride : VERTEX_STRIDES) vertexStride += stride;
+	return vertexStride * _vertices.GetUsed() + sizeof(unsigned int) * _indices.GetUsed();
+}
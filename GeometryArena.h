@@ -0,0 +1,81 @@
+#pragma once
+
+struct ArenaMesh
+{
+	uint32_t vertexOffset = 0, vertexCount = 0;
+	uint32_t indexOffset = 0, indexCount = 0;
+	std::vector<DrawInfo> draws; //relative to the mesh's own ranges
+	uint64_t uploadValue = 0; //staging timeline value the data is usable from, the mesh is not drawn before
+};
+
+//fixed-capacity vertex/index heaps that meshes are added to and removed from at runtime
+//buffers never get recreated, so the frame graph resources pointing at them stay valid
+//the heaps are device local, uploads go through the staging ring and compaction is done with gpu copies
+class GeometryArena
+{
+	struct RetiredRange
+	{
+		RangeAllocator* allocator;
+		uint32_t offset, count;
+		uint64_t frame;
+		uint64_t uploadValue; //an async upload may still be writing the range
+	};
+
+	MemoryAllocator* _allocator = nullptr;
+	StagingRing* _staging = nullptr;
+	Buffer _vertexBuffers[4] = {};
+	Buffer _indexBuffer = {};
+
+	//compaction moves waiting to be recorded, one list per vertex stream plus the index buffer
+	std::vector<VkBufferCopy> _moves[5];
+
+	RangeAllocator _vertices, _indices;
+	std::unordered_map<unsigned int, ArenaMesh> _meshes;
+	unsigned int _nextMeshId = 1;
+
+	//ranges stay reserved until every frame that could still be reading them has finished
+	std::vector<RetiredRange> _retired;
+	uint64_t _frame = 0;
+	unsigned int _framesInFlight = 1;
+	bool _changedThisFrame = false;
+
+	std::vector<DrawInfo> _draws;
+	bool _drawsDirty = true;
+
+	//meshes still waiting on their upload, the draw list is rebuilt as they become ready
+	size_t _pendingMeshes = 0;
+	uint64_t _completedValue = 0;
+
+	bool IsReady(const ArenaMesh& mesh) const { return mesh.uploadValue <= _completedValue; }
+	void Retire(RangeAllocator& allocator, uint32_t offset, uint32_t count, uint64_t uploadValue = 0);
+	VkDeviceSize MoveVertices(ArenaMesh& mesh, uint32_t newOffset);
+	VkDeviceSize MoveIndices(ArenaMesh& mesh, uint32_t newOffset);
+
+public:
+	static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1 << 20;
+	static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1 << 22;
+	static constexpr VkDeviceSize COMPACTION_BUDGET = 4 << 20; //bytes moved per idle frame
+	static constexpr VkDeviceSize VERTEX_STRIDES[4] = { sizeof(vec3), sizeof(vec3), sizeof(vec2), sizeof(vec4) };
+	static constexpr const char* STREAM_NAMES[4] = { "Geometry Arena: Positions", "Geometry Arena: Normals", "Geometry Arena: TexCoords", "Geometry Arena: Tangents" };
+
+	bool Create(MemoryAllocator& allocator, StagingRing& staging, uint32_t vertexCapacity, uint32_t indexCapacity, unsigned int framesInFlight);
+	void Destroy();
+	bool IsCreated() const { return _allocator != nullptr; }
+
+	//returns 0 if either heap has no room, with async uploads the mesh is drawn once its data has arrived
+	unsigned int AddMesh(const GeometryData& data, const std::vector<DrawInfo>& draws);
+	void RemoveMesh(unsigned int id);
+
+	//call once per frame after the frame's fence wait, recycles retired ranges and compacts when nothing changed
+	void BeginFrame();
+	void Compact(VkDeviceSize budget);
+	//records the compaction copies queued since the last call, after the staging ring's flush
+	void RecordCopies(VkCommandBuffer commandBuffer);
+
+	const std::vector<DrawInfo>& GetDraws();
+	const Buffer& GetVertexBuffer(unsigned int stream) const { return _vertexBuffers[stream]; }
+	const Buffer& GetIndexBuffer() const { return _indexBuffer; }
+	const RangeAllocator& GetVertexHeap() const { return _vertices; }
+	const RangeAllocator& GetIndexHeap() const { return _indices; }
+	VkDeviceSize GetUsedBytes() const;
+};
@@ -0,0 +1,433 @@
+#include "pch.h"
+
+bool MemoryAllocator::Create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+	_physicalDevice = physicalDevice;
+	_device = device;
+
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	//only queried through vkGetPhysicalDeviceMemoryProperties2, so being supported is enough
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, extensions.data());
+	_hasBudgetExtension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) { return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; });
+
+	//small heaps (e.g. the 256MB host visible device local window) get smaller blocks so one block can't take most of it
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+	{
+		VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[i].heapIndex].size;
+		_blockSizes[i] = std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1 << 20));
+	}
+
+	return true;
+}
+
+void MemoryAllocator::Destroy()
+{
+	if (!IsCreated()) return;
+
+	uint32_t leaked = 0;
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+	{
+		for (auto& pool : _blocks[i])
+		{
+			for (auto& block : pool)
+			{
+				leaked += block->allocator.GetAllocationCount();
+				FreeDeviceMemory(block->memory, block->mapped);
+			}
+			pool.clear();
+		}
+		leaked += _dedicatedStats[i].allocations;
+		_dedicatedStats[i] = {};
+	}
+	for (auto& [memory, mapped] : _dedicated) FreeDeviceMemory(memory, mapped);
+	_dedicated.clear();
+
+	if (leaked)
+	{
+		std::cout << "Warning: " << leaked << " allocations were still alive when the memory allocator was destroyed\n";
+		for (auto& usage : _owners)
+			if (usage.allocations) std::cout << "  " << usage.owner << ": " << usage.allocations << " allocations, " << usage.bytes << " bytes\n";
+	}
+	_owners.clear();
+	_ownerIndices.clear();
+	_sharedFamilies.clear();
+	_device = VK_NULL_HANDLE;
+}
+
+VkResult MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* next, VkDeviceMemory& memory, uint8_t*& mapped)
+{
+	if (_deviceAllocationCount >= _maxAllocationCount) std::cout << "Warning: exceeding maxMemoryAllocationCount (" << _maxAllocationCount << ")\n";
+
+	VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	memoryAllocateInfo.pNext = next;
+	memoryAllocateInfo.allocationSize = size;
+	memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+	VkResult result = vkAllocateMemory(_device, &memoryAllocateInfo, nullptr, &memory);
+	if (result != VK_SUCCESS) return result;
+	_deviceAllocationCount++;
+
+	mapped = nullptr;
+	if (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&mapped));
+		if (result != VK_SUCCESS)
+		{
+			FreeDeviceMemory(memory, false);
+			return result;
+		}
+	}
+	return VK_SUCCESS;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, bool mapped)
+{
+	if (mapped) vkUnmapMemory(_device, memory);
+	vkFreeMemory(_device, memory, nullptr);
+	_deviceAllocationCount--;
+}
+
+VkResult MemoryAllocator::AllocateFromBlocks(const VkMemoryRequirements& requirements, uint32_t memoryType, bool linear, Allocation& out)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& pool = _blocks[memoryType][linear];
+
+	MemoryBlock* block = nullptr;
+	TlsfAllocator::Node* node = nullptr;
+	for (auto& candidate : pool)
+	{
+		node = candidate->allocator.Allocate(requirements.size, requirements.alignment);
+		if (node)
+		{
+			block = candidate.get();
+			break;
+		}
+	}
+
+	if (!node)
+	{
+		auto newBlock = std::make_unique<MemoryBlock>();
+		VkDeviceSize size = std::max(_blockSizes[memoryType], requirements.size);
+		VkResult result = AllocateDeviceMemory(size, memoryType, nullptr, newBlock->memory, newBlock->mapped);
+		if (result != VK_SUCCESS) return result;
+
+		newBlock->allocator.Reset(size);
+		node = newBlock->allocator.Allocate(requirements.size, requirements.alignment);
+		block = newBlock.get();
+		pool.push_back(std::move(newBlock));
+	}
+
+	out.memory = block->memory;
+	out.offset = node->offset;
+	out.size = node->size;
+	out.mapped = block->mapped ? block->mapped + node->offset : nullptr;
+	out.memoryType = memoryType;
+	out.block = block;
+	out.node = node;
+	return VK_SUCCESS;
+}
+
+VkResult MemoryAllocator::AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType, VkBuffer buffer, VkImage image, Allocation& out)
+{
+	VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+	dedicatedAllocateInfo.buffer = buffer;
+	dedicatedAllocateInfo.image = image;
+	bool hasResource = buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	VkResult result = AllocateDeviceMemory(requirements.size, memoryType, hasResource ? &dedicatedAllocateInfo : nullptr, out.memory, out.mapped);
+	if (result != VK_SUCCESS) return result;
+
+	out.offset = 0;
+	out.size = requirements.size;
+	out.memoryType = memoryType;
+	out.block = nullptr;
+	out.node = nullptr;
+
+	_dedicated[out.memory] = out.mapped != nullptr;
+	_dedicatedStats[memoryType].dedicated++;
+	_dedicatedStats[memoryType].allocations++;
+	_dedicatedStats[memoryType].reserved += requirements.size;
+	_dedicatedStats[memoryType].used += requirements.size;
+	return VK_SUCCESS;
+}
+
+VkResult MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, bool dedicated, VkBuffer buffer, VkImage image, const std::string& owner, Allocation& out)
+{
+	//every type that fits is tried in order, so a full heap falls through to the next one
+	VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+	{
+		if (!(requirements.memoryTypeBits & (1u << i))) continue;
+		if ((_memoryProperties.memoryTypes[i].propertyFlags & properties) != properties) continue;
+
+		bool ownMemory = dedicated || requirements.size > _blockSizes[i] / 2;
+		result = ownMemory ? AllocateDedicated(requirements, i, buffer, image, out) : AllocateFromBlocks(requirements, i, linear, out);
+		if (result == VK_SUCCESS)
+		{
+			TrackOwner(owner, out);
+			return result;
+		}
+	}
+	return result;
+}
+
+VkResult MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, const std::string& owner, Allocation& out)
+{
+	return Allocate(requirements, properties, linear, false, VK_NULL_HANDLE, VK_NULL_HANDLE, owner, out);
+}
+
+void MemoryAllocator::TrackOwner(const std::string& owner, Allocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint32_t heap = _memoryProperties.memoryTypes[allocation.memoryType].heapIndex;
+
+	auto [it, inserted] = _ownerIndices.try_emplace({ owner, heap }, uint32_t(_owners.size()));
+	if (inserted) _owners.push_back({ owner, heap });
+
+	allocation.owner = it->second;
+	_owners[allocation.owner].allocations++;
+	_owners[allocation.owner].bytes += allocation.size;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE) return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (allocation.owner < _owners.size())
+	{
+		_owners[allocation.owner].allocations--;
+		_owners[allocation.owner].bytes -= allocation.size;
+	}
+
+	if (!allocation.block)
+	{
+		MemoryTypeStats& stats = _dedicatedStats[allocation.memoryType];
+		stats.dedicated--;
+		stats.allocations--;
+		stats.reserved -= allocation.size;
+		stats.used -= allocation.size;
+		_dedicated.erase(allocation.memory);
+		FreeDeviceMemory(allocation.memory, allocation.mapped);
+		allocation = {};
+		return;
+	}
+
+	MemoryBlock* block = allocation.block;
+	uint32_t memoryType = allocation.memoryType;
+	block->allocator.Free(allocation.node);
+	allocation = {};
+
+	//one empty block per pool is kept around so a load/unload loop doesn't thrash vkAllocateMemory
+	if (!block->allocator.IsEmpty()) return;
+	for (auto& pool : _blocks[memoryType])
+	{
+		auto it = std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; });
+		if (it == pool.end()) continue;
+
+		bool otherEmpty = std::any_of(pool.begin(), pool.end(), [block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() != block && candidate->allocator.IsEmpty(); });
+		if (otherEmpty)
+		{
+			FreeDeviceMemory(block->memory, block->mapped);
+			pool.erase(it);
+		}
+		return;
+	}
+}
+
+void MemoryAllocator::SetSharedQueueFamilies(const std::vector<uint32_t>& families)
+{
+	_sharedFamilies.clear();
+	for (uint32_t family : families)
+		if (std::find(_sharedFamilies.begin(), _sharedFamilies.end(), family) == _sharedFamilies.end()) _sharedFamilies.push_back(family);
+}
+
+VkResult MemoryAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& out, const std::string& owner, bool dedicated)
+{
+	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if ((usage & (VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)) && _sharedFamilies.size() > 1)
+	{
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(_sharedFamilies.size());
+		bufferCreateInfo.pQueueFamilyIndices = _sharedFamilies.data();
+	}
+
+	VkResult result = vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &out.buffer);
+	if (result != VK_SUCCESS) return result;
+
+	VkBufferMemoryRequirementsInfo2 requirementsInfo = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.buffer = out.buffer;
+	VkMemoryDedicatedRequirements dedicatedRequirements = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 requirements = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	requirements.pNext = &dedicatedRequirements;
+	vkGetBufferMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+	dedicated |= dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+	result = Allocate(requirements.memoryRequirements, properties, true, dedicated, out.buffer, VK_NULL_HANDLE, owner, out.allocation);
+	if (result == VK_SUCCESS) result = vkBindBufferMemory(_device, out.buffer, out.allocation.memory, out.allocation.offset);
+
+	if (result != VK_SUCCESS) DestroyBuffer(out);
+	return result;
+}
+
+VkResult MemoryAllocator::CreateImage(const VkExtent3D& extent, uint32_t mipLevels, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, Image& out, const std::string& owner, bool dedicated)
+{
+	VkImageCreateInfo imageCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.extent = extent;
+	imageCreateInfo.mipLevels = mipLevels;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.format = format;
+	imageCreateInfo.tiling = tiling;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.usage = usage;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.samples = samples;
+
+	out.imageView = VK_NULL_HANDLE;
+	VkResult result = vkCreateImage(_device, &imageCreateInfo, nullptr, &out.image);
+	if (result != VK_SUCCESS) return result;
+
+	VkImageMemoryRequirementsInfo2 requirementsInfo = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.image = out.image;
+	VkMemoryDedicatedRequirements dedicatedRequirements = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 requirements = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	requirements.pNext = &dedicatedRequirements;
+	vkGetImageMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+	dedicated |= dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+	result = Allocate(requirements.memoryRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR, dedicated, VK_NULL_HANDLE, out.image, owner, out.allocation);
+	if (result == VK_SUCCESS) result = vkBindImageMemory(_device, out.image, out.allocation.memory, out.allocation.offset);
+
+	if (result != VK_SUCCESS) DestroyImage(out);
+	return result;
+}
+
+void MemoryAllocator::DestroyBuffer(Buffer& buffer)
+{
+	if (buffer.buffer) vkDestroyBuffer(_device, buffer.buffer, nullptr);
+	Free(buffer.allocation);
+	buffer.buffer = VK_NULL_HANDLE;
+}
+
+void MemoryAllocator::DestroyImage(Image& image)
+{
+	if (image.imageView) vkDestroyImageView(_device, image.imageView, nullptr);
+	if (image.image) vkDestroyImage(_device, image.image, nullptr);
+	Free(image.allocation);
+	image.image = VK_NULL_HANDLE;
+	image.imageView = VK_NULL_HANDLE;
+}
+
+std::vector<MemoryTypeStats> MemoryAllocator::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<MemoryTypeStats> stats(_memoryProperties.memoryTypeCount);
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+	{
+		stats[i] = _dedicatedStats[i];
+		for (auto& pool : _blocks[i])
+		{
+			for (auto& block : pool)
+			{
+				stats[i].blocks++;
+				stats[i].allocations += block->allocator.GetAllocationCount();
+				stats[i].reserved += block->allocator.GetSize();
+				stats[i].used += block->allocator.GetUsed();
+			}
+		}
+	}
+	return stats;
+}
+
+void MemoryAllocator::PrintStats() const
+{
+	std::vector<MemoryTypeStats> stats = GetStats();
+	for (uint32_t i = 0; i < stats.size(); i++)
+	{
+		if (!stats[i].reserved) continue;
+
+		VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[i].propertyFlags;
+		std::cout << "Memory type " << i
+			<< ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? " device local" : "")
+			<< ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? " host visible" : "")
+			<< ": " << stats[i].allocations - stats[i].dedicated << " allocations in " << stats[i].blocks << " blocks, " << stats[i].dedicated << " dedicated, "
+			<< stats[i].used / (1024.f * 1024.f) << "/" << stats[i].reserved / (1024.f * 1024.f) << "MB used\n";
+	}
+	std::cout << _deviceAllocationCount << " device allocations of " << _maxAllocationCount << " allowed\n";
+}
+
+std::vector<HeapBudget> MemoryAllocator::GetBudgets() const
+{
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+	VkPhysicalDeviceMemoryProperties2 memoryProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+	if (_hasBudgetExtension)
+	{
+		memoryProperties.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &memoryProperties);
+	}
+
+	std::vector<HeapBudget> budgets(_memoryProperties.memoryHeapCount);
+	std::vector<MemoryTypeStats> stats = GetStats();
+	for (uint32_t i = 0; i < stats.size(); i++)
+	{
+		HeapBudget& budget = budgets[_memoryProperties.memoryTypes[i].heapIndex];
+		budget.reserved += stats[i].reserved;
+		budget.used += stats[i].used;
+	}
+
+	for (uint32_t i = 0; i < budgets.size(); i++)
+	{
+		budgets[i].deviceLocal = _memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+		budgets[i].size = _memoryProperties.memoryHeaps[i].size;
+		budgets[i].budget = _hasBudgetExtension ? budgetProperties.heapBudget[i] : budgets[i].size;
+		budgets[i].usage = _hasBudgetExtension ? budgetProperties.heapUsage[i] : budgets[i].reserved;
+	}
+	return budgets;
+}
+
+std::vector<OwnerUsage> MemoryAllocator::GetOwnerUsage() const
+{
+	std::vector<OwnerUsage> owners;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::copy_if(_owners.begin(), _owners.end(), std::back_inserter(owners), [](const OwnerUsage& usage) { return usage.allocations > 0; });
+	}
+
+	std::sort(owners.begin(), owners.end(), [](const OwnerUsage& a, const OwnerUsage& b) { return a.bytes > b.bytes; });
+	return owners;
+}
+
+nlohmann::json MemoryAllocator::GetReport() const
+{
+	nlohmann::json report;
+	report["budgetExtension"] = _hasBudgetExtension;
+	report["deviceAllocations"] = _deviceAllocationCount;
+
+	report["heaps"] = nlohmann::json::array();
+	std::vector<HeapBudget> budgets = GetBudgets();
+	for (uint32_t i = 0; i < budgets.size(); i++)
+	{
+		report["heaps"].push_back({ { "heap", i }, { "deviceLocal", budgets[i].deviceLocal }, { "size", budgets[i].size }, { "budget", budgets[i].budget },
+			{ "usage", budgets[i].usage }, { "reserved", budgets[i].reserved }, { "used", budgets[i].used } });
+	}
+
+	report["owners"] = nlohmann::json::array();
+	for (auto& usage : GetOwnerUsage())
+		report["owners"].push_back({ { "owner", usage.owner }, { "heap", usage.heap }, { "allocations", usage.allocations }, { "bytes", usage.bytes } });
+
+	return report;
+}
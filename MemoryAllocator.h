@@ -0,0 +1,113 @@
+#pragma once
+
+//one vkAllocateMemory that many resources are placed in
+struct MemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint8_t* mapped = nullptr;
+	TlsfAllocator allocator;
+};
+
+//a range inside a block, or a whole dedicated VkDeviceMemory when block is null
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0, size = 0;
+	uint8_t* mapped = nullptr; //already offset, null unless the memory is host visible
+	uint32_t memoryType = 0;
+	MemoryBlock* block = nullptr;
+	TlsfAllocator::Node* node = nullptr;
+	uint32_t owner = UINT32_MAX; //index of the owner tag's usage entry
+};
+
+struct MemoryTypeStats
+{
+	uint32_t blocks = 0, dedicated = 0, allocations = 0;
+	VkDeviceSize reserved = 0, used = 0; //reserved is what vkAllocateMemory handed out, used is what resources occupy
+};
+
+//what one owner tag holds in one heap
+struct OwnerUsage
+{
+	std::string owner;
+	uint32_t heap = 0;
+	uint32_t allocations = 0;
+	VkDeviceSize bytes = 0;
+};
+
+struct HeapBudget
+{
+	bool deviceLocal = false;
+	VkDeviceSize size = 0;
+	VkDeviceSize budget = 0; //VK_EXT_memory_budget's estimate of what the process can use, the heap size without it
+	VkDeviceSize usage = 0; //whole process usage from the driver, this allocator's reservations without the extension
+	VkDeviceSize reserved = 0, used = 0; //this allocator's share, as in MemoryTypeStats
+};
+
+struct Buffer;
+struct Image;
+
+//routes every buffer and image allocation through a handful of large per memory type blocks
+//host visible memory is mapped once when the block is created and stays mapped
+class MemoryAllocator
+{
+	VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+	VkDevice _device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties _memoryProperties = {};
+	VkDeviceSize _blockSizes[VK_MAX_MEMORY_TYPES] = {};
+	uint32_t _maxAllocationCount = 0, _deviceAllocationCount = 0;
+
+	//[memory type][linear], buffers and optimal images never share a block so bufferImageGranularity never applies
+	std::vector<std::unique_ptr<MemoryBlock>> _blocks[VK_MAX_MEMORY_TYPES][2];
+	MemoryTypeStats _dedicatedStats[VK_MAX_MEMORY_TYPES] = {};
+	std::unordered_map<VkDeviceMemory, bool> _dedicated; //live dedicated memory -> mapped, Destroy frees what its owners didn't
+	mutable std::mutex _mutex;
+	std::vector<uint32_t> _sharedFamilies; //distinct, buffers written on one queue and read on another are created concurrent
+	bool _hasBudgetExtension = false;
+
+	//one entry per (owner, heap), never removed so allocations can keep an index into it
+	std::vector<OwnerUsage> _owners;
+	std::map<std::pair<std::string, uint32_t>, uint32_t> _ownerIndices;
+
+	VkResult AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* next, VkDeviceMemory& memory, uint8_t*& mapped);
+	void FreeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	VkResult AllocateFromBlocks(const VkMemoryRequirements& requirements, uint32_t memoryType, bool linear, Allocation& out);
+	VkResult AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType, VkBuffer buffer, VkImage image, Allocation& out);
+	VkResult Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, bool dedicated, VkBuffer buffer, VkImage image, const std::string& owner, Allocation& out);
+	void TrackOwner(const std::string& owner, Allocation& allocation);
+
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+	bool Create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	void Destroy();
+	bool IsCreated() const { return _device != VK_NULL_HANDLE; }
+	//transfer destination and uniform buffers are shared between these families without ownership transfers, e.g. uploads from
+	//the transfer queue and uniforms read by async compute. repeated families are dropped, nothing changes until there are two
+	void SetSharedQueueFamilies(const std::vector<uint32_t>& families);
+
+	//owner tags what the memory is reported under, e.g. the frame graph resource name
+	//dedicated gives the resource its own VkDeviceMemory, meant for render targets, large requests and drivers that ask for it get one anyway
+	VkResult CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& out, const std::string& owner, bool dedicated = false);
+	VkResult CreateImage(const VkExtent3D& extent, uint32_t mipLevels, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, Image& out, const std::string& owner, bool dedicated = false);
+	void DestroyBuffer(Buffer& buffer);
+	//also destroys the image view if there is one
+	void DestroyImage(Image& image);
+
+	//raw memory for anything that binds itself
+	VkResult Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, const std::string& owner, Allocation& out);
+	void Free(Allocation& allocation);
+
+	const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return _memoryProperties; }
+	std::vector<MemoryTypeStats> GetStats() const;
+	uint32_t GetDeviceAllocationCount() const { return _deviceAllocationCount; }
+	void PrintStats() const;
+
+	bool HasBudgetExtension() const { return _hasBudgetExtension; }
+	//queries the driver every call, cheap enough for once a frame
+	std::vector<HeapBudget> GetBudgets() const;
+	//live owners only, largest first
+	std::vector<OwnerUsage> GetOwnerUsage() const;
+	//heaps against budget plus the owner breakdown
+	nlohmann::json GetReport() const;
+};
@@ -0,0 +1,551 @@
+#pragma once
+
+// Cooked geometry codec, shared between the Cooker (encode) and the renderer (decode)
+// indices: per-block delta + zigzag + LEB128 varint
+// vertices: per-component delta + zigzag at the component's width -> split into byte planes -> 16-byte groups bit-packed at 0/2/4/8 bits
+// Streams are cut into independent blocks so decoding can fan out across load worker threads.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+//define MESHCODEC_NO_SIMD to force the scalar decoder
+#if !defined(MESHCODEC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MESHCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace MeshCodec
+{
+	constexpr uint32_t VERTEX_BLOCK_ELEMENTS = 16384;
+	constexpr uint32_t INDEX_BLOCK_ELEMENTS = 65536;
+	constexpr uint32_t GROUP_SIZE = 16;
+	constexpr uint32_t MAX_ELEMENT_SIZE = 64;
+	constexpr uint32_t TILE_ELEMENTS = 256; //decoded at a time, a tile's planes and columns stay in L1 on their way to the output
+
+	//stream layout: header, blockSizes[blockCount], block data...
+	struct StreamHeader
+	{
+		uint32_t count = 0;
+		uint32_t elementSize = 0;
+		uint32_t componentSize = 0; //1 or 2 for vertex streams, the delta is taken at this width
+		uint32_t blockCount = 0;
+	};
+
+	namespace detail
+	{
+		inline void Append(std::vector<uint8_t>& out, const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			out.insert(out.end(), bytes, bytes + size);
+		}
+
+		inline uint8_t ZigZag8(uint8_t delta) { return uint8_t((delta << 1) ^ (int8_t(delta) >> 7)); }
+		inline uint8_t UnZigZag8(uint8_t z) { return uint8_t((z >> 1) ^ -(z & 1)); }
+		inline uint16_t ZigZag16(uint16_t delta) { return uint16_t((delta << 1) ^ (int16_t(delta) >> 15)); }
+		inline uint16_t UnZigZag16(uint16_t z) { return uint16_t((z >> 1) ^ -(z & 1)); }
+		inline uint32_t ZigZag32(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+		inline int32_t UnZigZag32(uint32_t z) { return int32_t(z >> 1) ^ -int32_t(z & 1); }
+
+		inline int GroupWidth(const uint8_t* group)
+		{
+			uint8_t max = 0;
+			for (uint32_t i = 0; i < GROUP_SIZE; i++) max = group[i] > max ? group[i] : max;
+			return max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+		}
+
+		//width code 0/1/2/3 = 0/2/4/8 bits, value j and j+8 share a byte at 4 bits, j/j+4/j+8/j+12 at 2 bits
+		inline void PackGroup(const uint8_t* group, int code, std::vector<uint8_t>& out)
+		{
+			if (code == 1)
+			{
+				for (int j = 0; j < 4; j++) out.push_back(uint8_t(group[j] | group[j + 4] << 2 | group[j + 8] << 4 | group[j + 12] << 6));
+			}
+			else if (code == 2)
+			{
+				for (int j = 0; j < 8; j++) out.push_back(uint8_t(group[j] | group[j + 8] << 4));
+			}
+			else if (code == 3)
+			{
+				Append(out, group, GROUP_SIZE);
+			}
+		}
+
+		//plane is padded with zeros to a multiple of GROUP_SIZE
+		inline void EncodePlane(const uint8_t* plane, uint32_t count, std::vector<uint8_t>& out)
+		{
+			uint32_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+			size_t headerStart = out.size();
+			out.resize(headerStart + (groupCount + 3) / 4, 0);
+
+			for (uint32_t g = 0; g < groupCount; g++)
+			{
+				const uint8_t* group = plane + g * GROUP_SIZE;
+				int code = GroupWidth(group);
+				out[headerStart + g / 4] |= uint8_t(code << ((g % 4) * 2));
+				PackGroup(group, code, out);
+			}
+		}
+
+		//payload bytes of the four groups a header byte describes
+		struct PayloadTable
+		{
+			uint16_t sizes[256] = {};
+			constexpr PayloadTable()
+			{
+				constexpr uint8_t payloadSize[4] = { 0, 4, 8, 16 };
+				for (int h = 0; h < 256; h++)
+					for (int g = 0; g < 4; g++) sizes[h] += payloadSize[(h >> (g * 2)) & 3];
+			}
+		};
+		inline constexpr PayloadTable PAYLOAD_SIZES;
+
+		//a plane's payload bytes from its group headers, codes past the last group don't count
+		inline size_t PayloadSize(const uint8_t* headers, uint32_t groupCount)
+		{
+			size_t size = 0;
+			for (uint32_t h = 0; h < groupCount / 4; h++) size += PAYLOAD_SIZES.sizes[headers[h]];
+			if (groupCount % 4) size += PAYLOAD_SIZES.sizes[headers[groupCount / 4] & ((1 << (groupCount % 4) * 2) - 1)];
+			return size;
+		}
+
+		//unpacks groupCount groups starting at firstGroup into 'plane', 'in' is where the first one's payload starts and is advanced
+		//PayloadSize has already checked the payloads are all there, 'end' is where the readable input stops
+		inline void DecodeGroups(const uint8_t* headers, uint32_t firstGroup, uint32_t groupCount, const uint8_t*& in, const uint8_t* end, uint8_t* plane)
+		{
+			static const uint8_t payloadSize[4] = { 0, 4, 8, 16 };
+#ifdef MESHCODEC_SSE2
+			//widths vary group to group with no pattern, so every width is unpacked from one load and the code only selects
+			alignas(16) static const uint32_t selects[4][3][4] =
+			{
+				{ {}, {}, {} },
+				{ { ~0u, ~0u, ~0u, ~0u }, {}, {} },
+				{ {}, { ~0u, ~0u, ~0u, ~0u }, {} },
+				{ {}, {}, { ~0u, ~0u, ~0u, ~0u } },
+			};
+			const __m128i mask2 = _mm_set1_epi8(0x03), mask4 = _mm_set1_epi8(0x0F);
+#endif
+			for (uint32_t g = firstGroup; g < firstGroup + groupCount; g++)
+			{
+				int code = (headers[g / 4] >> ((g % 4) * 2)) & 3;
+				uint8_t* group = plane + (g - firstGroup) * GROUP_SIZE;
+
+#ifdef MESHCODEC_SSE2
+				__m128i x;
+				if (end - in >= 16) x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+				else
+				{
+					//the stream's last bytes, the full load would read past them
+					alignas(16) uint8_t tail[16] = {};
+					memcpy(tail, in, payloadSize[code]);
+					x = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+				}
+				__m128i bits2 = _mm_unpacklo_epi64(
+					_mm_unpacklo_epi32(_mm_and_si128(x, mask2), _mm_and_si128(_mm_srli_epi16(x, 2), mask2)),
+					_mm_unpacklo_epi32(_mm_and_si128(_mm_srli_epi16(x, 4), mask2), _mm_and_si128(_mm_srli_epi16(x, 6), mask2)));
+				__m128i bits4 = _mm_unpacklo_epi64(_mm_and_si128(x, mask4), _mm_and_si128(_mm_srli_epi16(x, 4), mask4));
+
+				const __m128i* select = reinterpret_cast<const __m128i*>(selects[code]);
+				__m128i z = _mm_or_si128(_mm_or_si128(_mm_and_si128(bits2, select[0]), _mm_and_si128(bits4, select[1])), _mm_and_si128(x, select[2]));
+				_mm_store_si128(reinterpret_cast<__m128i*>(group), z);
+#else
+				if (code == 0) memset(group, 0, GROUP_SIZE);
+				else if (code == 1)
+				{
+					for (int j = 0; j < 4; j++) for (int k = 0; k < 4; k++) group[j + k * 4] = (in[j] >> (k * 2)) & 3;
+				}
+				else if (code == 2)
+				{
+					for (int j = 0; j < 8; j++) { group[j] = in[j] & 15; group[j + 8] = in[j] >> 4; }
+				}
+				else memcpy(group, in, GROUP_SIZE);
+#endif
+				in += payloadSize[code];
+			}
+		}
+
+		//undoes zigzag + delta for one 8-bit component, 'column' gets stride bytes
+		//prev is the component's last value before the plane and becomes its last value in it, so tiles continue each other
+		inline void Reconstruct8(const uint8_t* plane, uint32_t stride, uint8_t* column, uint8_t& prev)
+		{
+			uint32_t i = 0;
+#ifdef MESHCODEC_SSE2
+			const __m128i one = _mm_set1_epi8(1), mask7f = _mm_set1_epi8(0x7F);
+			__m128i carry = _mm_set1_epi8(char(prev));
+			for (; i < stride; i += 16)
+			{
+				__m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + i));
+				__m128i d = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), mask7f), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, one)));
+
+				//inclusive prefix sum across the 16 lanes, then add the running value
+				d = _mm_add_epi8(d, _mm_slli_si128(d, 1));
+				d = _mm_add_epi8(d, _mm_slli_si128(d, 2));
+				d = _mm_add_epi8(d, _mm_slli_si128(d, 4));
+				d = _mm_add_epi8(d, _mm_slli_si128(d, 8));
+				d = _mm_add_epi8(d, carry);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(column + i), d);
+				//byte 15 broadcast without leaving the vector registers
+				__m128i last = _mm_shufflehi_epi16(_mm_unpackhi_epi8(d, d), 0xFF);
+				carry = _mm_unpackhi_epi64(last, last);
+			}
+			prev = uint8_t(_mm_cvtsi128_si32(carry));
+#else
+			for (; i < stride; i++)
+			{
+				prev = uint8_t(prev + UnZigZag8(plane[i]));
+				column[i] = prev;
+			}
+#endif
+		}
+
+		//same for a 16-bit component split over a low and a high plane
+		inline void Reconstruct16(const uint8_t* lo, const uint8_t* hi, uint32_t stride, uint16_t* column, uint16_t& prev)
+		{
+			uint32_t i = 0;
+#ifdef MESHCODEC_SSE2
+			const __m128i one = _mm_set1_epi16(1);
+			__m128i carry = _mm_set1_epi16(short(prev));
+			for (; i < stride; i += 16)
+			{
+				__m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i));
+				__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i));
+				__m128i halves[2] = { _mm_unpacklo_epi8(l, h), _mm_unpackhi_epi8(l, h) };
+
+				for (int k = 0; k < 2; k++)
+				{
+					__m128i z = halves[k];
+					__m128i d = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(z, one)));
+					d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+					d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+					d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+					d = _mm_add_epi16(d, carry);
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(column + i + k * 8), d);
+					__m128i last = _mm_shufflehi_epi16(d, 0xFF);
+					carry = _mm_unpackhi_epi64(last, last);
+				}
+			}
+			prev = uint16_t(_mm_cvtsi128_si32(carry));
+#else
+			for (; i < stride; i++)
+			{
+				prev = uint16_t(prev + UnZigZag16(uint16_t(lo[i] | hi[i] << 8)));
+				column[i] = prev;
+			}
+#endif
+		}
+
+		//columns (componentCount x stride values) back to interleaved elements
+		template <typename T>
+		inline void Interleave(const T* columns, uint32_t stride, uint32_t count, uint32_t componentCount, T* out)
+		{
+			uint32_t i = 0;
+#ifdef MESHCODEC_SSE2
+			if (sizeof(T) == 1 && componentCount == 4)
+			{
+				const uint8_t* c = reinterpret_cast<const uint8_t*>(columns);
+				for (; i + 16 <= count; i += 16)
+				{
+					__m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + 0 * stride + i));
+					__m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + 1 * stride + i));
+					__m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + 2 * stride + i));
+					__m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + 3 * stride + i));
+					__m128i a = _mm_unpacklo_epi8(p0, p1), b = _mm_unpackhi_epi8(p0, p1);
+					__m128i d = _mm_unpacklo_epi8(p2, p3), e = _mm_unpackhi_epi8(p2, p3);
+					__m128i* dst = reinterpret_cast<__m128i*>(out + i * 4);
+					_mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(a, d));
+					_mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(a, d));
+					_mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(b, e));
+					_mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(b, e));
+				}
+			}
+			else if (sizeof(T) == 2 && componentCount == 2)
+			{
+				for (; i + 8 <= count; i += 8)
+				{
+					__m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i));
+					__m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + stride + i));
+					__m128i* dst = reinterpret_cast<__m128i*>(out + i * 2);
+					_mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(p0, p1));
+					_mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(p0, p1));
+				}
+			}
+			else if (sizeof(T) == 2 && componentCount == 3)
+			{
+				//x y z 0 per 64 bit lane, each element stored as 8 bytes whose top 2 the next element overwrites
+				uint8_t* bytes = reinterpret_cast<uint8_t*>(out);
+				const __m128i zero = _mm_setzero_si128();
+				for (; i + 8 < count; i += 8)
+				{
+					__m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + i));
+					__m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + stride + i));
+					__m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + 2 * stride + i));
+					__m128i xy[2] = { _mm_unpacklo_epi16(p0, p1), _mm_unpackhi_epi16(p0, p1) };
+					__m128i z0[2] = { _mm_unpacklo_epi16(p2, zero), _mm_unpackhi_epi16(p2, zero) };
+					for (int h = 0; h < 2; h++)
+					{
+						__m128i lo = _mm_unpacklo_epi32(xy[h], z0[h]), hi = _mm_unpackhi_epi32(xy[h], z0[h]);
+						uint8_t* dst = bytes + size_t(i + h * 4) * 6;
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), lo);
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 6), _mm_unpackhi_epi64(lo, lo));
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 12), hi);
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 18), _mm_unpackhi_epi64(hi, hi));
+					}
+				}
+			}
+#endif
+			if (sizeof(T) == 2 && componentCount == 3)
+			{
+				//each element as one 8 byte store, its top 2 bytes are overwritten by the next element, the last is written exactly
+				uint8_t* bytes = reinterpret_cast<uint8_t*>(out);
+				for (; i + 1 < count; i++)
+				{
+					uint64_t element = uint64_t(uint16_t(columns[i])) | uint64_t(uint16_t(columns[stride + i])) << 16 | uint64_t(uint16_t(columns[2 * stride + i])) << 32;
+					memcpy(bytes + size_t(i) * 6, &element, 8);
+				}
+			}
+			for (; i < count; i++)
+				for (uint32_t c = 0; c < componentCount; c++) out[i * componentCount + c] = columns[c * stride + i];
+		}
+
+		//blockElements is what the encoder cut the stream's kind into, a block count that doesn't match count is rejected
+		//before any block is decoded, the last block's element count would underflow
+		inline bool ReadHeader(const uint8_t*& in, const uint8_t* end, StreamHeader& header, std::vector<uint32_t>& blockOffsets, uint32_t blockElements)
+		{
+			if (size_t(end - in) < sizeof(StreamHeader)) return false;
+			memcpy(&header, in, sizeof(StreamHeader));
+			in += sizeof(StreamHeader);
+			if (header.blockCount != (uint64_t(header.count) + blockElements - 1) / blockElements) return false;
+			if (size_t(end - in) < size_t(header.blockCount) * 4) return false;
+			in += size_t(header.blockCount) * 4;
+
+			//turn the size table into offsets from the first block, summed wide so hostile sizes can't wrap past the data
+			const uint64_t available = uint64_t(end - in);
+			blockOffsets.resize(header.blockCount + 1);
+			blockOffsets[0] = 0;
+			uint64_t offset = 0;
+			for (uint32_t b = 0; b < header.blockCount; b++)
+			{
+				uint32_t size;
+				memcpy(&size, in - size_t(header.blockCount - b) * 4, 4);
+				offset += size;
+				if (offset > available) return false;
+				blockOffsets[b + 1] = uint32_t(offset);
+			}
+			return true;
+		}
+
+		//runs fn(block) for every block, split into contiguous ranges over at most hardware_concurrency workers
+		template <typename Fn>
+		inline bool ForEachBlock(uint32_t blockCount, Fn&& fn)
+		{
+			if (blockCount <= 1) return blockCount == 0 || fn(0u);
+
+			uint32_t workers = std::min(blockCount, std::max(1u, std::thread::hardware_concurrency()));
+			uint32_t perWorker = (blockCount + workers - 1) / workers;
+			auto range = [&](uint32_t worker)
+				{
+					bool ok = true;
+					for (uint32_t b = worker * perWorker; b < std::min(blockCount, (worker + 1) * perWorker); b++) ok = fn(b) && ok;
+					return ok;
+				};
+
+			std::vector<std::future<bool>> tasks;
+			for (uint32_t w = 1; w < workers; w++) tasks.push_back(std::async(std::launch::async, range, w));
+			bool ok = range(0u);
+			for (auto& t : tasks) ok = t.get() && ok;
+			return ok;
+		}
+	}
+
+	//elementSize must be a multiple of componentSize (1 or 2)
+	inline void EncodeVertexStream(const void* data, uint32_t count, uint32_t elementSize, uint32_t componentSize, std::vector<uint8_t>& out)
+	{
+		const uint8_t* elements = static_cast<const uint8_t*>(data);
+		StreamHeader header;
+		header.count = count;
+		header.elementSize = elementSize;
+		header.componentSize = componentSize;
+		header.blockCount = (count + VERTEX_BLOCK_ELEMENTS - 1) / VERTEX_BLOCK_ELEMENTS;
+		detail::Append(out, &header, sizeof(header));
+
+		size_t sizeTable = out.size();
+		out.resize(sizeTable + size_t(header.blockCount) * 4);
+
+		uint32_t componentCount = elementSize / componentSize;
+		std::vector<uint8_t> planes(size_t(VERTEX_BLOCK_ELEMENTS) * elementSize);
+		for (uint32_t b = 0; b < header.blockCount; b++)
+		{
+			size_t blockStart = out.size();
+			uint32_t first = b * VERTEX_BLOCK_ELEMENTS;
+			uint32_t n = std::min(VERTEX_BLOCK_ELEMENTS, count - first);
+			uint32_t stride = (n + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+			std::fill(planes.begin(), planes.end(), uint8_t(0));
+
+			for (uint32_t c = 0; c < componentCount; c++)
+			{
+				uint16_t prev = 0;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					const uint8_t* src = elements + size_t(first + i) * elementSize + c * componentSize;
+					uint16_t v = componentSize == 2 ? uint16_t(src[0] | src[1] << 8) : src[0];
+					uint16_t z = componentSize == 2 ? detail::ZigZag16(uint16_t(v - prev)) : detail::ZigZag8(uint8_t(v - prev));
+					prev = v;
+
+					planes[size_t(c * componentSize) * stride + i] = uint8_t(z);
+					if (componentSize == 2) planes[size_t(c * componentSize + 1) * stride + i] = uint8_t(z >> 8);
+				}
+			}
+
+			for (uint32_t k = 0; k < elementSize; k++) detail::EncodePlane(&planes[size_t(k) * stride], n, out);
+
+			uint32_t size = uint32_t(out.size() - blockStart);
+			memcpy(&out[sizeTable + b * 4], &size, 4);
+		}
+	}
+
+	//returns the end of the stream, or nullptr if it is malformed or doesn't match the expected shape
+	inline const uint8_t* DecodeVertexStream(const uint8_t* in, const uint8_t* end, void* data, uint32_t count, uint32_t elementSize)
+	{
+		StreamHeader header;
+		std::vector<uint32_t> offsets;
+		if (!detail::ReadHeader(in, end, header, offsets, VERTEX_BLOCK_ELEMENTS) || header.count != count || header.elementSize != elementSize || elementSize > MAX_ELEMENT_SIZE) return nullptr;
+		if ((header.componentSize != 1 && header.componentSize != 2) || elementSize % header.componentSize) return nullptr;
+
+		uint8_t* elements = static_cast<uint8_t*>(data);
+		const uint32_t componentSize = header.componentSize;
+		bool ok = detail::ForEachBlock(header.blockCount, [&](uint32_t b)
+			{
+				uint32_t first = b * VERTEX_BLOCK_ELEMENTS;
+				uint32_t n = std::min(VERTEX_BLOCK_ELEMENTS, count - first);
+				uint32_t groupCount = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+				uint32_t headerSize = (groupCount + 3) / 4;
+
+				//every plane's headers and payload located and bounds checked up front, tiles then decode without checks
+				const uint8_t* headers[MAX_ELEMENT_SIZE];
+				const uint8_t* payloads[MAX_ELEMENT_SIZE];
+				const uint8_t* blockIn = in + offsets[b];
+				const uint8_t* blockEnd = in + offsets[b + 1];
+				for (uint32_t k = 0; k < elementSize; k++)
+				{
+					if (size_t(blockEnd - blockIn) < headerSize) return false;
+					headers[k] = blockIn;
+					blockIn += headerSize;
+					size_t payloadSize = detail::PayloadSize(headers[k], groupCount);
+					if (size_t(blockEnd - blockIn) < payloadSize) return false;
+					payloads[k] = blockIn;
+					blockIn += payloadSize;
+				}
+
+				//on the stack, a tile of planes and of reconstructed columns, the columns double as the unaligned output's staging
+				alignas(16) uint8_t planes[TILE_ELEMENTS * MAX_ELEMENT_SIZE];
+				alignas(16) uint8_t columns[TILE_ELEMENTS * MAX_ELEMENT_SIZE];
+				uint8_t prev8[MAX_ELEMENT_SIZE] = {};
+				uint16_t prev16[MAX_ELEMENT_SIZE / 2] = {};
+
+				for (uint32_t tileFirst = 0; tileFirst < n; tileFirst += TILE_ELEMENTS)
+				{
+					uint32_t tileCount = std::min(TILE_ELEMENTS, n - tileFirst);
+					uint32_t stride = (tileCount + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+					for (uint32_t k = 0; k < elementSize; k++) detail::DecodeGroups(headers[k], tileFirst / GROUP_SIZE, stride / GROUP_SIZE, payloads[k], end, &planes[size_t(k) * stride]);
+
+					uint8_t* dst = elements + size_t(first + tileFirst) * elementSize;
+					if (componentSize == 2)
+					{
+						uint32_t componentCount = elementSize / 2;
+						uint16_t* column16 = reinterpret_cast<uint16_t*>(columns);
+						for (uint32_t c = 0; c < componentCount; c++)
+							detail::Reconstruct16(&planes[size_t(c * 2) * stride], &planes[size_t(c * 2 + 1) * stride], stride, column16 + size_t(c) * stride, prev16[c]);
+
+						//elements may not be 2 byte aligned in the caller's buffer, the planes are free to stage them by now
+						if (reinterpret_cast<uintptr_t>(dst) % 2 == 0) detail::Interleave(column16, stride, tileCount, componentCount, reinterpret_cast<uint16_t*>(dst));
+						else
+						{
+							detail::Interleave(column16, stride, tileCount, componentCount, reinterpret_cast<uint16_t*>(planes));
+							memcpy(dst, planes, size_t(tileCount) * elementSize);
+						}
+					}
+					else
+					{
+						for (uint32_t c = 0; c < elementSize; c++) detail::Reconstruct8(&planes[size_t(c) * stride], stride, &columns[size_t(c) * stride], prev8[c]);
+						detail::Interleave(columns, stride, tileCount, elementSize, dst);
+					}
+				}
+				return true;
+			});
+
+		return ok ? in + offsets.back() : nullptr;
+	}
+
+	inline void EncodeIndexStream(const uint32_t* indices, uint32_t count, std::vector<uint8_t>& out)
+	{
+		StreamHeader header;
+		header.count = count;
+		header.elementSize = sizeof(uint32_t);
+		header.componentSize = sizeof(uint32_t);
+		header.blockCount = (count + INDEX_BLOCK_ELEMENTS - 1) / INDEX_BLOCK_ELEMENTS;
+		detail::Append(out, &header, sizeof(header));
+
+		size_t sizeTable = out.size();
+		out.resize(sizeTable + size_t(header.blockCount) * 4);
+
+		for (uint32_t b = 0; b < header.blockCount; b++)
+		{
+			size_t blockStart = out.size();
+			uint32_t first = b * INDEX_BLOCK_ELEMENTS;
+			uint32_t n = std::min(INDEX_BLOCK_ELEMENTS, count - first);
+
+			uint32_t prev = 0;
+			for (uint32_t i = 0; i < n; i++)
+			{
+				uint32_t v = detail::ZigZag32(int32_t(indices[first + i] - prev));
+				prev = indices[first + i];
+				while (v >= 0x80)
+				{
+					out.push_back(uint8_t(v | 0x80));
+					v >>= 7;
+				}
+				out.push_back(uint8_t(v));
+			}
+
+			uint32_t size = uint32_t(out.size() - blockStart);
+			memcpy(&out[sizeTable + b * 4], &size, 4);
+		}
+	}
+
+	inline const uint8_t* DecodeIndexStream(const uint8_t* in, const uint8_t* end, uint32_t* indices, uint32_t count)
+	{
+		StreamHeader header;
+		std::vector<uint32_t> offsets;
+		if (!detail::ReadHeader(in, end, header, offsets, INDEX_BLOCK_ELEMENTS) || header.count != count) return nullptr;
+
+		bool ok = detail::ForEachBlock(header.blockCount, [&](uint32_t b)
+			{
+				uint32_t first = b * INDEX_BLOCK_ELEMENTS;
+				uint32_t n = std::min(INDEX_BLOCK_ELEMENTS, count - first);
+				const uint8_t* p = in + offsets[b];
+				const uint8_t* blockEnd = in + offsets[b + 1];
+
+				uint32_t prev = 0;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					uint32_t v = 0;
+					for (int shift = 0; ; shift += 7)
+					{
+						if (p >= blockEnd || shift > 28) return false;
+						uint8_t byte = *p++;
+						v |= uint32_t(byte & 0x7F) << shift;
+						if (!(byte & 0x80)) break;
+					}
+					prev += uint32_t(detail::UnZigZag32(v));
+					indices[first + i] = prev;
+				}
+				return true;
+			});
+
+		return ok ? in + offsets.back() : nullptr;
+	}
+}
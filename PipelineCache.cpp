@@ -0,0 +1,181 @@
+#include "pch.h"
+
+bool PipelineCache::Create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	_device = device;
+	_path = path;
+	_header.magic = MAGIC;
+	_header.version = VERSION;
+	_header.vendorID = properties.vendorID;
+	_header.deviceID = properties.deviceID;
+	_header.driverVersion = properties.driverVersion;
+	memcpy(_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::vector<uint8_t> data = Load();
+	_warm = !data.empty();
+	_savedSize = data.size();
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	pipelineCacheCreateInfo.initialDataSize = data.size();
+	pipelineCacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	VkResult result = vkCreatePipelineCache(_device, &pipelineCacheCreateInfo, nullptr, &_cache);
+	if (result != VK_SUCCESS && _warm)
+	{
+		//the driver refused the blob, an empty cache still works
+		std::cout << "Warning: pipeline cache " << _path << " rejected by the driver, starting empty\n";
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		_warm = false;
+		_savedSize = 0;
+		result = vkCreatePipelineCache(_device, &pipelineCacheCreateInfo, nullptr, &_cache);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Error: failed to create the pipeline cache\n";
+		_cache = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+std::vector<uint8_t> PipelineCache::Load()
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (!file) return {};
+
+	FileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != MAGIC || header.version != VERSION) return {};
+
+	//a blob from another gpu or driver is at best useless, at worst crashes the driver
+	if (header.vendorID != _header.vendorID || header.deviceID != _header.deviceID || header.driverVersion != _header.driverVersion
+		|| memcmp(header.pipelineCacheUUID, _header.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		std::cout << "Warning: pipeline cache " << _path << " was written by another device or driver, rebuilding it\n";
+		return {};
+	}
+
+	//the size comes from the file, a corrupt or truncated one mustn't decide how much gets allocated
+	std::streamoff dataStart = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff remaining = file.tellg() - dataStart;
+	file.seekg(dataStart);
+	if (!file || remaining < 0 || header.dataSize != static_cast<uint64_t>(remaining))
+	{
+		std::cout << "Warning: pipeline cache " << _path << " is truncated or corrupt, rebuilding it\n";
+		return {};
+	}
+
+	std::vector<uint8_t> data(header.dataSize);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!file) return {};
+
+	//the driver's own header has to agree too
+	VkPipelineCacheHeaderVersionOne cacheHeader;
+	if (data.size() < sizeof(cacheHeader)) return {};
+	memcpy(&cacheHeader, data.data(), sizeof(cacheHeader));
+	if (cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || cacheHeader.vendorID != _header.vendorID || cacheHeader.deviceID != _header.deviceID
+		|| memcmp(cacheHeader.pipelineCacheUUID, _header.pipelineCacheUUID, VK_UUID_SIZE) != 0) return {};
+
+	return data;
+}
+
+void PipelineCache::Destroy()
+{
+	if (!IsCreated()) return;
+
+	Save();
+	vkDestroyPipelineCache(_device, _cache, nullptr);
+	_cache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::Save()
+{
+	if (!IsCreated()) return false;
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(_device, _cache, &size, nullptr) != VK_SUCCESS || size == _savedSize) return false;
+
+	std::vector<uint8_t> data(size);
+	if (vkGetPipelineCacheData(_device, _cache, &size, data.data()) != VK_SUCCESS) return false;
+	data.resize(size);
+
+	//written next to the old blob and swapped in, a crash mid save leaves the previous one intact
+	std::filesystem::path path(_path);
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+	std::string temporary = _path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Warning: can't write pipeline cache " << temporary << '\n';
+			return false;
+		}
+
+		FileHeader header = _header;
+		header.dataSize = data.size();
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, _path, error);
+	if (error)
+	{
+		std::cout << "Warning: can't replace pipeline cache " << _path << ": " << error.message() << '\n';
+		return false;
+	}
+
+	_savedSize = size;
+	return true;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline, const std::string& name)
+{
+	auto start = std::chrono::steady_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(_device, _cache, 1, &createInfo, nullptr, &pipeline);
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (result != VK_SUCCESS) std::cout << "Error: failed to create pipeline " << name << '\n';
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_timings.push_back({ name, ms, _warm });
+	return result;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, VkPipeline& pipeline, const std::string& name)
+{
+	auto start = std::chrono::steady_clock::now();
+	VkResult result = vkCreateComputePipelines(_device, _cache, 1, &createInfo, nullptr, &pipeline);
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (result != VK_SUCCESS) std::cout << "Error: failed to create pipeline " << name << '\n';
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_timings.push_back({ name, ms, _warm });
+	return result;
+}
+
+std::vector<PipelineTiming> PipelineCache::GetTimings()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _timings;
+}
+
+void PipelineCache::PrintStats()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	float total = 0.f;
+	for (auto& timing : _timings)
+	{
+		std::cout << "Pipeline " << timing.name << ": " << timing.ms << "ms\n";
+		total += timing.ms;
+	}
+	std::cout << _timings.size() << " pipelines in " << total << "ms from a " << (_warm ? "warm" : "cold") << " cache, " << _savedSize / 1024.f << "KB on disk\n";
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+struct PipelineTiming
+{
+	std::string name;
+	float ms = 0.f;
+	bool warm = false; //the cache started from a blob on disk
+};
+
+//VkPipelineCache kept on disk between runs, every pipeline is created through it
+//the blob is only used when the same device and driver wrote it, anything else starts an empty cache
+class PipelineCache
+{
+	struct FileHeader
+	{
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint32_t vendorID = 0, deviceID = 0, driverVersion = 0;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+		uint64_t dataSize = 0;
+	};
+
+	VkDevice _device = VK_NULL_HANDLE;
+	VkPipelineCache _cache = VK_NULL_HANDLE;
+	FileHeader _header = {};
+	std::string _path;
+	size_t _savedSize = 0; //blob size on disk, nothing is written while the driver reports the same
+	bool _warm = false;
+
+	std::mutex _mutex;
+	std::vector<PipelineTiming> _timings;
+
+	std::vector<uint8_t> Load();
+
+public:
+	static constexpr uint32_t MAGIC = 0x43505049; //"IPPC"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr const char* DEFAULT_PATH = "Cache/pipelines.bin";
+	static constexpr unsigned long long SAVE_INTERVAL = 600; //frames between saves
+
+	bool Create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path = DEFAULT_PATH);
+	//saves before destroying
+	void Destroy();
+	bool IsCreated() const { return _cache != VK_NULL_HANDLE; }
+
+	//writes the blob when the driver added to it since the last save
+	bool Save();
+
+	//vkCreateGraphicsPipelines through the cache, timed under name
+	VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline, const std::string& name);
+	VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& createInfo, VkPipeline& pipeline, const std::string& name);
+
+	VkPipelineCache GetCache() const { return _cache; }
+	bool IsWarm() const { return _warm; }
+	std::vector<PipelineTiming> GetTimings();
+	void PrintStats();
+};
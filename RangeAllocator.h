@@ -0,0 +1,86 @@
+#pragma once
+
+// Header only and free of vulkan, so the CPU-only tests build it without a device
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+//first-fit free list over [0, capacity), neighbouring free ranges merge on release
+class RangeAllocator
+{
+	std::map<uint32_t, uint32_t> _free; //offset -> count
+	uint32_t _capacity = 0, _used = 0;
+
+public:
+	void Reset(uint32_t capacity);
+	//only hands out ranges starting below maxOffset, compaction uses it to move strictly downwards
+	bool Allocate(uint32_t count, uint32_t& offset, uint32_t maxOffset = UINT32_MAX);
+	void Release(uint32_t offset, uint32_t count);
+
+	uint32_t GetCapacity() const { return _capacity; }
+	uint32_t GetUsed() const { return _used; }
+	uint32_t GetLargestFree() const;
+	size_t GetFreeRangeCount() const { return _free.size(); }
+};
+
+inline void RangeAllocator::Reset(uint32_t capacity)
+{
+	_free.clear();
+	_capacity = capacity;
+	_used = 0;
+	if (capacity) _free[0] = capacity;
+}
+
+inline bool RangeAllocator::Allocate(uint32_t count, uint32_t& offset, uint32_t maxOffset)
+{
+	if (count == 0) return false;
+
+	for (auto it = _free.begin(); it != _free.end() && it->first < maxOffset; ++it)
+	{
+		if (it->second < count) continue;
+
+		offset = it->first;
+		uint32_t remaining = it->second - count;
+		_free.erase(it);
+		if (remaining) _free[offset + count] = remaining;
+		_used += count;
+		return true;
+	}
+	return false;
+}
+
+inline void RangeAllocator::Release(uint32_t offset, uint32_t count)
+{
+	if (count == 0) return;
+	_used -= count;
+
+	auto next = _free.lower_bound(offset);
+
+	//merge with the range after
+	if (next != _free.end() && offset + count == next->first)
+	{
+		count += next->second;
+		next = _free.erase(next);
+	}
+
+	//and the range before
+	if (next != _free.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += count;
+			return;
+		}
+	}
+
+	_free[offset] = count;
+}
+
+inline uint32_t RangeAllocator::GetLargestFree() const
+{
+	uint32_t largest = 0;
+	for (auto& range : _free) largest = std::max(largest, range.second);
+	return largest;
+}
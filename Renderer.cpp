@@ -21,81 +21,41 @@ Renderer::~Renderer()
 {
 }
 
-void VulkanRenderer::CompileShaders()
+bool VulkanRenderer::CompileShaders()
 {
-	DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&_compiler));
-	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&_utils));
-	_utils->CreateDefaultIncludeHandler(&_includeHandler);
-
-	std::filesystem::create_directories("Shaders/SPV");
-
-	// Convert shader code to a DXC blob
-	DxcBuffer sourceBuffer;
-	std::string shaderCode, full;
-	std::wstring hlsl, out;
-
-	//0 - fragment, 1 - vertex, 2 - compute | dont include extension
-	std::vector<std::pair<int, std::string>> shaders =
-	{
-		{0, "FragmentShader"},
-		{0, "OffscreenFragmentShader"},
-		{1, "VertexShader"},
-		{1, "OffscreenVertexShader"},
-	};
-
-	for (size_t i = 0; i < shaders.size(); i++)
-	{
-		//convert shader to dxc buffer
-		full = "Shaders/" + shaders[i].second + ".hlsl";
-		shaderCode = ShaderAsString(full.c_str());
-		sourceBuffer.Ptr = shaderCode.c_str();
-		sourceBuffer.Size = shaderCode.size();
-		sourceBuffer.Encoding = DXC_CP_ACP;
-
-		std::wstring tWstring(shaders[i].second.begin(), shaders[i].second.end());
-
-		//define arguments
-		std::vector<LPCWSTR> arguments;
-		arguments.push_back(L"-spirv");
-		arguments.push_back(L"-T");
-		shaders[i].first == 0 ? arguments.push_back(L"ps_6_6") : shaders[i].first == 1 ? arguments.push_back(L"vs_6_6") : arguments.push_back(L"cs_6_6");
-		arguments.push_back(L"-E");
-		arguments.push_back(L"main");
-		hlsl = L"Shaders/" + tWstring + L".hlsl";
-		arguments.push_back(hlsl.c_str());
-		arguments.push_back(L"-Fo");
-		out = tWstring + L".spv";
-		arguments.push_back(out.c_str());
-#ifndef NDEBUG
-		arguments.push_back(L"-Zi");
-		arguments.push_back(L"-Qembed_debug");
-#endif // NDEBUG
-
-
-		ComPtr<IDxcResult> result;
-		_compiler->Compile(&sourceBuffer, arguments.data(), arguments.size(), _includeHandler.Get(), IID_PPV_ARGS(&result));
-
-		// Check for compilation errors
-		ComPtr<IDxcBlobUtf8> errors;
-		if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) && errors && errors->GetStringLength() > 0) {
-			std::cout << "Shader compilation errors: " << errors->GetStringPointer() << "\n";
-			return;
-		}
-
-		//write compilation to spv
-		ComPtr<IDxcBlob> shaderBlob;
-		if (SUCCEEDED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr)))
+	_shaderCompiler = ShaderCompiler();
+	ShaderCompiler& compiler = _shaderCompiler;
+	//the shaders size their light arrays and tiles from these, so the cbuffer layout and tile masks can't drift from Structs.h
+	compiler.AddDefine("MAX_LIGHTS=" + std::to_string(MAX_LIGHTS));
+	compiler.AddDefine("TILE_SIZE=" + std::to_string(LIGHT_TILE_SIZE));
+	if (_gBufferLayout == GBufferLayout::COMPACT) compiler.AddDefine("COMPACT_GBUFFER");
+	if (_bindless.IsCreated()) compiler.AddDefine("BINDLESS");
+	if (_frameGraph->IsMerged("Composition Pass")) compiler.AddDefine("SUBPASS_INPUTS");
+
+	//dont include extension
+	return compiler.Build(
 		{
-			// Write the compiled shader to file
-			std::ofstream outFile(L"Shaders/SPV/" + out, std::ios::binary);
-			outFile.write(static_cast<const char*>(shaderBlob->GetBufferPointer()), shaderBlob->GetBufferSize());
-			outFile.close();
-		}
-	}
+			{ShaderStage::PIXEL, "FragmentShader"},
+			{ShaderStage::PIXEL, "OffscreenFragmentShader"},
+			{ShaderStage::VERTEX, "VertexShader"},
+			{ShaderStage::VERTEX, "OffscreenVertexShader"},
+			{ShaderStage::COMPUTE, "LightCulling"},
+		});
 }
 
-void VulkanRenderer::LoadModel(std::string filename)
+//only writes to 'out', so several models can load on different threads at once
+bool VulkanRenderer::LoadModel(const std::string& filename, ModelData& out)
 {
+#ifdef NDEBUG
+	//production builds only read Cooker output
+	if (!LoadCookedModel(filename, out))
+	{
+		std::cout << "Error: no cooked data for " << filename << ", run the Cooker first\n";
+		return false;
+	}
+	return true;
+#else
+	tinygltf::Model model;
 	tinygltf::TinyGLTF gltfLoader;
 	std::string error;
 	std::string warning;
@@ -103,8 +63,8 @@ void VulkanRenderer::LoadModel(std::string filename)
 	unsigned long long pos = filename.find_last_of('/');
 	std::string path = filename.substr(0, pos);
 
-	bool fileLoaded = gltfLoader.LoadASCIIFromFile(&_model, &error, &warning, filename);
-	//bool fileLoaded = gltfLoader.LoadBinaryFromFile(&_model, &error, &warning, filename);
+	bool fileLoaded = gltfLoader.LoadASCIIFromFile(&model, &error, &warning, filename);
+	//bool fileLoaded = gltfLoader.LoadBinaryFromFile(&model, &error, &warning, filename);
 
 	if (!warning.empty())
 	{
@@ -119,27 +79,98 @@ void VulkanRenderer::LoadModel(std::string filename)
 	if (!fileLoaded)
 	{
 		std::cout << "Failed to parse model\n";
+		return false;
 	}
+
+	CreateGeometryData(model, out);
+	return true;
+#endif // NDEBUG
 }
 
-void VulkanRenderer::CreateGeometryData()
+bool VulkanRenderer::LoadCookedModel(const std::string& filename, ModelData& out)
+{
+	std::ifstream manifestFile(Cooked::MANIFEST_PATH);
+	if (!manifestFile) return false;
+
+	nlohmann::json manifest = nlohmann::json::parse(manifestFile, nullptr, false);
+	if (manifest.is_discarded() || !manifest.contains("assets")) return false;
+
+	std::string meshPath;
+	std::vector<int> materials;
+	for (auto& entry : manifest["assets"])
+	{
+		if (entry.value("source", "") != filename) continue;
+		meshPath = entry.value("mesh", "");
+		out.texturePaths = entry.value("textures", std::vector<std::string>{});
+		materials = entry.value("materials", std::vector<int>{});
+	}
+
+	Cooked::MeshData mesh;
+	if (meshPath.empty() || !Cooked::ReadMesh(meshPath, mesh)) return false;
+
+	unsigned int baseVertex = out.geometry.positions.size();
+	unsigned int baseIndex = out.geometry.indices.size();
+
+	//dequantize into the float streams the offscreen pipeline expects
+	const Cooked::MeshHeader& header = mesh.header;
+	for (size_t v = 0; v < header.vertexCount; v++)
+	{
+		const uint16_t* p = &mesh.positions[v * 3];
+		out.geometry.positions.push_back(vec3{ header.posMin[0] + p[0] * header.posScale[0], header.posMin[1] + p[1] * header.posScale[1], header.posMin[2] + p[2] * header.posScale[2] });
+
+		float n[3];
+		Cooked::OctDecode(&mesh.normals[v * 2], n);
+		out.geometry.normals.push_back(vec3{ n[0], n[1], n[2] });
+
+		out.geometry.texCoords.push_back(vec2{ Cooked::HalfToFloat(mesh.texCoords[v * 2 + 0]), Cooked::HalfToFloat(mesh.texCoords[v * 2 + 1]) });
+
+		const int8_t* t = &mesh.tangents[v * 4];
+		out.geometry.tangents.push_back(vec4{ Cooked::FromSnorm8(t[0]), Cooked::FromSnorm8(t[1]), Cooked::FromSnorm8(t[2]), Cooked::FromSnorm8(t[3]) });
+	}
+	out.geometry.indices.insert(out.geometry.indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+	for (auto& draw : mesh.draws)
+	{
+		const Cooked::Primitive& prim = mesh.primitives[draw.primitive];
+
+		//rebuild the gltf node so the world matrix matches the uncooked path exactly
+		tinygltf::Node node;
+		node.translation = { draw.translation[0], draw.translation[1], draw.translation[2] };
+		node.rotation = { draw.rotation[0], draw.rotation[1], draw.rotation[2], draw.rotation[3] };
+		node.scale = { draw.scale[0], draw.scale[1], draw.scale[2] };
+
+		DrawInfo di;
+		di.idxCount = prim.indexCount;
+		di.firstIdx = baseIndex + prim.firstIndex;
+		di.vertexOffset = baseVertex + prim.vertexOffset;
+		di.nodeWorld = GetLocalMatrix(node);
+		di.textureIndex = prim.materialIndex >= 0 && prim.materialIndex < (int)materials.size() ? materials[prim.materialIndex] : -1;
+		out.draws.push_back(di);
+	}
+
+	return true;
+}
+
+void VulkanRenderer::CreateGeometryData(tinygltf::Model& model, ModelData& out)
 {
 	int vCount = 0, iCount = 0, firstIdx = 0, vertexOffset = 0;
 	DrawInfo di;
 
-	for (auto& node : _model.nodes)
+	for (auto& node : model.nodes)
 	{
-		auto& mesh = _model.meshes[node.mesh];
+		auto& mesh = model.meshes[node.mesh];
 		for (auto prim : mesh.primitives)
 		{
-			di.firstIdx = _geometryData.indices.size();
-			di.vertexOffset = _geometryData.positions.size();
+			di.firstIdx = out.geometry.indices.size();
+			di.vertexOffset = out.geometry.positions.size();
 			di.nodeWorld = GetLocalMatrix(node);
+			firstIdx = di.firstIdx;
+			vertexOffset = di.vertexOffset;
 
 			//position
-			tinygltf::Accessor& accessor = _model.accessors[prim.attributes.find("POSITION")->second];
-			tinygltf::BufferView& bufferView = _model.bufferViews[accessor.bufferView];
-			tinygltf::Buffer& buffer = _model.buffers[bufferView.buffer];
+			tinygltf::Accessor& accessor = model.accessors[prim.attributes.find("POSITION")->second];
+			tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+			tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
 			vCount = accessor.count;
 			{
 				auto pos = (const float*)&buffer.data[bufferView.byteOffset + accessor.byteOffset];
@@ -148,7 +179,7 @@ void VulkanRenderer::CreateGeometryData()
 				{
 					for (size_t i = 0; i < accessor.count; i++)
 					{
-						_geometryData.positions.push_back(vec3{ pos[i * 3 + 0], pos[i * 3 + 1], pos[i * 3 + 2] });
+						out.geometry.positions.push_back(vec3{ pos[i * 3 + 0], pos[i * 3 + 1], pos[i * 3 + 2] });
 					}
 
 					//_offscreenData.min = { (float)accessor.minValues[0], (float)accessor.minValues[1] , (float)accessor.minValues[2] };
@@ -156,9 +187,9 @@ void VulkanRenderer::CreateGeometryData()
 			}
 
 			//normals
-			accessor = _model.accessors[prim.attributes.find("NORMAL")->second];
-			bufferView = _model.bufferViews[accessor.bufferView];
-			buffer = _model.buffers[bufferView.buffer];
+			accessor = model.accessors[prim.attributes.find("NORMAL")->second];
+			bufferView = model.bufferViews[accessor.bufferView];
+			buffer = model.buffers[bufferView.buffer];
 			{
 				auto nrm = (const float*)&buffer.data[bufferView.byteOffset + accessor.byteOffset];
 
@@ -166,15 +197,15 @@ void VulkanRenderer::CreateGeometryData()
 				{
 					for (size_t i = 0; i < accessor.count; i++)
 					{
-						_geometryData.normals.push_back(vec3{ nrm[i * 3 + 0], nrm[i * 3 + 1], nrm[i * 3 + 2] });
+						out.geometry.normals.push_back(vec3{ nrm[i * 3 + 0], nrm[i * 3 + 1], nrm[i * 3 + 2] });
 					}
 				}
 			}
 
 			//texCoord
-			accessor = _model.accessors[prim.attributes.find("TEXCOORD_0")->second];
-			bufferView = _model.bufferViews[accessor.bufferView];
-			buffer = _model.buffers[bufferView.buffer];
+			accessor = model.accessors[prim.attributes.find("TEXCOORD_0")->second];
+			bufferView = model.bufferViews[accessor.bufferView];
+			buffer = model.buffers[bufferView.buffer];
 			{
 				auto uv0 = (const float*)&buffer.data[bufferView.byteOffset + accessor.byteOffset];
 
@@ -182,15 +213,15 @@ void VulkanRenderer::CreateGeometryData()
 				{
 					for (size_t i = 0; i < accessor.count; i++)
 					{
-						_geometryData.texCoords.push_back(vec2{ uv0[i * 2 + 0], uv0[i * 2 + 1] });
+						out.geometry.texCoords.push_back(vec2{ uv0[i * 2 + 0], uv0[i * 2 + 1] });
 					}
 				}
 			}
 
 			//index buffer
-			accessor = _model.accessors[prim.indices];
-			bufferView = _model.bufferViews[accessor.bufferView];
-			buffer = _model.buffers[bufferView.buffer];
+			accessor = model.accessors[prim.indices];
+			bufferView = model.bufferViews[accessor.bufferView];
+			buffer = model.buffers[bufferView.buffer];
 			iCount = accessor.count;
 			di.idxCount = (unsigned int)accessor.count;
 			{
@@ -201,7 +232,7 @@ void VulkanRenderer::CreateGeometryData()
 					std::vector<unsigned int> uIntPrims;
 					uIntPrims.resize(accessor.count);
 					memcpy(uIntPrims.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(unsigned int));
-					_geometryData.indices.insert(_geometryData.indices.end(), uIntPrims.begin(), uIntPrims.end());
+					out.geometry.indices.insert(out.geometry.indices.end(), uIntPrims.begin(), uIntPrims.end());
 					break;
 				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
@@ -209,7 +240,7 @@ void VulkanRenderer::CreateGeometryData()
 					std::vector<unsigned short> uShortPrims;
 					uShortPrims.resize(accessor.count);
 					memcpy(uShortPrims.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(unsigned short));
-					_geometryData.indices.insert(_geometryData.indices.end(), uShortPrims.begin(), uShortPrims.end());
+					out.geometry.indices.insert(out.geometry.indices.end(), uShortPrims.begin(), uShortPrims.end());
 					break;
 				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
@@ -217,7 +248,7 @@ void VulkanRenderer::CreateGeometryData()
 					std::vector<unsigned char> uCharPrims;
 					uCharPrims.resize(accessor.count);
 					memcpy(uCharPrims.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(unsigned char));
-					_geometryData.indices.insert(_geometryData.indices.end(), uCharPrims.begin(), uCharPrims.end());
+					out.geometry.indices.insert(out.geometry.indices.end(), uCharPrims.begin(), uCharPrims.end());
 					break;
 				}
 				default:
@@ -229,9 +260,9 @@ void VulkanRenderer::CreateGeometryData()
 			//tangent
 			if (prim.attributes.contains("TANGENT"))
 			{
-				accessor = _model.accessors[prim.attributes.find("TANGENT")->second];
-				bufferView = _model.bufferViews[accessor.bufferView];
-				buffer = _model.buffers[bufferView.buffer];
+				accessor = model.accessors[prim.attributes.find("TANGENT")->second];
+				bufferView = model.bufferViews[accessor.bufferView];
+				buffer = model.buffers[bufferView.buffer];
 				{
 					auto tan = (const float*)&buffer.data[bufferView.byteOffset + accessor.byteOffset];
 
@@ -239,14 +270,14 @@ void VulkanRenderer::CreateGeometryData()
 					{
 						for (size_t i = 0; i < accessor.count; i++)
 						{
-							_geometryData.tangents.push_back(vec4{ tan[i * 4 + 0], tan[i * 4 + 1], tan[i * 4 + 2], tan[i * 4 + 3] });
+							out.geometry.tangents.push_back(vec4{ tan[i * 4 + 0], tan[i * 4 + 1], tan[i * 4 + 2], tan[i * 4 + 3] });
 						}
 					}
 				}
 			}
 			else
 			{
-				if (node.name.find("Cone") != std::string::npos) _geometryData.tangents.push_back(vec4{ 0, 0, 0, 0 });
+				if (node.name.find("Cone") != std::string::npos) out.geometry.tangents.push_back(vec4{ 0, 0, 0, 0 });
 				else
 				{
 					std::vector<vec3> tangent(vCount);
@@ -255,9 +286,9 @@ void VulkanRenderer::CreateGeometryData()
 					for (size_t i = 0; i < iCount; i += 3)
 					{
 						//local index
-						unsigned int i0 = _geometryData.indices[firstIdx + i + 0];
-						unsigned int i1 = _geometryData.indices[firstIdx + i + 1];
-						unsigned int i2 = _geometryData.indices[firstIdx + i + 2];
+						unsigned int i0 = out.geometry.indices[firstIdx + i + 0];
+						unsigned int i1 = out.geometry.indices[firstIdx + i + 1];
+						unsigned int i2 = out.geometry.indices[firstIdx + i + 2];
 						assert(i0 < vCount);
 						assert(i1 < vCount);
 						assert(i2 < vCount);
@@ -267,13 +298,13 @@ void VulkanRenderer::CreateGeometryData()
 						unsigned int gi1 = i1 + vertexOffset;
 						unsigned int gi2 = i2 + vertexOffset;
 
-						const auto& p0 = _geometryData.positions[gi0];
-						const auto& p1 = _geometryData.positions[gi1];
-						const auto& p2 = _geometryData.positions[gi2];
+						const auto& p0 = out.geometry.positions[gi0];
+						const auto& p1 = out.geometry.positions[gi1];
+						const auto& p2 = out.geometry.positions[gi2];
 
-						const auto& uv0 = _geometryData.texCoords[gi0];
-						const auto& uv1 = _geometryData.texCoords[gi1];
-						const auto& uv2 = _geometryData.texCoords[gi2];
+						const auto& uv0 = out.geometry.texCoords[gi0];
+						const auto& uv1 = out.geometry.texCoords[gi1];
+						const auto& uv2 = out.geometry.texCoords[gi2];
 
 						vec3 e1, e2;
 						{
@@ -325,7 +356,7 @@ void VulkanRenderer::CreateGeometryData()
 					{
 						const auto& t = tangent[a];
 						const auto& b = biTangent[a];
-						const auto& n = _geometryData.normals[vertexOffset + a];
+						const auto& n = out.geometry.normals[vertexOffset + a];
 
 						vec3 oTangent;
 						{
@@ -355,23 +386,317 @@ void VulkanRenderer::CreateGeometryData()
 							handedness = f < 0.f ? 1.f : -1.f;
 						}
 
-						_geometryData.tangents.emplace_back(vec4{ oTangent.x, oTangent.y, oTangent.z, handedness });
+						out.geometry.tangents.emplace_back(vec4{ oTangent.x, oTangent.y, oTangent.z, handedness });
 					}
 				}
 			}
 
+			out.draws.push_back(di);
 		}
-			
-		_drawInfo.push_back(di);
 
 		for (auto& childIdx : node.children)
 		{
-			auto& child = _model.nodes[node.children[childIdx]];
+			auto& child = model.nodes[node.children[childIdx]];
 			GetLocalMatrix(child);
 		}
 	}
 }
 
+unsigned int VulkanRenderer::CommitGeometry(ModelData& model)
+{
+	if (model.geometry.positions.empty()) return 0;
+
+	unsigned int id = _geometryArena.AddMesh(model.geometry, model.draws);
+	if (!id) std::cout << "Error: geometry arena is full, " << model.geometry.positions.size() << " vertices / " << model.geometry.indices.size() << " indices dropped\n";
+	return id;
+}
+
+//before the first frame there is no arena yet, the offscreen buffers setup commits pending models
+unsigned int VulkanRenderer::AddModel(ModelData&& model)
+{
+	if (!_geometryArena.IsCreated())
+	{
+		_pendingModels.push_back(std::move(model));
+		return 0;
+	}
+	return CommitGeometry(model);
+}
+
+unsigned int VulkanRenderer::AddModel(const std::string& filename)
+{
+	ModelData model;
+	if (!LoadModel(filename, model)) return 0;
+	//only scenes upload textures
+	for (auto& di : model.draws) di.textureIndex = -1;
+	return AddModel(std::move(model));
+}
+
+void VulkanRenderer::RemoveModel(unsigned int id)
+{
+	_geometryArena.RemoveMesh(id);
+}
+
+//an image per cooked texture with every mip queued on the staging ring
+//the ring is grown to hold the whole batch, so the next flush uploads all of them in one submission, it shrinks back once they're done
+//returns which of 'textures' were appended to 'out', in order
+std::vector<size_t> VulkanRenderer::UploadTextures(const std::vector<Cooked::TextureData>& textures, const std::vector<std::string>& names, std::vector<Image>& out)
+{
+	std::vector<size_t> uploaded;
+	VkDeviceSize batchSize = 0;
+	for (auto& texture : textures) batchSize += (texture.data.size() + 15) / 16 * 16;
+	_staging.Reserve(batchSize);
+
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		const Cooked::TextureData& texture = textures[i];
+		const Cooked::TextureHeader& header = texture.header;
+		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+		if (header.format == Cooked::TextureFormat::BC1) format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		else if (header.format == Cooked::TextureFormat::BC3) format = VK_FORMAT_BC3_UNORM_BLOCK;
+
+		Image image;
+		if (_allocator.CreateImage({ header.width, header.height, 1 }, header.mipCount, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, "Texture: " + names[i]) != VK_SUCCESS)
+		{
+			std::cout << "Error: can't create a " << header.width << "x" << header.height << " texture\n";
+			continue;
+		}
+		GvkHelper::create_image_view(_device, image.image, format, VK_IMAGE_ASPECT_COLOR_BIT, header.mipCount, nullptr, &image.imageView);
+
+		std::vector<VkBufferImageCopy> regions;
+		for (uint32_t mip = 0; mip < texture.mips.size(); mip++)
+		{
+			VkBufferImageCopy region = {};
+			region.bufferOffset = texture.mips[mip].byteOffset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+			region.imageExtent = { texture.mips[mip].width, texture.mips[mip].height, 1 };
+			regions.push_back(region);
+		}
+
+		if (_staging.UploadImage(image.image, header.mipCount, regions, texture.data.data(), texture.data.size()) == StagingRing::FAILED)
+		{
+			std::cout << "Error: can't upload texture " << names[i] << ", skipping it\n";
+			_allocator.DestroyImage(image);
+			continue;
+		}
+		out.push_back(image);
+		uploaded.push_back(i);
+	}
+	return uploaded;
+}
+
+//scene files list gltf assets, each with an optional transform and instance count, plus optional point lights:
+//{ "models": [ { "path": "...", "translation": [x,y,z], "rotation": [x,y,z,w], "scale": [x,y,z], "instances": n, "offset": [x,y,z] } ],
+//  "lights": [ { "position": [x,y,z], "color": [r,g,b], "radius": r } ] }
+//instance i is placed at translation + offset * i, instances share geometry and only add draws
+bool VulkanRenderer::LoadScene(const std::string& filename)
+{
+	std::ifstream sceneFile(filename);
+	if (!sceneFile)
+	{
+		std::cout << "Error: can't open scene " << filename << '\n';
+		return false;
+	}
+
+	nlohmann::json scene = nlohmann::json::parse(sceneFile, nullptr, false);
+	if (scene.is_discarded() || !scene.contains("models") || !scene["models"].is_array())
+	{
+		std::cout << "Error: " << filename << " is not a valid scene file\n";
+		return false;
+	}
+
+	return LoadScene(scene);
+}
+
+bool VulkanRenderer::LoadScene(const nlohmann::json& scene)
+{
+	//json throws on a field of the wrong type, entries with one are skipped instead
+	auto isNumbers = [](const nlohmann::json& entry, const char* key)
+		{
+			auto field = entry.find(key);
+			return field == entry.end() || (field->is_array() && std::all_of(field->begin(), field->end(), [](const nlohmann::json& v) { return v.is_number(); }));
+		};
+	auto isModel = [&](const nlohmann::json& entry)
+		{
+			return entry.is_object() && entry.contains("path") && entry["path"].is_string() && isNumbers(entry, "translation") && isNumbers(entry, "rotation")
+				&& isNumbers(entry, "scale") && isNumbers(entry, "offset") && (!entry.contains("instances") || entry["instances"].is_number_unsigned());
+		};
+
+	if (scene.contains("lights") && scene["lights"].is_array())
+	{
+		_sceneLights.clear();
+		for (auto& entry : scene["lights"])
+		{
+			if (!entry.is_object() || !isNumbers(entry, "position") || !isNumbers(entry, "color") || (entry.contains("radius") && !entry["radius"].is_number()))
+			{
+				std::cout << "Warning: skipping scene light with a field of the wrong type\n";
+				continue;
+			}
+
+			std::vector<float> position = entry.value("position", std::vector<float>{ 0, 0, 0 });
+			std::vector<float> color = entry.value("color", std::vector<float>{ 1, 1, 1 });
+			if (position.size() != 3 || color.size() != 3) continue;
+
+			Light light = {};
+			light.pos = { position[0], position[1], position[2] };
+			light.col = { color[0], color[1], color[2] };
+			light.radius = entry.value("radius", 5.f);
+			_sceneLights.push_back(light);
+		}
+
+		if (_sceneLights.size() > MAX_LIGHTS) std::cout << "Warning: scene has " << _sceneLights.size() << " lights, only the first " << MAX_LIGHTS << " are used\n";
+		UpdateLights();
+	}
+
+	//every distinct asset loads once, on its own thread
+	std::vector<std::string> paths;
+	for (auto& entry : scene["models"])
+	{
+		if (!isModel(entry))
+		{
+			std::cout << "Warning: skipping scene model with a missing path or a field of the wrong type\n";
+			continue;
+		}
+		std::string path = entry.value("path", "");
+		if (!path.empty() && !DoesVectorContain(paths, path)) paths.push_back(path);
+	}
+
+	std::vector<ModelData> models(paths.size());
+	std::vector<std::future<bool>> loads;
+	for (size_t i = 0; i < paths.size(); i++)
+		loads.push_back(std::async(std::launch::async, [this, &paths, &models, i]() { return LoadModel(paths[i], models[i]); }));
+
+	std::vector<bool> loaded;
+	for (auto& load : loads) loaded.push_back(load.get());
+
+	//textures shared between assets load once, then upload together
+	std::vector<std::string> texturePaths;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		for (auto& path : models[i].texturePaths)
+			if (loaded[i] && !path.empty() && !DoesVectorContain(texturePaths, path)) texturePaths.push_back(path);
+	}
+
+	std::vector<Cooked::TextureData> textures(texturePaths.size());
+	std::vector<std::future<bool>> textureLoads;
+	for (size_t i = 0; i < texturePaths.size(); i++)
+		textureLoads.push_back(std::async(std::launch::async, [&texturePaths, &textures, i]() { return Cooked::ReadTexture(texturePaths[i], textures[i]); }));
+
+	std::vector<Cooked::TextureData> readTextures;
+	std::vector<std::string> readPaths;
+	for (size_t i = 0; i < texturePaths.size(); i++)
+	{
+		if (textureLoads[i].get())
+		{
+			readTextures.push_back(std::move(textures[i]));
+			readPaths.push_back(texturePaths[i]);
+		}
+		else std::cout << "Warning: can't read cooked texture " << texturePaths[i] << '\n';
+	}
+	size_t firstTexture = _sceneTextures.size();
+	std::vector<size_t> uploaded = UploadTextures(readTextures, readPaths, _sceneTextures);
+
+	//the bindless set can't change under a frame in flight
+	if (_frameStats.frame > 0 && _bindless.IsCreated()) vkDeviceWaitIdle(_device);
+	std::vector<int> bindlessIndices(readPaths.size(), -1);
+	for (size_t i = 0; i < uploaded.size(); i++)
+	{
+		uint32_t index = _bindless.Register(_sceneTextures[firstTexture + i].imageView);
+		if (index == BindlessTextures::INVALID) continue;
+		_sceneTextureIndices.push_back(index);
+		bindlessIndices[uploaded[i]] = (int)index;
+	}
+
+	//draws index their asset's texture list until here, from now on the bindless array
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		for (auto& di : models[i].draws)
+		{
+			int texture = di.textureIndex;
+			di.textureIndex = -1;
+			if (texture < 0 || texture >= (int)models[i].texturePaths.size()) continue;
+
+			size_t read = std::find(readPaths.begin(), readPaths.end(), models[i].texturePaths[texture]) - readPaths.begin();
+			if (read < bindlessIndices.size()) di.textureIndex = bindlessIndices[read];
+		}
+	}
+
+	//one draw per (instance, primitive), all referencing the asset's single copy of the geometry
+	std::vector<std::vector<DrawInfo>> draws(paths.size());
+	for (auto& entry : scene["models"])
+	{
+		if (!isModel(entry)) continue;
+		size_t modelIdx = std::find(paths.begin(), paths.end(), entry.value("path", "")) - paths.begin();
+		if (modelIdx == paths.size() || !loaded[modelIdx]) continue;
+
+		tinygltf::Node placement;
+		if (entry.contains("translation")) placement.translation = entry["translation"].get<std::vector<double>>();
+		if (entry.contains("rotation")) placement.rotation = entry["rotation"].get<std::vector<double>>();
+		if (entry.contains("scale")) placement.scale = entry["scale"].get<std::vector<double>>();
+		std::vector<double> offset = entry.value("offset", std::vector<double>{ 0, 0, 0 });
+		if (placement.translation.size() != 3) placement.translation = { 0, 0, 0 };
+
+		unsigned int instances = entry.value("instances", 1u);
+		for (unsigned int instance = 0; instance < instances; instance++)
+		{
+			tinygltf::Node node = placement;
+			for (int axis = 0; axis < 3 && axis < (int)offset.size(); axis++) node.translation[axis] += offset[axis] * instance;
+			mat4 instanceWorld = GetLocalMatrix(node);
+
+			for (DrawInfo di : models[modelIdx].draws)
+			{
+				GMatrix::MultiplyMatrixF(di.nodeWorld, instanceWorld, di.nodeWorld);
+				draws[modelIdx].push_back(di);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (draws[i].empty()) continue;
+		models[i].draws = std::move(draws[i]);
+		if (unsigned int id = AddModel(std::move(models[i]))) _sceneModels.push_back(id);
+	}
+
+	return std::find(loaded.begin(), loaded.end(), false) == loaded.end();
+}
+
+void VulkanRenderer::UnloadScene()
+{
+	for (auto id : _sceneModels) _geometryArena.RemoveMesh(id);
+	_sceneModels.clear();
+	_pendingModels.clear();
+
+	//textures aren't retired per frame like geometry, unloading a scene is rare enough to just drain the gpu
+	if (!_sceneTextures.empty())
+	{
+		_staging.FlushAndWait();
+		vkDeviceWaitIdle(_device);
+		for (auto index : _sceneTextureIndices) _bindless.Unregister(index);
+		for (auto& texture : _sceneTextures) _allocator.DestroyImage(texture);
+		_sceneTextures.clear();
+		_sceneTextureIndices.clear();
+	}
+}
+
+//copies _sceneLights into the composition UB data, before it exists the composition buffers setup picks them up
+void VulkanRenderer::UpdateLights()
+{
+	if (!_compositionUB.IsValid()) return;
+
+	auto& data = _frameGraph->Get(_compositionUB).data[0];
+	data.lightCount = std::min<unsigned int>(_sceneLights.size(), MAX_LIGHTS);
+	std::copy(_sceneLights.begin(), _sceneLights.begin() + data.lightCount, data.lights);
+}
+
+//only takes effect once the offscreen buffers exist, i.e. after the first frame
+void VulkanRenderer::SetView(vec4 eye, vec4 target)
+{
+	if (!_offscreenUB.IsValid()) return;
+
+	auto& data = _frameGraph->Get(_offscreenUB).data[0];
+	GMatrix::LookAtLHF(eye, target, vec4{ 0, 1, 0 }, data.view);
+}
+
 void VulkanRenderer::CreateFrameGraphNodes()
 {
 	FrameGraphNode offscreenBuffers;
@@ -380,38 +705,44 @@ void VulkanRenderer::CreateFrameGraphNodes()
 		offscreenBuffers.outputResources = { "Vertex Buffers", "Index Buffer", "Offscreen UB" };
 		offscreenBuffers.Setup = [&](FrameGraphNode& node)
 			{
+				//fixed-capacity heaps, big enough for whatever was loaded before the first frame
+				uint32_t pendingVertices = 0, pendingIndices = 0;
+				for (auto& model : _pendingModels)
+				{
+					pendingVertices += model.geometry.positions.size();
+					pendingIndices += model.geometry.indices.size();
+				}
+
+				_geometryArena.Create(_allocator, _staging,
+					std::max(GeometryArena::DEFAULT_VERTEX_CAPACITY, pendingVertices),
+					std::max(GeometryArena::DEFAULT_INDEX_CAPACITY, pendingIndices),
+					MAX_FRAMES);
+
+				//anything loaded before the first frame belongs to the startup scene
+				for (auto& model : _pendingModels)
+				{
+					if (unsigned int id = CommitGeometry(model)) _sceneModels.push_back(id);
+				}
+				_pendingModels.clear();
+
 				FrameGraphBufferResource<Vertex> vertexBuffers;
 				{
 					vertexBuffers.parent = node.name;
 					vertexBuffers.name = node.outputResources[0];
-					CreateGeometryData();
-					vertexBuffers.buffers.resize(4);
-					//position
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(vec3) * _geometryData.positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vertexBuffers.buffers[0].buffer, &vertexBuffers.buffers[0].memory);
-					GvkHelper::write_to_buffer(_device, vertexBuffers.buffers[0].memory, _geometryData.positions.data(), sizeof(vec3) * _geometryData.positions.size());
-					//normal
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(vec3) * _geometryData.normals.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vertexBuffers.buffers[1].buffer, &vertexBuffers.buffers[1].memory);
-					GvkHelper::write_to_buffer(_device, vertexBuffers.buffers[1].memory, _geometryData.normals.data(), sizeof(vec3) * _geometryData.normals.size());
-					//texcoord
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(vec2) * _geometryData.texCoords.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vertexBuffers.buffers[2].buffer, &vertexBuffers.buffers[2].memory);
-					GvkHelper::write_to_buffer(_device, vertexBuffers.buffers[2].memory, _geometryData.texCoords.data(), sizeof(vec2) * _geometryData.texCoords.size());
-					//tangent
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(vec4) * _geometryData.tangents.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vertexBuffers.buffers[3].buffer, &vertexBuffers.buffers[3].memory);
-					GvkHelper::write_to_buffer(_device, vertexBuffers.buffers[3].memory, _geometryData.tangents.data(), sizeof(vec4) * _geometryData.tangents.size());
+					//position, normal, texcoord, tangent
+					for (unsigned int i = 0; i < 4; i++) vertexBuffers.buffers.push_back(_geometryArena.GetVertexBuffer(i));
 				}
 				vertexBuffers.prepared = true;
-				_frameGraph->AddBufferResource(vertexBuffers.name, vertexBuffers);
+				_vertexBuffers = _frameGraph->AddBufferResource(vertexBuffers.name, vertexBuffers);
 
 				FrameGraphBufferResource<unsigned int> indexBuffer;
 				{
 					indexBuffer.parent = node.name;
 					indexBuffer.name = node.outputResources[1];
-					indexBuffer.buffers.resize(1);
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(unsigned int) * _geometryData.indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &indexBuffer.buffers[0].buffer, &indexBuffer.buffers[0].memory);
-					GvkHelper::write_to_buffer(_device, indexBuffer.buffers[0].memory, _geometryData.indices.data(), sizeof(unsigned int) * _geometryData.indices.size());
+					indexBuffer.buffers.push_back(_geometryArena.GetIndexBuffer());
 				}
 				indexBuffer.prepared = true;
-				_frameGraph->AddBufferResource(indexBuffer.name, indexBuffer);
+				_indexBuffer = _frameGraph->AddBufferResource(indexBuffer.name, indexBuffer);
 
 				FrameGraphBufferResource<UniformBufferOffscreen> offscreenUniformBuffer;
 				{
@@ -428,11 +759,11 @@ void VulkanRenderer::CreateFrameGraphNodes()
 
 					offscreenUniformBuffer.data.push_back(data);
 
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(UniformBufferOffscreen), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &offscreenUniformBuffer.buffers[0].buffer, &offscreenUniformBuffer.buffers[0].memory);
-					GvkHelper::write_to_buffer(_device, offscreenUniformBuffer.buffers[0].memory, &data, sizeof(UniformBufferOffscreen));
+					//the data is pushed to the uniform ring every frame, bound with a dynamic offset
+					offscreenUniformBuffer.buffers[0] = _uniforms.GetBuffer();
 				}
 				offscreenUniformBuffer.prepared = true;
-				_frameGraph->AddBufferResource(offscreenUniformBuffer.name, offscreenUniformBuffer);
+				_offscreenUB = _frameGraph->AddBufferResource(offscreenUniformBuffer.name, offscreenUniformBuffer);
 
 				node.isSetupComplete = true;
 			};
@@ -449,111 +780,127 @@ void VulkanRenderer::CreateFrameGraphNodes()
 		offscreenPass.name = "Offscreen Pass";
 		offscreenPass.inputResources = { "Vertex Buffers", "Index Buffer", "Offscreen UB" };
 		offscreenPass.outputResources = { "GBuffer: Position", "GBuffer: Normal", "GBuffer: Albedo", "Depth Buffer" };
-		offscreenPass.Setup = [&](FrameGraphNode& node)
+		//the compact layout has no position target, the composition pass rebuilds positions from depth
+		if (_gBufferLayout == GBufferLayout::COMPACT) offscreenPass.outputResources.erase(offscreenPass.outputResources.begin());
+		//every target is cleared, depth is last
+		for (auto& output : offscreenPass.outputResources) offscreenPass.access[output] = ResourceAccess::COLOR_WRITE;
+		offscreenPass.access[offscreenPass.outputResources.back()] = ResourceAccess::DEPTH_WRITE;
+		offscreenPass.Declare = [&](FrameGraphNode& node)
 			{
-				//assert that input resources are prepared
-				//Debug::CheckInputResources(*_frameGraph, offscreenPass);
-
-				FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->GetBufferResource<UniformBufferOffscreen>(node.inputResources[2]);
+				const bool compact = _gBufferLayout == GBufferLayout::COMPACT;
+				const size_t nrmIndex = compact ? 0 : 1;
+				//merged with the composition pass the gbuffer is read as input attachments
+				const VkImageUsageFlags readUsage = _frameGraph->GetMergedNode(node) ? VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT : VK_IMAGE_USAGE_SAMPLED_BIT;
 
-				//FRAMEBUFFER
+				FrameGraphImageResource gBufferPos, gBufferNrm, gBufferAlb, depth;
 				{
-					FrameGraphImageResource gBufferPos, gBufferNrm, gBufferAlb, depth;
+					//only described here, the frame graph places them once they are all registered
+					//Gbuffer Position
+					if (!compact)
 					{
-						//Gbuffer Position
 						gBufferPos.name = node.outputResources[0];
 						gBufferPos.parent = node.name;
 						gBufferPos.extent = { _width, _height, 1 };
 						gBufferPos.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-						GvkHelper::create_image(_physicalDevice, _device, gBufferPos.extent, 1, VK_SAMPLE_COUNT_1_BIT, gBufferPos.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, &gBufferPos.image.image, &gBufferPos.image.memory);
-						GvkHelper::create_image_view(_device, gBufferPos.image.image, gBufferPos.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, nullptr, &gBufferPos.image.imageView);
-
-						//Gbuffer Normal
-						gBufferNrm.name = node.outputResources[1];
-						gBufferNrm.parent = node.name;
-						gBufferNrm.extent = { _width, _height, 1 };
-						gBufferNrm.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-						GvkHelper::create_image(_physicalDevice, _device, gBufferNrm.extent, 1, VK_SAMPLE_COUNT_1_BIT, gBufferNrm.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, &gBufferNrm.image.image, &gBufferNrm.image.memory);
-						GvkHelper::create_image_view(_device, gBufferNrm.image.image, gBufferNrm.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, nullptr, &gBufferNrm.image.imageView);
-
-						//Gbuffer Albedo
-						gBufferAlb.name = node.outputResources[2];
-						gBufferAlb.parent = node.name;
-						gBufferAlb.extent = { _width, _height, 1 };
-						gBufferAlb.format = VK_FORMAT_R8G8B8A8_UNORM;
-						GvkHelper::create_image(_physicalDevice, _device, gBufferAlb.extent, 1, VK_SAMPLE_COUNT_1_BIT, gBufferAlb.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, &gBufferAlb.image.image, &gBufferAlb.image.memory);
-						GvkHelper::create_image_view(_device, gBufferAlb.image.image, gBufferAlb.format, VK_IMAGE_ASPECT_COLOR_BIT, 1, nullptr, &gBufferAlb.image.imageView);
-
-						std::vector<VkFormat> formats =
-						{
-							VK_FORMAT_D32_SFLOAT_S8_UINT,
-							VK_FORMAT_D32_SFLOAT,
-							VK_FORMAT_D24_UNORM_S8_UINT,
-							VK_FORMAT_D16_UNORM_S8_UINT,
-							VK_FORMAT_D16_UNORM
-						};
+						gBufferPos.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage;
+					}
+
+					//Gbuffer Normal, octahedral encoded in two halfs when compact
+					gBufferNrm.name = node.outputResources[nrmIndex];
+					gBufferNrm.parent = node.name;
+					gBufferNrm.extent = { _width, _height, 1 };
+					gBufferNrm.format = compact ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R16G16B16A16_SFLOAT;
+					gBufferNrm.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage;
+
+					//Gbuffer Albedo, specular in alpha
+					gBufferAlb.name = node.outputResources[nrmIndex + 1];
+					gBufferAlb.parent = node.name;
+					gBufferAlb.extent = { _width, _height, 1 };
+					gBufferAlb.format = VK_FORMAT_R8G8B8A8_UNORM;
+					gBufferAlb.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage;
+
+					std::vector<VkFormat> formats =
+					{
+						VK_FORMAT_D32_SFLOAT_S8_UINT,
+						VK_FORMAT_D32_SFLOAT,
+						VK_FORMAT_D24_UNORM_S8_UINT,
+						VK_FORMAT_D16_UNORM_S8_UINT,
+						VK_FORMAT_D16_UNORM
+					};
 
-						depth.name = node.outputResources[3];
-						depth.parent = node.name;
-						depth.extent = { _width, _height, 1 };
-						//set format
-						GvkHelper::find_depth_format(_physicalDevice, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT, formats.data(), &depth.format);
-						GvkHelper::create_image(_physicalDevice, _device, depth.extent, 1, VK_SAMPLE_COUNT_1_BIT, depth.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, &depth.image.image, &depth.image.memory);
-						GvkHelper::create_image_view(_device, depth.image.image, depth.format, VK_IMAGE_ASPECT_DEPTH_BIT, 1, nullptr, &depth.image.imageView);
+					//the compact layout samples depth, stencil would only add bytes
+					VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+					if (compact)
+					{
+						formats.insert(formats.begin(), VK_FORMAT_D32_SFLOAT);
+						depthFeatures |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
 					}
 
-					gBufferPos.prepared = true;
-					gBufferNrm.prepared = true;
-					gBufferAlb.prepared = true;
-					depth.prepared = true;
-					_frameGraph->AddImageResource(gBufferPos.name, gBufferPos);
-					_frameGraph->AddImageResource(gBufferNrm.name, gBufferNrm);
-					_frameGraph->AddImageResource(gBufferAlb.name, gBufferAlb);
-					_frameGraph->AddImageResource(depth.name, depth);
+					depth.name = node.outputResources[nrmIndex + 2];
+					depth.parent = node.name;
+					depth.extent = { _width, _height, 1 };
+					//set format
+					GvkHelper::find_depth_format(_physicalDevice, VK_IMAGE_TILING_OPTIMAL, depthFeatures, formats.data(), &depth.format);
+					depth.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | readUsage;
+					depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+				}
+
+				gBufferPos.prepared = true;
+				gBufferNrm.prepared = true;
+				gBufferAlb.prepared = true;
+				depth.prepared = true;
+				if (!compact) _frameGraph->AddImageResource(gBufferPos.name, gBufferPos);
+				_frameGraph->AddImageResource(gBufferNrm.name, gBufferNrm);
+				_frameGraph->AddImageResource(gBufferAlb.name, gBufferAlb);
+				_frameGraph->AddImageResource(depth.name, depth);
+			};
+		offscreenPass.Setup = [&](FrameGraphNode& node)
+			{
+				//assert that input resources are prepared
+				//Debug::CheckInputResources(*_frameGraph, offscreenPass);
+
+				FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->Get(_offscreenUB);
+
+				//FRAMEBUFFER
+				{
+					//the composition pass as a second subpass, it reads the gbuffer as input attachments and draws to the swapchain
+					FrameGraphNode* composition = _frameGraph->GetMergedNode(node);
 
 					//FrameGraphImageResource* depthResource = dynamic_cast<FrameGraphImageResource*>(_frameGraph->GetResource(offscreenPass.inputResources[0]));
 
-					std::array<VkAttachmentDescription, 4> attachmentDescription;
+					//color targets in output order, depth last
+					std::vector<FrameGraphImageResource*> attachments;
+					for (auto& output : node.outputResources) attachments.push_back(&_frameGraph->GetImageResource(output));
+					const uint32_t depthIndex = attachments.size() - 1;
+
+					std::vector<VkAttachmentDescription> attachmentDescription(attachments.size());
+					_frameStats.gBufferBytesPerPixel = 0.f;
 
-					for (size_t i = 0; i < 4; i++)
+					for (size_t i = 0; i < attachments.size(); i++)
 					{
 						attachmentDescription[i].flags = 0;
+						attachmentDescription[i].format = attachments[i]->format;
 						attachmentDescription[i].samples = VK_SAMPLE_COUNT_1_BIT;
 						attachmentDescription[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 						attachmentDescription[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 						attachmentDescription[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 						attachmentDescription[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-						if (i == 3)
-						{
-							attachmentDescription[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-							attachmentDescription[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-						}
-						else
-						{
-							attachmentDescription[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-							attachmentDescription[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-						}
+						//the frame graph moves them in and out of the attachment layouts, the pass itself doesn't transition
+						//merged, it leaves them in the read layouts the frame graph expects after the composition pass
+						attachmentDescription[i].initialLayout = i == depthIndex ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+						attachmentDescription[i].finalLayout = attachmentDescription[i].initialLayout;
+						if (composition) attachmentDescription[i].finalLayout = i == depthIndex ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+						//attachments no later node reads are never written back to memory
+						if (attachments[i]->passLocal) attachmentDescription[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+						else _frameStats.gBufferBytesPerPixel += static_cast<float>(attachments[i]->image.allocation.size) / (_width * _height);
 					}
 
-					FrameGraphImageResource* posResource = &_frameGraph->GetImageResource(node.outputResources[0]),
-						* nrmResource = &_frameGraph->GetImageResource(node.outputResources[1]),
-						* albResource = &_frameGraph->GetImageResource(node.outputResources[2]),
-						* depthResource = &_frameGraph->GetImageResource(node.outputResources[3]);
-
-					//formats
-					attachmentDescription[0].format = posResource->format;
-					attachmentDescription[1].format = nrmResource->format;
-					attachmentDescription[2].format = albResource->format;
-					attachmentDescription[3].format = depthResource->format;
-
 					std::vector<VkAttachmentReference> colorAttachmentReference;
-					colorAttachmentReference.push_back({ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-					colorAttachmentReference.push_back({ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-					colorAttachmentReference.push_back({ 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+					for (uint32_t i = 0; i < depthIndex; i++) colorAttachmentReference.push_back({ i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
 
 					VkAttachmentReference depthAttachmentReference;
-					depthAttachmentReference.attachment = 3;
+					depthAttachmentReference.attachment = depthIndex;
 					depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 					VkSubpassDescription subpassDescription;
@@ -568,51 +915,103 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					subpassDescription.preserveAttachmentCount = 0;
 					subpassDescription.pResolveAttachments = nullptr;
 
-					// Use subpass dependencies for attachment layout transitions
-					std::array<VkSubpassDependency, 2> subpassDependencies;
-					subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-					subpassDependencies[0].dstSubpass = 0;
-					subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-					subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-					subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-					subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-					subpassDependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-					subpassDependencies[1].srcSubpass = 0;
-					subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-					subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-					subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-					subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-					subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-					subpassDependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
+					//no external dependencies, the frame graph's barriers before this pass and the composition pass cover them
 					VkRenderPassCreateInfo renderPassCreateInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
 					renderPassCreateInfo.pAttachments = attachmentDescription.data();
 					renderPassCreateInfo.attachmentCount = attachmentDescription.size();
 					renderPassCreateInfo.subpassCount = 1;
 					renderPassCreateInfo.pSubpasses = &subpassDescription;
-					renderPassCreateInfo.dependencyCount = subpassDependencies.size();
-					renderPassCreateInfo.pDependencies = subpassDependencies.data();
+					renderPassCreateInfo.dependencyCount = 0;
+					renderPassCreateInfo.pDependencies = nullptr;
+
+					//COMPOSITION SUBPASS
+					std::vector<VkAttachmentReference> inputAttachmentReference;
+					VkAttachmentReference swapchainAttachmentReference = { static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+					std::array<VkSubpassDescription, 2> subpassDescriptions = { subpassDescription, {} };
+					std::array<VkSubpassDependency, 2> subpassDependencies = {};
+					if (composition)
+					{
+						//the swapchain image goes last, like Gateware's render pass it starts undefined and ends ready to present
+						VkSurfaceKHR surface;
+						VkSurfaceFormatKHR surfaceFormat;
+						_vlk.GetSurface((void**)&surface);
+						GvkHelper::get_best_surface_formats(_physicalDevice, surface, &surfaceFormat);
+
+						VkAttachmentDescription swapchainDescription = {};
+						swapchainDescription.format = surfaceFormat.format;
+						swapchainDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+						swapchainDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+						swapchainDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+						swapchainDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+						swapchainDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+						swapchainDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+						swapchainDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+						attachmentDescription.push_back(swapchainDescription);
+
+						//input_attachment_index follows the composition pass's input order
+						for (auto& input : composition->inputResources)
+						{
+							auto output = std::find(node.outputResources.begin(), node.outputResources.end(), input);
+							if (output == node.outputResources.end()) continue;
+							uint32_t index = static_cast<uint32_t>(output - node.outputResources.begin());
+							inputAttachmentReference.push_back({ index, index == depthIndex ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+						}
+
+						subpassDescriptions[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+						subpassDescriptions[1].colorAttachmentCount = 1;
+						subpassDescriptions[1].pColorAttachments = &swapchainAttachmentReference;
+						subpassDescriptions[1].inputAttachmentCount = static_cast<uint32_t>(inputAttachmentReference.size());
+						subpassDescriptions[1].pInputAttachments = inputAttachmentReference.data();
+
+						//gbuffer writes to the composition's reads of the same pixel, which keeps them in tile memory
+						subpassDependencies[0].srcSubpass = 0;
+						subpassDependencies[0].dstSubpass = 1;
+						subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+						subpassDependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+						subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+						subpassDependencies[0].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+						subpassDependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+						//the swapchain image's transition waits for the acquire semaphore, which the submission waits on at this stage
+						subpassDependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+						subpassDependencies[1].dstSubpass = 1;
+						subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+						subpassDependencies[1].srcAccessMask = 0;
+						subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+						subpassDependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+						renderPassCreateInfo.pAttachments = attachmentDescription.data();
+						renderPassCreateInfo.attachmentCount = attachmentDescription.size();
+						renderPassCreateInfo.subpassCount = subpassDescriptions.size();
+						renderPassCreateInfo.pSubpasses = subpassDescriptions.data();
+						renderPassCreateInfo.dependencyCount = subpassDependencies.size();
+						renderPassCreateInfo.pDependencies = subpassDependencies.data();
+					}
 
 					vkCreateRenderPass(_device, &renderPassCreateInfo, nullptr, &node.frameBuffer.renderPass);
 
-					std::array<VkImageView, 4> imageViews =
+					if (composition)
 					{
-						posResource->image.imageView,
-						nrmResource->image.imageView,
-						albResource->image.imageView,
-						depthResource->image.imageView
-					};
-
-					VkFramebufferCreateInfo frameBufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-					frameBufferCreateInfo.renderPass = node.frameBuffer.renderPass;
-					frameBufferCreateInfo.pAttachments = imageViews.data();
-					frameBufferCreateInfo.attachmentCount = static_cast<uint32_t>(imageViews.size());
-					frameBufferCreateInfo.width = _width;
-					frameBufferCreateInfo.height = _height;
-					frameBufferCreateInfo.layers = 1;
-
-					vkCreateFramebuffer(_device, &frameBufferCreateInfo, nullptr, &node.frameBuffer.frameBuffer);
+						_mergedRenderPass = node.frameBuffer.renderPass;
+						_mergedViews.clear();
+						for (auto attachment : attachments) _mergedViews.push_back(attachment->image.imageView);
+						CreateMergedFramebuffers();
+					}
+					else
+					{
+						std::vector<VkImageView> imageViews;
+						for (auto attachment : attachments) imageViews.push_back(attachment->image.imageView);
+
+						VkFramebufferCreateInfo frameBufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+						frameBufferCreateInfo.renderPass = node.frameBuffer.renderPass;
+						frameBufferCreateInfo.pAttachments = imageViews.data();
+						frameBufferCreateInfo.attachmentCount = static_cast<uint32_t>(imageViews.size());
+						frameBufferCreateInfo.width = _width;
+						frameBufferCreateInfo.height = _height;
+						frameBufferCreateInfo.layers = 1;
+
+						vkCreateFramebuffer(_device, &frameBufferCreateInfo, nullptr, &node.frameBuffer.frameBuffer);
+					}
 
 					//create sampler
 					VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
@@ -633,47 +1032,20 @@ void VulkanRenderer::CreateFrameGraphNodes()
 
 				//DESCRIPTOR SET
 				{
-					std::vector<VkDescriptorPoolSize> descriptorPoolSizes =
-					{
-						{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}
-					};
-
-					VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-					descriptorPoolCreateInfo.maxSets = 1;
-					descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
-					descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-
-					vkCreateDescriptorPool(_device, &descriptorPoolCreateInfo, nullptr, &node.frameBuffer.descriptorPool);
-
 					std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings =
 					{
-						{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
+						{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 					};
 
-					VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-					descriptorSetLayoutCreateInfo.bindingCount = descriptorSetLayoutBindings.size();
-					descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
-
-					vkCreateDescriptorSetLayout(_device, &descriptorSetLayoutCreateInfo, nullptr, &node.frameBuffer.descriptorSetLayout);
-
-					VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-					descriptorSetAllocateInfo.descriptorPool = node.frameBuffer.descriptorPool;
-					descriptorSetAllocateInfo.descriptorSetCount = 1;
-					descriptorSetAllocateInfo.pSetLayouts = &node.frameBuffer.descriptorSetLayout;
+					node.frameBuffer.descriptorSetLayout = _descriptorLayouts.Get(descriptorSetLayoutBindings);
+					node.frameBuffer.descriptorSet = _descriptors.Allocate(node.frameBuffer.descriptorSetLayout);
 
-					vkAllocateDescriptorSets(_device, &descriptorSetAllocateInfo, &node.frameBuffer.descriptorSet);
-
-					VkDescriptorBufferInfo descriptorBufferInfo;
-					descriptorBufferInfo.buffer = offscreenUB.buffers[0].buffer;
-					descriptorBufferInfo.offset = 0;
-					descriptorBufferInfo.range = sizeof(UniformBufferOffscreen);
-
-					std::vector<VkWriteDescriptorSet> offscreenWriteDescriptorSets =
-					{
-						MakeWrite(node.frameBuffer.descriptorSet, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, nullptr, &descriptorBufferInfo)
-					};
-
-					vkUpdateDescriptorSets(_device, offscreenWriteDescriptorSets.size(), offscreenWriteDescriptorSets.data(), 0, nullptr);
+					VkDescriptorBufferInfo descriptorBufferInfo = { offscreenUB.buffers[0].buffer, 0, sizeof(UniformBufferOffscreen) };
+					VkDescriptorUpdateTemplate updateTemplate = _descriptorLayouts.GetUpdateTemplate(node.frameBuffer.descriptorSetLayout,
+						{
+							{0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, sizeof(VkDescriptorBufferInfo)}
+						});
+					_descriptorLayouts.Update(node.frameBuffer.descriptorSet, updateTemplate, &descriptorBufferInfo);
 				}
 
 				//GRAPHICS PIPELINE
@@ -682,7 +1054,7 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					{
 						pushConstantRange.offset = 0;
 						pushConstantRange.size = sizeof(PCR);
-						pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+						pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 					}
 
 					_vlk.GetRenderPass((void**)&_renderPass);
@@ -690,8 +1062,8 @@ void VulkanRenderer::CreateFrameGraphNodes()
 
 					node.frameBuffer.shaderModules.resize(2);
 
-					GvkHelper::create_shader(_device, "Shaders/SPV/OffscreenFragmentShader.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT, &node.frameBuffer.shaderModules[0], &pssci);
-					GvkHelper::create_shader(_device, "Shaders/SPV/OffscreenVertexShader.spv", "main", VK_SHADER_STAGE_VERTEX_BIT, &node.frameBuffer.shaderModules[1], &pssci);
+					GvkHelper::create_shader(_device, _shaderCompiler.GetOutputPath("OffscreenFragmentShader").c_str(), "main", VK_SHADER_STAGE_FRAGMENT_BIT, &node.frameBuffer.shaderModules[0], &pssci);
+					GvkHelper::create_shader(_device, _shaderCompiler.GetOutputPath("OffscreenVertexShader").c_str(), "main", VK_SHADER_STAGE_VERTEX_BIT, &node.frameBuffer.shaderModules[1], &pssci);
 
 					VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[2] = { {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}, {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO} };
 					//fragment shader
@@ -793,7 +1165,8 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					pipelineColorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
 					pipelineColorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
 
-					std::vector<VkPipelineColorBlendAttachmentState> pipelineColorBlendAttachmentStates = { pipelineColorBlendAttachmentState, pipelineColorBlendAttachmentState, pipelineColorBlendAttachmentState };
+					//one per color target, depth is last
+					std::vector<VkPipelineColorBlendAttachmentState> pipelineColorBlendAttachmentStates(node.outputResources.size() - 1, pipelineColorBlendAttachmentState);
 
 					//color blend state
 					VkPipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
@@ -818,10 +1191,13 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					pipelineDynamicStateCreateInfo.dynamicStateCount = 2;
 					pipelineDynamicStateCreateInfo.pDynamicStates = dynamicState;
 
-					//descriptor pipeline layout
+					//descriptor pipeline layout, set 1 is the bindless texture array
+					std::vector<VkDescriptorSetLayout> setLayouts = { node.frameBuffer.descriptorSetLayout };
+					if (_bindless.IsCreated()) setLayouts.push_back(_bindless.GetLayout());
+
 					VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-					pipelineLayoutCreateInfo.setLayoutCount = 1;
-					pipelineLayoutCreateInfo.pSetLayouts = &node.frameBuffer.descriptorSetLayout;
+					pipelineLayoutCreateInfo.setLayoutCount = setLayouts.size();
+					pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
 					pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
 					pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
@@ -843,7 +1219,7 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					graphicsPipelineCreateInfo.subpass = 0;
 					graphicsPipelineCreateInfo.basePipelineHandle = nullptr;
 
-					vkCreateGraphicsPipelines(_device, nullptr, 1, &graphicsPipelineCreateInfo, nullptr, &node.frameBuffer.pipeline);
+					_pipelineCache.CreateGraphicsPipeline(graphicsPipelineCreateInfo, node.frameBuffer.pipeline, node.name);
 				}
 
 				node.frameBuffer.bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -851,47 +1227,49 @@ void VulkanRenderer::CreateFrameGraphNodes()
 			};
 		offscreenPass.Execute = [&](VkCommandBuffer& commandBuffer, FrameGraphNode& fgNode)
 			{
-				FrameGraphBufferResource<Vertex>& vBuffer = _frameGraph->GetBufferResource<Vertex>(fgNode.inputResources[0]);
-				FrameGraphBufferResource<unsigned int>& iBuffer = _frameGraph->GetBufferResource<unsigned int>(fgNode.inputResources[1]);
-				FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->GetBufferResource<UniformBufferOffscreen>(fgNode.inputResources[2]);
+				FrameGraphBufferResource<Vertex>& vBuffer = _frameGraph->Get(_vertexBuffers);
+				FrameGraphBufferResource<unsigned int>& iBuffer = _frameGraph->Get(_indexBuffer);
+				FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->Get(_offscreenUB);
 				auto& data = offscreenUB.data[0];
 				auto now = std::chrono::steady_clock::now();
 				_deltaTime = now - _lastUpdate;
 				_lastUpdate = now;
 
 				data.deltaTime = _deltaTime.count();
-				GvkHelper::write_to_buffer(_device, offscreenUB.buffers[0].memory, &data, sizeof(UniformBufferOffscreen));
+				uint32_t uniformOffset = _uniforms.Push(data);
 
 				VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
 
-				// Clear values for all attachments written in the fragment shader
-				std::array<VkClearValue, 4> clearValues;
-				clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-				clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-				clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-				clearValues[3].depthStencil = { 1.0f, 0 };
+				// Clear values for all attachments written in the fragment shader, depth is last
+				std::array<VkClearValue, MAX_OFFSCREEN_ATTACHMENTS> clearValues;
+				uint32_t clearValueCount = (uint32_t)fgNode.outputResources.size();
+				for (uint32_t i = 0; i < clearValueCount; i++) clearValues[i].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+				clearValues[clearValueCount - 1].depthStencil = { 1.0f, 0 };
+
+				//merged, the composition subpass follows in this command buffer and the swapchain image comes after depth
+				const bool merged = _frameGraph->GetMergedNode(fgNode) != nullptr;
+				if (merged) clearValues[clearValueCount++].color = { { 0.2f, 0.0f, 0.0f, 0.0f } };
 
 				VkRenderPassBeginInfo renderPassBeginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
 				renderPassBeginInfo.renderPass = fgNode.frameBuffer.renderPass;
-				renderPassBeginInfo.framebuffer = fgNode.frameBuffer.frameBuffer;
+				renderPassBeginInfo.framebuffer = merged ? _mergedFramebuffers[_imageIndex] : fgNode.frameBuffer.frameBuffer;
 				renderPassBeginInfo.renderArea.extent.width = _width;
 				renderPassBeginInfo.renderArea.extent.height = _height;
-				renderPassBeginInfo.clearValueCount = clearValues.size();
+				renderPassBeginInfo.clearValueCount = clearValueCount;
 				renderPassBeginInfo.pClearValues = clearValues.data();
 
-				GvkHelper::signal_command_start(_device, _commandPool, &commandBuffer);
-				//vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-				vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-				VkViewport viewport = { 0, 0, static_cast<float>(_width), static_cast<float>(_height), 0, 1 };
-				VkRect2D scissor = { {0, 0}, {_width, _height} };
-
-				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fgNode.frameBuffer.pipeline);
-
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fgNode.frameBuffer.pipelineLayout, 0, 1, &fgNode.frameBuffer.descriptorSet, 0, nullptr);
+				commandBuffer = _commandPools.Begin();
+				if (_timestampPool)
+				{
+					vkCmdResetQueryPool(commandBuffer, _timestampPool, _currentFrame * 2, 2);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestampPool, _currentFrame * 2);
+				}
+				_frameGraph->WriteTimestamp(commandBuffer, fgNode, false);
+				//geometry and texture uploads and compaction land before anything draws
+				_staging.Flush(commandBuffer);
+				_staging.RecordAcquires(commandBuffer);
+				_geometryArena.RecordCopies(commandBuffer);
+				_frameGraph->RecordBarriers(commandBuffer, fgNode.barriers);
 
 				std::array<VkBuffer, 4> vertexBuffers =
 				{
@@ -900,27 +1278,85 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					vBuffer.buffers[2].buffer,
 					vBuffer.buffers[3].buffer,
 				};
+				std::array<VkDeviceSize, 4> offsets = { 0, 0, 0, 0 };
+				VkDescriptorSet bindlessSet = _bindless.GetSet();
 
-				std::vector<VkDeviceSize> offsets = { 0, 0, 0, 0 };
-				vkCmdBindVertexBuffers(commandBuffer, 0, vBuffer.buffers.size(), vertexBuffers.data(), offsets.data());
-				vkCmdBindIndexBuffer(commandBuffer, iBuffer.buffers[0].buffer, 0, VK_INDEX_TYPE_UINT32);
+				//secondaries inherit nothing but the render pass, so every chunk sets up the full state
+				const std::vector<DrawInfo>& draws = _geometryArena.GetDraws();
+				auto recordDraws = [&](VkCommandBuffer recording, size_t first, size_t last)
+					{
+						VkViewport viewport = { 0, 0, static_cast<float>(_width), static_cast<float>(_height), 0, 1 };
+						VkRect2D scissor = { {0, 0}, {_width, _height} };
+
+						vkCmdSetViewport(recording, 0, 1, &viewport);
+						vkCmdSetScissor(recording, 0, 1, &scissor);
+
+						vkCmdBindPipeline(recording, VK_PIPELINE_BIND_POINT_GRAPHICS, fgNode.frameBuffer.pipeline);
+
+						//bound once per chunk, draws only change push constants
+						vkCmdBindDescriptorSets(recording, VK_PIPELINE_BIND_POINT_GRAPHICS, fgNode.frameBuffer.pipelineLayout, 0, 1, &fgNode.frameBuffer.descriptorSet, 1, &uniformOffset);
+						if (bindlessSet) vkCmdBindDescriptorSets(recording, VK_PIPELINE_BIND_POINT_GRAPHICS, fgNode.frameBuffer.pipelineLayout, 1, 1, &bindlessSet, 0, nullptr);
+
+						vkCmdBindVertexBuffers(recording, 0, vBuffer.buffers.size(), vertexBuffers.data(), offsets.data());
+						vkCmdBindIndexBuffer(recording, iBuffer.buffers[0].buffer, 0, VK_INDEX_TYPE_UINT32);
+
+						for (size_t i = first; i < last; i++)
+						{
+							const DrawInfo& di = draws[i];
+							PCR pcr = { di.nodeWorld, (uint32_t)di.textureIndex };
+							vkCmdPushConstants(recording, fgNode.frameBuffer.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PCR), &pcr);
+							vkCmdDrawIndexed(recording, di.idxCount, 1, di.firstIdx, di.vertexOffset, 0);
+						}
+					};
 
-				int i = 0;
-				for (auto& node : _model.nodes)
+				//without its uniforms the pass only clears
+				size_t drawCount = uniformOffset == UniformRing::FAILED ? 0 : draws.size();
+
+				//one chunk per worker, small draw lists aren't worth the hand off
+				size_t chunks = std::min<size_t>(_recordWorkers.GetThreadCount(), drawCount / MIN_DRAWS_PER_CHUNK);
+				if (chunks < 2)
 				{
-					auto& mesh = _model.meshes[node.mesh];
-					for (auto& prim : mesh.primitives)
-					{
-						vkCmdPushConstants(commandBuffer, fgNode.frameBuffer.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PCR), &_drawInfo[i].nodeWorld);
-						vkCmdDrawIndexed(commandBuffer, _drawInfo[i].idxCount, 1, _drawInfo[i].firstIdx, _drawInfo[i].vertexOffset, 0);
-						i++;
-					}
+					vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+					if (drawCount) recordDraws(commandBuffer, 0, drawCount);
 				}
+				else
+				{
+					vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-				vkCmdEndRenderPass(commandBuffer);
-				vkEndCommandBuffer(commandBuffer);
-				_commandBuffers[0].clear();
-				_commandBuffers[0].push_back(commandBuffer);
+					VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+					inheritanceInfo.renderPass = fgNode.frameBuffer.renderPass;
+					inheritanceInfo.subpass = 0;
+					inheritanceInfo.framebuffer = renderPassBeginInfo.framebuffer;
+
+					//worker i records chunk i from pool i + 1, executed in order so draw order is unchanged
+					auto recordChunk = [&](unsigned int worker)
+						{
+							_secondaries[worker] = _commandPools.BeginSecondary(worker + 1, inheritanceInfo);
+							recordDraws(_secondaries[worker], drawCount * worker / chunks, drawCount * (worker + 1) / chunks);
+							vkEndCommandBuffer(_secondaries[worker]);
+						};
+					_recordWorkers.Run((unsigned int)chunks, recordChunk);
+
+					vkCmdExecuteCommands(commandBuffer, (uint32_t)chunks, _secondaries.data());
+				}
+
+				_frameStats.draws = draws.size();
+				_frameStats.triangles = 0;
+				for (auto& di : draws) _frameStats.triangles += di.idxCount / 3;
+				_frameStats.geometryBytes = _geometryArena.GetUsedBytes();
+
+				//the composition pass ends the render pass and the command buffer
+				if (!merged) vkCmdEndRenderPass(commandBuffer);
+				_frameGraph->WriteTimestamp(commandBuffer, fgNode, true);
+				if (!merged) vkEndCommandBuffer(commandBuffer);
+				fgNode.submission.commandBuffers.push_back(commandBuffer);
+
+				//async uploads the arena draws from have completed by the value sampled in BeginFrame, the wait only makes their writes visible
+				if (_staging.IsAsync())
+				{
+					fgNode.submission.WaitTimeline(_staging.GetTimeline(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+						_staging.GetCompletedValue());
+				}
 
 				//Prepare(fgNode);
 			};
@@ -946,115 +1382,240 @@ void VulkanRenderer::CreateFrameGraphNodes()
 
 					UniformBufferFinal data;
 					{
-						FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->GetBufferResource<UniformBufferOffscreen>(node.inputResources[0]);
+						FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->Get(_offscreenUB);
 						auto& offscreenData = offscreenUB.data[0];
 
 						data.view = offscreenData.view.row4;
 
-						std::default_random_engine gen(777);
-						std::uniform_real_distribution<float> distribution(0.f, 1.f);
-						std::uniform_real_distribution<float> distribution2(-3.f, 3.f);
-
-						for (size_t i = 0; i < 10; i++)
+						//scenes without lights keep the original random set
+						if (_sceneLights.empty())
 						{
-							data.lights[i].pos = { distribution2(gen) , distribution2(gen) , distribution2(gen) };
-							data.lights[i].col = { distribution(gen) , distribution(gen) , distribution(gen) };
-							data.lights[i].radius = 5.f;
+							std::default_random_engine gen(777);
+							std::uniform_real_distribution<float> distribution(0.f, 1.f);
+							std::uniform_real_distribution<float> distribution2(-3.f, 3.f);
+
+							for (size_t i = 0; i < 10; i++)
+							{
+								Light light = {};
+								light.pos = { distribution2(gen) , distribution2(gen) , distribution2(gen) };
+								light.col = { distribution(gen) , distribution(gen) , distribution(gen) };
+								light.radius = 5.f;
+								_sceneLights.push_back(light);
+							}
 						}
+
+						data.lightCount = std::min<unsigned int>(_sceneLights.size(), MAX_LIGHTS);
+						std::copy(_sceneLights.begin(), _sceneLights.begin() + data.lightCount, data.lights);
 					}
 					compositionUB.data.push_back(data);
-
-					GvkHelper::create_buffer(_physicalDevice, _device, sizeof(UniformBufferFinal), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &compositionUB.buffers[0].buffer, &compositionUB.buffers[0].memory);
-					GvkHelper::write_to_buffer(_device, compositionUB.buffers[0].memory, &data, sizeof(UniformBufferFinal));
+					compositionUB.buffers[0] = _uniforms.GetBuffer();
 				}
-				_frameGraph->AddBufferResource(compositionUB.name, compositionUB);
+				_compositionUB = _frameGraph->AddBufferResource(compositionUB.name, compositionUB);
 
 				node.isSetupComplete = true;
 			};
 		compositionBuffers.Execute = [&](VkCommandBuffer& commandBuffer, FrameGraphNode& fgNode)
 			{
+				//the camera moves every frame, positions rebuilt from depth need this frame's matrices
+				auto& offscreenData = _frameGraph->Get(_offscreenUB).data[0];
+				auto& data = _frameGraph->Get(_compositionUB).data[0];
+
+				mat4 worldView;
+				GMatrix::MultiplyMatrixF(offscreenData.world, offscreenData.view, worldView);
+				GMatrix::MultiplyMatrixF(worldView, offscreenData.proj, data.viewProj);
+				GMatrix::InverseF(data.viewProj, data.inverseViewProj);
 				//Prepare(compositionBuffers);
 			};
 		compositionBuffers.shouldExecute = true;
 	}
 	_frameGraph->AddNode(compositionBuffers);
 
+	//tiles of LIGHT_TILE_SIZE pixels and which lights reach them, only the compact layout shades in world space from depth
+	//reads nothing the offscreen pass writes, so on an async compute queue it overlaps the gbuffer draws
+	FrameGraphNode lightCulling;
+	{
+		lightCulling.name = "Light Culling";
+		lightCulling.inputResources = { "Composition UB" };
+		lightCulling.outputResources = { "Light Tiles" };
+		lightCulling.access["Light Tiles"] = ResourceAccess::STORAGE_WRITE;
+		lightCulling.shaderStages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+		lightCulling.queue = QueueType::COMPUTE;
+		lightCulling.Declare = [&](FrameGraphNode& node)
+			{
+				FrameGraphImageResource lightTiles;
+				{
+					lightTiles.name = node.outputResources[0];
+					lightTiles.parent = node.name;
+					lightTiles.extent = { (_width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, (_height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, 1 };
+					lightTiles.format = VK_FORMAT_R32G32_UINT; //a bit per light, MAX_LIGHTS of them
+					lightTiles.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+					lightTiles.prepared = true;
+				}
+				_lightTiles = _frameGraph->AddImageResource(lightTiles.name, lightTiles);
+			};
+		lightCulling.Setup = [&](FrameGraphNode& node)
+			{
+
+				//DESCRIPTOR SET
+				{
+					std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings =
+					{
+						{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+						{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+					};
+
+					node.frameBuffer.descriptorSetLayout = _descriptorLayouts.Get(descriptorSetLayoutBindings);
+					node.frameBuffer.descriptorSet = _descriptors.Allocate(node.frameBuffer.descriptorSetLayout);
+
+					struct LightCullingDescriptors
+					{
+						VkDescriptorBufferInfo uniformBuffer;
+						VkDescriptorImageInfo lightTiles;
+					} descriptors;
+
+					descriptors.uniformBuffer = { _frameGraph->Get(_compositionUB).buffers[0].buffer, 0, sizeof(UniformBufferFinal) };
+					descriptors.lightTiles = { VK_NULL_HANDLE, _frameGraph->Get(_lightTiles).image.imageView, VK_IMAGE_LAYOUT_GENERAL };
+
+					VkDescriptorUpdateTemplate updateTemplate = _descriptorLayouts.GetUpdateTemplate(node.frameBuffer.descriptorSetLayout,
+						{
+							{0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, offsetof(LightCullingDescriptors, uniformBuffer), sizeof(VkDescriptorBufferInfo)},
+							{1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(LightCullingDescriptors, lightTiles), sizeof(VkDescriptorImageInfo)},
+						});
+					_descriptorLayouts.Update(node.frameBuffer.descriptorSet, updateTemplate, &descriptors);
+				}
+
+				//COMPUTE PIPELINE
+				{
+					node.frameBuffer.shaderModules.resize(1);
+
+					VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+					GvkHelper::create_shader(_device, _shaderCompiler.GetOutputPath("LightCulling").c_str(), "main", VK_SHADER_STAGE_COMPUTE_BIT, &node.frameBuffer.shaderModules[0], &pipelineShaderStageCreateInfo);
+					pipelineShaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+					pipelineShaderStageCreateInfo.module = node.frameBuffer.shaderModules[0];
+					pipelineShaderStageCreateInfo.pName = "main";
+
+					//screen size, the last tiles stop at its edge
+					VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof(uint32_t) };
+
+					VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+					pipelineLayoutCreateInfo.setLayoutCount = 1;
+					pipelineLayoutCreateInfo.pSetLayouts = &node.frameBuffer.descriptorSetLayout;
+					pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+					pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+					vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &node.frameBuffer.pipelineLayout);
+
+					VkComputePipelineCreateInfo computePipelineCreateInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+					computePipelineCreateInfo.stage = pipelineShaderStageCreateInfo;
+					computePipelineCreateInfo.layout = node.frameBuffer.pipelineLayout;
+
+					_pipelineCache.CreateComputePipeline(computePipelineCreateInfo, node.frameBuffer.pipeline, node.name);
+				}
+				node.frameBuffer.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+
+				node.isSetupComplete = true;
+			};
+		lightCulling.Execute = [&](VkCommandBuffer& commandBuffer, FrameGraphNode& fgNode)
+			{
+				uint32_t uniformOffset = _uniforms.Push(_frameGraph->Get(_compositionUB).data[0]);
+				uint32_t screenSize[2] = { _width, _height };
+				VkExtent3D tiles = _frameGraph->Get(_lightTiles).extent;
+
+				FrameCommandPools& pools = _frameGraph->IsAsync(QueueType::COMPUTE) ? _computeCommandPools : _commandPools;
+				commandBuffer = pools.Begin();
+				_frameGraph->WriteTimestamp(commandBuffer, fgNode, false);
+				_frameGraph->RecordBarriers(commandBuffer, fgNode.barriers);
+
+				//without its uniforms the dispatch is skipped and the tiles are left unwritten
+				if (uniformOffset != UniformRing::FAILED)
+				{
+					vkCmdBindDescriptorSets(commandBuffer, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipelineLayout, 0, 1, &fgNode.frameBuffer.descriptorSet, 1, &uniformOffset);
+					vkCmdBindPipeline(commandBuffer, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipeline);
+					vkCmdPushConstants(commandBuffer, fgNode.frameBuffer.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(screenSize), screenSize);
+					//8x8 tiles per group
+					vkCmdDispatch(commandBuffer, (tiles.width + 7) / 8, (tiles.height + 7) / 8, 1);
+				}
+
+				_frameGraph->WriteTimestamp(commandBuffer, fgNode, true);
+				vkEndCommandBuffer(commandBuffer);
+				fgNode.submission.commandBuffers.push_back(commandBuffer);
+			};
+		lightCulling.shouldExecute = _gBufferLayout == GBufferLayout::COMPACT;
+	}
+	_frameGraph->AddNode(lightCulling);
+
 	FrameGraphNode compositionPass; //todo
 	{
 		compositionPass.name = "Composition Pass";
 		compositionPass.inputResources = { "Composition UB", "GBuffer: Position", "GBuffer: Normal", "GBuffer: Albedo" };
+		//same bindings, t1 holds depth instead of position
+		if (_gBufferLayout == GBufferLayout::COMPACT) compositionPass.inputResources[1] = "Depth Buffer";
+		//t4, which lights reach each tile
+		if (_gBufferLayout == GBufferLayout::COMPACT) compositionPass.inputResources.push_back("Light Tiles");
 		compositionPass.outputResources = { "Composition Image" };
+		//the swapchain image is Gateware's, its render pass transitions it
+		//the gbuffer is only read at the shaded pixel, so the frame graph may make this a subpass of the offscreen pass
+		for (size_t i = 1; i <= 3; i++) compositionPass.access[compositionPass.inputResources[i]] = ResourceAccess::INPUT_READ;
 		compositionPass.Setup = [&](FrameGraphNode& node)
 			{
 				//assert that input resources are prepared
 				//Debug::CheckInputResources(*_frameGraph, compositionPass);
 
-				_vlk.GetRenderPass((void**)&node.frameBuffer.renderPass);
+				//merged, it draws in the offscreen pass's render pass, whose framebuffers hold the swapchain images
+				FrameGraphNode* offscreen = _frameGraph->GetMergedNode(node);
+				const VkDescriptorType gBufferType = offscreen ? VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				if (offscreen) node.frameBuffer.renderPass = offscreen->frameBuffer.renderPass;
+				else _vlk.GetRenderPass((void**)&node.frameBuffer.renderPass);
 				_vlk.GetSwapchainFramebuffer(_currentFrame, (void**)&node.frameBuffer.frameBuffer);
 				_vlk.GetSwapchainImageCount(_swapchainImageCount);
 
-				FrameGraphBufferResource<UniformBufferFinal>& compositionUB = _frameGraph->GetBufferResource<UniformBufferFinal>(node.inputResources[0]);
+				FrameGraphBufferResource<UniformBufferFinal>& compositionUB = _frameGraph->Get(_compositionUB);
 				FrameGraphImageResource& posResource = _frameGraph->GetImageResource(node.inputResources[1]),
 					& nrmResource = _frameGraph->GetImageResource(node.inputResources[2]),
 					& albResource = _frameGraph->GetImageResource(node.inputResources[3]);
 
 				//DESCRIPTOR SET
 				{
-					std::vector<VkDescriptorPoolSize> descriptorPoolSizes =
-					{
-						{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
-						{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3}
-					};
-
-					VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-					descriptorPoolCreateInfo.maxSets = 1;
-					descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
-					descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-
-					vkCreateDescriptorPool(_device, &descriptorPoolCreateInfo, nullptr, &node.frameBuffer.descriptorPool);
+					const bool compact = _gBufferLayout == GBufferLayout::COMPACT;
 
 					std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings =
 					{
-						{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-						{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-						{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-						{3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+						{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+						{1, gBufferType, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+						{2, gBufferType, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+						{3, gBufferType, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 					};
+					if (compact) descriptorSetLayoutBindings.push_back({ 4, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr });
 
-					VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-					descriptorSetLayoutCreateInfo.bindingCount = descriptorSetLayoutBindings.size();
-					descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
-
-					vkCreateDescriptorSetLayout(_device, &descriptorSetLayoutCreateInfo, nullptr, &node.frameBuffer.descriptorSetLayout);
-
-					VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-					descriptorSetAllocateInfo.descriptorPool = node.frameBuffer.descriptorPool;
-					descriptorSetAllocateInfo.descriptorSetCount = 1;
-					descriptorSetAllocateInfo.pSetLayouts = &node.frameBuffer.descriptorSetLayout;
-
-					vkAllocateDescriptorSets(_device, &descriptorSetAllocateInfo, &node.frameBuffer.descriptorSet);
-
-					VkDescriptorBufferInfo descriptorBufferInfo;
-					descriptorBufferInfo.buffer = compositionUB.buffers[0].buffer;
-					descriptorBufferInfo.offset = 0;
-					descriptorBufferInfo.range = sizeof(UniformBufferFinal);
+					node.frameBuffer.descriptorSetLayout = _descriptorLayouts.Get(descriptorSetLayoutBindings);
+					node.frameBuffer.descriptorSet = _descriptors.Allocate(node.frameBuffer.descriptorSetLayout);
 
-					std::vector<VkDescriptorImageInfo> descriptorImageInfos =
+					//laid out the way the update template reads it
+					struct CompositionDescriptors
 					{
-						{_colorSampler, posResource.image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-						{_colorSampler, nrmResource.image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-						{_colorSampler, albResource.image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
-					};
-
-					std::vector<VkWriteDescriptorSet> finalWriteDescriptorSets =
+						VkDescriptorBufferInfo uniformBuffer;
+						VkDescriptorImageInfo gBuffer[3];
+						VkDescriptorImageInfo lightTiles;
+					} descriptors;
+
+					VkImageLayout posLayout = compact ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+					descriptors.uniformBuffer = { compositionUB.buffers[0].buffer, 0, sizeof(UniformBufferFinal) };
+					descriptors.gBuffer[0] = { _colorSampler, posResource.image.imageView, posLayout };
+					descriptors.gBuffer[1] = { _colorSampler, nrmResource.image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+					descriptors.gBuffer[2] = { _colorSampler, albResource.image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+					if (compact) descriptors.lightTiles = { VK_NULL_HANDLE, _frameGraph->Get(_lightTiles).image.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+					std::vector<VkDescriptorUpdateTemplateEntry> entries =
 					{
-						MakeWrite(node.frameBuffer.descriptorSet, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, nullptr, &descriptorBufferInfo),
-						MakeWrite(node.frameBuffer.descriptorSet, 1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptorImageInfos[0], nullptr),
-						MakeWrite(node.frameBuffer.descriptorSet, 2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptorImageInfos[1], nullptr),
-						MakeWrite(node.frameBuffer.descriptorSet, 3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptorImageInfos[2], nullptr),
+						{0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, offsetof(CompositionDescriptors, uniformBuffer), sizeof(VkDescriptorBufferInfo)},
+						{1, 0, 1, gBufferType, offsetof(CompositionDescriptors, gBuffer), sizeof(VkDescriptorImageInfo)},
+						{2, 0, 1, gBufferType, offsetof(CompositionDescriptors, gBuffer) + 1 * sizeof(VkDescriptorImageInfo), sizeof(VkDescriptorImageInfo)},
+						{3, 0, 1, gBufferType, offsetof(CompositionDescriptors, gBuffer) + 2 * sizeof(VkDescriptorImageInfo), sizeof(VkDescriptorImageInfo)},
 					};
+					if (compact) entries.push_back({ 4, 0, 1, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, offsetof(CompositionDescriptors, lightTiles), sizeof(VkDescriptorImageInfo) });
 
-					vkUpdateDescriptorSets(_device, finalWriteDescriptorSets.size(), finalWriteDescriptorSets.data(), 0, nullptr);
+					VkDescriptorUpdateTemplate updateTemplate = _descriptorLayouts.GetUpdateTemplate(node.frameBuffer.descriptorSetLayout, entries);
+					_descriptorLayouts.Update(node.frameBuffer.descriptorSet, updateTemplate, &descriptors);
 				}
 
 				//GRAPHICS PIPELINE
@@ -1063,8 +1624,8 @@ void VulkanRenderer::CreateFrameGraphNodes()
 
 					node.frameBuffer.shaderModules.resize(2);
 
-					GvkHelper::create_shader(_device, "Shaders/SPV/FragmentShader.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT, &node.frameBuffer.shaderModules[0], &pssci);
-					GvkHelper::create_shader(_device, "Shaders/SPV/VertexShader.spv", "main", VK_SHADER_STAGE_VERTEX_BIT, &node.frameBuffer.shaderModules[1], &pssci);
+					GvkHelper::create_shader(_device, _shaderCompiler.GetOutputPath("FragmentShader").c_str(), "main", VK_SHADER_STAGE_FRAGMENT_BIT, &node.frameBuffer.shaderModules[0], &pssci);
+					GvkHelper::create_shader(_device, _shaderCompiler.GetOutputPath("VertexShader").c_str(), "main", VK_SHADER_STAGE_VERTEX_BIT, &node.frameBuffer.shaderModules[1], &pssci);
 
 					VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfos[2] = { {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}, {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO} };
 					//fragment shader
@@ -1187,10 +1748,10 @@ void VulkanRenderer::CreateFrameGraphNodes()
 					graphicsPipelineCreateInfo.pDynamicState = &pipelineDynamicStateCreateInfo;
 					graphicsPipelineCreateInfo.layout = node.frameBuffer.pipelineLayout;
 					graphicsPipelineCreateInfo.renderPass = node.frameBuffer.renderPass;
-					graphicsPipelineCreateInfo.subpass = 0;
+					graphicsPipelineCreateInfo.subpass = node.subpass;
 					graphicsPipelineCreateInfo.basePipelineHandle = nullptr;
 
-					vkCreateGraphicsPipelines(_device, nullptr, 1, &graphicsPipelineCreateInfo, nullptr, &node.frameBuffer.pipeline);
+					_pipelineCache.CreateGraphicsPipeline(graphicsPipelineCreateInfo, node.frameBuffer.pipeline, node.name);
 				}
 				node.frameBuffer.bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
@@ -1212,44 +1773,133 @@ void VulkanRenderer::CreateFrameGraphNodes()
 				renderPassBeginInfo.clearValueCount = 2;
 				renderPassBeginInfo.pClearValues = clearValues;
 
-				VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-				_commandBuffers[1].clear();
-				for (size_t i = 0; i < _swapchainImageCount; i++)
-				{
-					_vlk.GetSwapchainFramebuffer(i, (void**)&renderPassBeginInfo.framebuffer);
+				uint32_t uniformOffset = _uniforms.Push(_frameGraph->Get(_compositionUB).data[0]);
+				_vlk.GetSwapchainFramebuffer(_imageIndex, (void**)&renderPassBeginInfo.framebuffer);
 
-					//_vlk.GetCommandBuffer(i, (void**)&commandBuffer);
-					//vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-					GvkHelper::signal_command_start(_device, _commandPool, &commandBuffer);
-					vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				//without its uniforms the pass only clears
+				auto draw = [&](VkCommandBuffer recording)
+					{
+						if (uniformOffset == UniformRing::FAILED) return;
 
-					VkViewport viewport = { 0, 0, static_cast<float>(_width), static_cast<float>(_height), 0, 1 };
-					VkRect2D scissor = { {0, 0}, {_width, _height} };
+						VkViewport viewport = { 0, 0, static_cast<float>(_width), static_cast<float>(_height), 0, 1 };
+						VkRect2D scissor = { {0, 0}, {_width, _height} };
 
-					vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-					vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-					vkCmdBindDescriptorSets(commandBuffer, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipelineLayout, 0, 1, &fgNode.frameBuffer.descriptorSet, 0, nullptr);
-					vkCmdBindPipeline(commandBuffer, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipeline);
-					vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+						vkCmdSetViewport(recording, 0, 1, &viewport);
+						vkCmdSetScissor(recording, 0, 1, &scissor);
+						vkCmdBindDescriptorSets(recording, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipelineLayout, 0, 1, &fgNode.frameBuffer.descriptorSet, 1, &uniformOffset);
+						vkCmdBindPipeline(recording, fgNode.frameBuffer.bindPoint, fgNode.frameBuffer.pipeline);
+						vkCmdDraw(recording, 3, 1, 0, 0);
+					};
 
+				//merged, the offscreen pass left its render pass open in commandBuffer and this is the second subpass, nothing to replay
+				//its barriers went in before the render pass began
+				if (_frameGraph->GetMergedNode(fgNode))
+				{
+					_frameGraph->WriteTimestamp(commandBuffer, fgNode, false);
+					vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+					draw(commandBuffer);
 					vkCmdEndRenderPass(commandBuffer);
+					_frameGraph->WriteTimestamp(commandBuffer, fgNode, true);
+					//closes this frame's timestamp pair
+					if (_timestampPool) vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampPool, _currentFrame * 2 + 1);
 					vkEndCommandBuffer(commandBuffer);
-					_commandBuffers[1].push_back(commandBuffer);
-					//GvkHelper::signal_command_end(_device, _queue, _commandPool, &commandBuffer);
 				}
+				else
+				{
+					//nothing in the pass changes between frames, so it replays a buffer per (swapchain image, frame slot)
+					//the slot picks the timestamp pair, the uniform offset and barriers make up the tag so different ones re-record
+					uint64_t key = uint64_t(_imageIndex) << 32 | _currentFrame;
+					uint64_t tag = Cooked::Hash(&uniformOffset, sizeof(uniformOffset), fgNode.barriers.hash);
+					commandBuffer = _frameGraph->GetRecorded(fgNode, key, tag, _device, _commandPool, [&](VkCommandBuffer recording)
+						{
+							_frameGraph->WriteTimestamp(recording, fgNode, false);
+							_frameGraph->RecordBarriers(recording, fgNode.barriers);
+							vkCmdBeginRenderPass(recording, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+							draw(recording);
+							vkCmdEndRenderPass(recording);
+							_frameGraph->WriteTimestamp(recording, fgNode, true);
+							//closes this frame's timestamp pair
+							if (_timestampPool) vkCmdWriteTimestamp(recording, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampPool, _currentFrame * 2 + 1);
+						});
+					fgNode.submission.commandBuffers.push_back(commandBuffer);
+				}
+
+				//the only node that waits for the swapchain image, presenting waits for it in turn
+				//merged, FrameGraph::Submit moves both onto the offscreen pass's submission, which holds the commands
+				fgNode.submission.Wait(_presentCompleteSemaphore[_currentFrame], _submitPipelineStages);
+				fgNode.submission.Signal(_compositionSemaphore);
 
 				//Prepare(fgNode);
 			};
 		compositionPass.shouldExecute = true;
 	}
 	_frameGraph->AddNode(compositionPass);
+
+	//presented, everything else only matters if it ends up here
+	_frameGraph->AddSink("Composition Image");
 }
 
 void VulkanRenderer::CleanUp()
 {
+	if (!_device) return;
 	vkDeviceWaitIdle(_device);
 
+	_geometryArena.Destroy();
+	_staging.Destroy();
+	for (auto& texture : _sceneTextures) _allocator.DestroyImage(texture);
+	_sceneTextures.clear();
+	_sceneTextureIndices.clear();
+	if (_timestampPool) vkDestroyQueryPool(_device, _timestampPool, nullptr);
+
+	_uniforms.Destroy();
+	_recordWorkers.Destroy();
+	_commandPools.Destroy();
+	_computeCommandPools.Destroy();
+	_frameGraph->FreeRecorded(_device, _commandPool);
+	DestroyMergedFramebuffers();
+	_frameGraph->DestroyImages(_allocator);
+	_frameGraph->DestroyTimelines();
+	_bindless.Destroy();
+	_descriptors.Destroy();
+	_descriptorLayouts.Destroy();
+
+#ifndef NDEBUG
+	_allocator.PrintStats();
+	_pipelineCache.PrintStats();
+#endif
+	_pipelineCache.Destroy();
+	_allocator.Destroy();
+	_device = VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::CreateMergedFramebuffers()
+{
+	DestroyMergedFramebuffers();
+	_vlk.GetSwapchainImageCount(_swapchainImageCount);
+
+	_mergedFramebuffers.resize(_swapchainImageCount);
+	for (unsigned int i = 0; i < _swapchainImageCount; i++)
+	{
+		std::vector<VkImageView> imageViews = _mergedViews;
+		imageViews.push_back(VK_NULL_HANDLE);
+		_vlk.GetSwapchainView(i, (void**)&imageViews.back());
+
+		VkFramebufferCreateInfo frameBufferCreateInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+		frameBufferCreateInfo.renderPass = _mergedRenderPass;
+		frameBufferCreateInfo.pAttachments = imageViews.data();
+		frameBufferCreateInfo.attachmentCount = static_cast<uint32_t>(imageViews.size());
+		frameBufferCreateInfo.width = _width;
+		frameBufferCreateInfo.height = _height;
+		frameBufferCreateInfo.layers = 1;
+
+		vkCreateFramebuffer(_device, &frameBufferCreateInfo, nullptr, &_mergedFramebuffers[i]);
+	}
+}
 
+void VulkanRenderer::DestroyMergedFramebuffers()
+{
+	for (auto frameBuffer : _mergedFramebuffers) vkDestroyFramebuffer(_device, frameBuffer, nullptr);
+	_mergedFramebuffers.clear();
 }
 
 void VulkanRenderer::Prepare(FrameGraphNode node)
@@ -1311,24 +1961,7 @@ mat4 VulkanRenderer::GetLocalMatrix(const tinygltf::Node& node)
 	return matrix;
 }
 
-std::string VulkanRenderer::ShaderAsString(const char* shaderFilePath)
-{
-	std::string output;
-	unsigned int stringLength = 0;
-	GW::SYSTEM::GFile file;
-	file.Create();
-	file.GetFileSize(shaderFilePath, stringLength);
-
-	if (stringLength && +file.OpenBinaryRead(shaderFilePath))
-	{
-		output.resize(stringLength);
-		file.Read(&output[0], stringLength);
-	}
-
-	return output;
-}
-
-VulkanRenderer::VulkanRenderer(GWindow win) : Renderer(win)
+VulkanRenderer::VulkanRenderer(GWindow win, GBufferLayout gBufferLayout, bool mergeSubpasses) : Renderer(win), _gBufferLayout(gBufferLayout)
 {
 #ifndef NDEBUG
 	const char* debugLayers[] =
@@ -1336,9 +1969,14 @@ VulkanRenderer::VulkanRenderer(GWindow win) : Renderer(win)
 		"VK_LAYER_KHRONOS_validation"
 	};
 
-	if (-_vlk.Create(_win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT | GW::GRAPHICS::TRIPLE_BUFFER, sizeof(debugLayers) / sizeof(debugLayers[0]), debugLayers, 0, nullptr, 0, nullptr, false)) return;
+	//descriptor indexing first, devices without it draw materials untextured
+	unsigned long long initMask = GW::GRAPHICS::DEPTH_BUFFER_SUPPORT | GW::GRAPHICS::TRIPLE_BUFFER;
+	bool bindless = +_vlk.Create(_win, initMask | GW::GRAPHICS::BINDLESS_SUPPORT, sizeof(debugLayers) / sizeof(debugLayers[0]), debugLayers, 0, nullptr, 0, nullptr, false);
+	if (!bindless && -_vlk.Create(_win, initMask, sizeof(debugLayers) / sizeof(debugLayers[0]), debugLayers, 0, nullptr, 0, nullptr, false)) return;
 #else
-	if (-_vlk.Create(_win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT | GW::GRAPHICS::TRIPLE_BUFFER)) return; //return if creation didn't work
+	unsigned long long initMask = GW::GRAPHICS::DEPTH_BUFFER_SUPPORT | GW::GRAPHICS::TRIPLE_BUFFER;
+	bool bindless = +_vlk.Create(_win, initMask | GW::GRAPHICS::BINDLESS_SUPPORT);
+	if (!bindless && -_vlk.Create(_win, initMask)) return; //return if creation didn't work
 #endif
 
 	_vlk.GetDevice((void**)&_device);
@@ -1347,24 +1985,84 @@ VulkanRenderer::VulkanRenderer(GWindow win) : Renderer(win)
 	_vlk.GetGraphicsQueue((void**)&_queue);
 	_vlk.GetSwapchain((void**)&_swapchain);
 
-	CompileShaders();
-	LoadModel("Models/Shapes/Shapes.gltf");
+	unsigned int graphicsFamily, presentFamily;
+	_vlk.GetQueueFamilyIndices(graphicsFamily, presentFamily);
+
+	_allocator.Create(_physicalDevice, _device);
+	_staging.Create(_allocator, _physicalDevice, _device, _queue, graphicsFamily, _commandPool, StagingRing::DEFAULT_CAPACITY, MAX_FRAMES);
+
+	//frame graph queues, Gateware created one on each family found here, nodes on a missing one run on graphics
+	//cross queue waits are timeline semaphores, without them everything stays on graphics
+	_frameGraph->SetQueue(QueueType::GRAPHICS, _queue, graphicsFamily);
+	uint32_t computeFamily;
+	if (GvkHelper::supports_timeline_semaphores(_physicalDevice) && GvkHelper::find_dedicated_compute_queue_family(_physicalDevice, &computeFamily) == VK_SUCCESS)
+	{
+		VkQueue computeQueue;
+		vkGetDeviceQueue(_device, computeFamily, 0, &computeQueue);
+		_frameGraph->SetQueue(QueueType::COMPUTE, computeQueue, computeFamily);
+	}
+	//shares the staging ring's copy queue, both submit from this thread
+	if (_staging.IsAsync())
+	{
+		VkQueue transferQueue;
+		vkGetDeviceQueue(_device, _staging.GetUploadFamily(), 0, &transferQueue);
+		_frameGraph->SetQueue(QueueType::TRANSFER, transferQueue, _staging.GetUploadFamily());
+	}
+
+	//uploads and uniforms land in buffers concurrent across every family using them, so no ownership transfers are needed
+	_allocator.SetSharedQueueFamilies({ graphicsFamily, _staging.GetUploadFamily(), _frameGraph->GetQueueFamily(QueueType::COMPUTE) });
+	_uniforms.Create(_allocator, _physicalDevice, UniformRing::DEFAULT_FRAME_SIZE, MAX_FRAMES);
+	//a recording worker and secondary pool per core for the offscreen pass's draw chunks
+	const unsigned int recordWorkers = std::max(1u, std::thread::hardware_concurrency());
+	_commandPools.Create(_device, graphicsFamily, MAX_FRAMES, recordWorkers);
+	_recordWorkers.Create(recordWorkers);
+	_secondaries.resize(recordWorkers);
+	if (_frameGraph->IsAsync(QueueType::COMPUTE)) _computeCommandPools.Create(_device, _frameGraph->GetQueueFamily(QueueType::COMPUTE), MAX_FRAMES);
+	_pipelineCache.Create(_physicalDevice, _device);
+	_descriptorLayouts.Create(_device);
+	_descriptors.Create(_device, MAX_FRAMES);
+	if (bindless) _bindless.Create(_physicalDevice, _device, _descriptorLayouts);
+	else std::cout << "Warning: descriptor indexing unavailable, materials are drawn untextured\n";
+	//Gateware enables the extension whenever this holds
+	if (GvkHelper::supports_synchronization2(_physicalDevice)) _frameGraph->EnableSynchronization2(_device);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	if (properties.limits.timestampComputeAndGraphics)
+	{
+		_timestampPeriod = properties.limits.timestampPeriod;
+
+		VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = MAX_FRAMES * 2;
+		vkCreateQueryPool(_device, &queryPoolCreateInfo, nullptr, &_timestampPool);
+	}
+
+	LoadScene("Scenes/Default.json");
 	CreateFrameGraphNodes();
+	_frameGraph->SetSubpassMerging(mergeSubpasses);
+	//Execute compiles too, doing it here reports a broken graph before the first frame
+	if (_frameGraph->Compile())
+		std::cout << "Frame graph: " << _frameGraph->GetScheduledCount() << "/" << _frameGraph->GetNodeCount() << " nodes scheduled, " << _frameGraph->GetMergeCount() << " merged into subpasses\n";
+	//every node's images are registered before any is placed, so images of different passes can share memory
+	_frameGraph->Declare();
+	_frameGraph->AllocateImages(_allocator, _device);
+	//after Compile, the composition shader reads input attachments if it was merged
+	if (!CompileShaders())
+	{
+		//pipelines would be built without the shaders they're described for
+		std::cout << "Error: shaders failed to compile, can't start\n";
+		std::exit(EXIT_FAILURE);
+	}
+	//sized by the node count
+	_frameGraph->CreateTimelines(_physicalDevice, _device, MAX_FRAMES);
 
 	VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 	for (size_t i = 0; i < MAX_FRAMES; i++)
 		vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_presentCompleteSemaphore[i]);
-	vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_offscreenSemaphore);
 	vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_compositionSemaphore);
 	vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_postProcessSemaphore);
 
-	_submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-	_submitInfo.pWaitDstStageMask = &_submitPipelineStages;
-	_submitInfo.waitSemaphoreCount = 1;
-	_submitInfo.pWaitSemaphores = &_presentCompleteSemaphore[0];
-	_submitInfo.signalSemaphoreCount = 1;
-	_submitInfo.pSignalSemaphores = &_compositionSemaphore;
-
 	_fences.resize(MAX_FRAMES);
 	VkFenceCreateInfo fenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
 	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Optional: Start in signaled state
@@ -1378,65 +2076,137 @@ VulkanRenderer::VulkanRenderer(GWindow win) : Renderer(win)
 			{
 				CleanUp();
 			}
+			//the recorded composition pass and the merged framebuffers point at the old swapchain images
+			if (+_shutdown.Find(GW::GRAPHICS::GVulkanSurface::Events::REBUILD_PIPELINE, true))
+			{
+				_frameGraph->Invalidate();
+				if (!_mergedFramebuffers.empty())
+				{
+					vkDeviceWaitIdle(_device);
+					CreateMergedFramebuffers();
+				}
+			}
 		});
 }
 
 VulkanRenderer::~VulkanRenderer()
 {
+	//_shutdown is destroyed before _vlk releases the surface, so its RELEASE_RESOURCES never gets here
+	CleanUp();
 }
 
 void VulkanRenderer::Render()
 {
 	vkWaitForFences(_device, 1, &_fences[_currentFrame], true, UINT64_MAX);
 	vkResetFences(_device, 1, &_fences[_currentFrame]);
+	auto cpuStart = std::chrono::steady_clock::now();
 
-	VkCommandBuffer commandBuffer;
-	_frameGraph->Execute(commandBuffer);
-
-	unsigned int frameIdx;
-	vkAcquireNextImageKHR(_device, _swapchain, 0, _presentCompleteSemaphore[_currentFrame], nullptr, &frameIdx);
-
-	_submitInfo.pWaitSemaphores = &_presentCompleteSemaphore[_currentFrame];
-	_submitInfo.pSignalSemaphores = &_offscreenSemaphore;
-	_submitInfo.commandBufferCount = _commandBuffers[0].size();
-	_submitInfo.pCommandBuffers = _commandBuffers[0].data();
+	//this frame slot's previous timestamps are complete now that its fence has signalled
+	if (_timestampsWritten[_currentFrame])
+	{
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(_device, _timestampPool, _currentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			_frameStats.gpuMs = (timestamps[1] - timestamps[0]) * _timestampPeriod / 1000000.f;
+	}
+	//the slot's fence only covers the graphics queue, the other queues' work for it is waited for here
+	_frameGraph->BeginFrame(_currentFrame);
+	_frameStats.asyncMs = _frameGraph->GetAsyncMs();
+	_frameStats.asyncOverlapMs = _frameGraph->GetOverlapMs();
+
+	_frameStats.frame++;
+	_frameStats.deviceUsage = _frameStats.deviceBudget = 0;
+	for (auto& heap : _allocator.GetBudgets())
+	{
+		if (!heap.deviceLocal) continue;
+		_frameStats.deviceUsage += heap.usage;
+		_frameStats.deviceBudget += heap.budget;
+	}
+	_frameStats.transientBytes = _frameGraph->GetTransientRequested();
+	_frameStats.transientSavedBytes = _frameGraph->GetTransientSavings(_device);
+	_frameStats.commandBuffers = _commandPools.GetAllocatedCount() + _computeCommandPools.GetAllocatedCount();
+	if (_frameStats.deviceUsage > _frameStats.deviceBudget && !_overBudgetWarned)
+	{
+		std::cout << "Warning: device local memory over budget, " << _frameStats.deviceUsage / (1024 * 1024) << "/" << _frameStats.deviceBudget / (1024 * 1024) << "MB\n";
+		_overBudgetWarned = true;
+	}
+	//pipelines created since the last save survive a crash
+	if (_frameStats.frame % PipelineCache::SAVE_INTERVAL == 0) _pipelineCache.Save();
 
-	vkQueueSubmit(_queue, 1, &_submitInfo, nullptr);
+	_staging.BeginFrame(_currentFrame);
+	_uniforms.BeginFrame(_currentFrame);
+	_descriptors.BeginFrame(_currentFrame);
+	_commandPools.BeginFrame(_currentFrame);
+	if (_computeCommandPools.IsCreated()) _computeCommandPools.BeginFrame(_currentFrame);
+	if (_geometryArena.IsCreated()) _geometryArena.BeginFrame();
 
-	_submitInfo.pWaitSemaphores = &_offscreenSemaphore;
-	_submitInfo.pSignalSemaphores = &_compositionSemaphore;
-	_submitInfo.commandBufferCount = 1;
-	_submitInfo.pCommandBuffers = &_commandBuffers[1][_currentFrame];
+	//acquired before recording so the composition pass knows which framebuffer it draws to
+	vkAcquireNextImageKHR(_device, _swapchain, 0, _presentCompleteSemaphore[_currentFrame], nullptr, &_imageIndex);
 
-	vkQueueSubmit(_queue, 1, &_submitInfo, _fences[_currentFrame]);
+	VkCommandBuffer commandBuffer;
+	_frameGraph->Execute(commandBuffer);
 
-	//_submitInfo.pWaitSemaphores = &_compositionSemaphore;
-	//_submitInfo.pSignalSemaphores = &_postProcessSemaphore;
-	//_submitInfo.pCommandBuffers = &_commandBuffers[2].data();
-	//
-	//vkQueueSubmit(_queue, 1, &_submitInfo, VK_NULL_HANDLE);
+	//each node brought its command buffers and semaphores, nodes on the other queues are waited for through their timelines
+	_frameGraph->Submit(_fences[_currentFrame]);
+	_frameStats.barriers = _frameGraph->GetBarrierCount();
+	_frameStats.mergedPasses = static_cast<unsigned int>(_frameGraph->GetMergeCount());
 
 	VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = &_swapchain;
-	presentInfo.pImageIndices = &frameIdx;
+	presentInfo.pImageIndices = &_imageIndex;
 	presentInfo.pWaitSemaphores = &_compositionSemaphore;
 	presentInfo.waitSemaphoreCount = 1;
 
 	vkQueuePresentKHR(_queue, &presentInfo);
+
+	_timestampsWritten[_currentFrame] = _timestampPool != VK_NULL_HANDLE;
+	_frameStats.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
 	_currentFrame = (_currentFrame + 1) % MAX_FRAMES;
 }
 
+nlohmann::json VulkanRenderer::GetMemoryReport() const
+{
+	nlohmann::json report = _allocator.GetReport();
+	report["frame"] = _frameStats.frame;
+	return report;
+}
+
+bool VulkanRenderer::WriteMemoryReport(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Error: can't write " << filename << '\n';
+		return false;
+	}
+
+	file << GetMemoryReport().dump(1, '\t');
+	return true;
+}
+
+bool VulkanRenderer::WriteTimeline(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Error: can't write " << filename << '\n';
+		return false;
+	}
+
+	file << _frameGraph->GetTimelineReport().dump(1, '\t');
+	return true;
+}
+
 void VulkanRenderer::UpdateCamera()
 {
 	_win.IsFocus(_isFocused);
 
 	if (!_isFocused) return;
 
-	mat4 cam = GW::MATH::GIdentityMatrixF;
+	if (!_offscreenUB.IsValid()) return;
 
-	FrameGraphBufferResource<UniformBufferOffscreen>& offscreenUB = _frameGraph->GetBufferResource<UniformBufferOffscreen>("Offscreen UB");
-	auto& offscreenData = offscreenUB.data[0];
+	mat4 cam = GW::MATH::GIdentityMatrixF;
+	auto& offscreenData = _frameGraph->Get(_offscreenUB).data[0];
 
 	GMatrix::InverseF(offscreenData.view, cam);
 
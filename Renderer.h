@@ -21,7 +21,7 @@ protected:
 public:
 	Renderer() = default;
 	Renderer(GWindow win);
-	~Renderer();
+	virtual ~Renderer(); //main deletes whichever renderer it made through this
 
 	virtual void Render() = 0;
 	virtual void UpdateCamera() = 0;
@@ -34,65 +34,115 @@ class VulkanRenderer : public Renderer
 	GEventReceiver _shutdown;
 
 	FrameGraph* _frameGraph = FrameGraph::GetInstance();
-	GeometryData _geometryData;
+	MemoryAllocator _allocator;
+	StagingRing _staging;
+	UniformRing _uniforms;
+	FrameCommandPools _commandPools;
+	FrameCommandPools _computeCommandPools; //only when the frame graph has an async compute queue
+	WorkerPool _recordWorkers; //worker w records the offscreen pass's chunk w from command pool w + 1
+	std::vector<VkCommandBuffer> _secondaries; //one per worker, reused every frame
+	GeometryArena _geometryArena;
+	PipelineCache _pipelineCache;
+	ShaderCompiler _shaderCompiler; //configured by CompileShaders, nodes load their spv permutation through it
+	DescriptorLayoutCache _descriptorLayouts;
+	DescriptorAllocator _descriptors;
+	BindlessTextures _bindless;
+	std::vector<ModelData> _pendingModels; //loaded before the arena exists
+	std::vector<unsigned int> _sceneModels;
+	std::vector<Image> _sceneTextures;
+	std::vector<uint32_t> _sceneTextureIndices; //their slots in the bindless array
+	std::vector<Light> _sceneLights;
+
+	//set when their nodes set up, frames reach the resources through these instead of by name
+	BufferHandle<Vertex> _vertexBuffers;
+	BufferHandle<unsigned int> _indexBuffer;
+	BufferHandle<UniformBufferOffscreen> _offscreenUB;
+	BufferHandle<UniformBufferFinal> _compositionUB;
+	ImageHandle _lightTiles;
 
 	VkQueue _present;
 
 	//vulkan
-	VkDevice _device;
+	VkDevice _device = VK_NULL_HANDLE; //null again once CleanUp ran
 	VkPhysicalDevice _physicalDevice;
 	VkRenderPass _renderPass;
 	VkSampler _colorSampler;
-	VkDescriptorSet _offscreenDescriptorSet, _descriptorSet, _finalDescriptorSet;
-	VkDescriptorPool _descriptorPool;
-	VkDescriptorSetLayout _descriptorSetLayout;
 	VkShaderModule _vertexShaderModule, _fragmentShaderModule, _offscreenVertexShaderModule, _offscreenFragmentShaderModule;
 	std::vector<VkCommandBuffer> _drawCommandBuffers;
 	VkCommandBuffer _offscreenCommandBuffer;
 	VkCommandPool _commandPool;
-	VkSemaphore _offscreenSemaphore, _compositionSemaphore, _postProcessSemaphore, _presentCompleteSemaphore[3];// , _renderCompleteSemaphore;
-	VkSubmitInfo _submitInfo;
+	VkSemaphore _compositionSemaphore, _postProcessSemaphore, _presentCompleteSemaphore[3];// , _renderCompleteSemaphore;
 	VkQueue _queue;
 	VkSwapchainKHR _swapchain;
 	VkPipelineStageFlags _submitPipelineStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
 	std::vector<VkFence> _fences;
 	const int MAX_FRAMES = 3;
+	const size_t MIN_DRAWS_PER_CHUNK = 512; //fewer draws per worker than this record inline
+	static constexpr uint32_t MAX_OFFSCREEN_ATTACHMENTS = 5; //the full gbuffer, depth and the merged swapchain image
 
-	std::vector<DrawInfo> _drawInfo;
 	Dimensions _dimensions;
 
 	unsigned int _currentFrame = 0;
+	uint32_t _imageIndex = 0; //swapchain image this frame presents
+	GBufferLayout _gBufferLayout = GBufferLayout::FULL;
 
-	std::vector<VkCommandBuffer> _commandBuffers[3];
-	//dxc
-	ComPtr<IDxcCompiler3> _compiler;
-	ComPtr<IDxcUtils> _utils;
-	ComPtr<IDxcIncludeHandler> _includeHandler;
+	//the composition pass as the offscreen pass's second subpass, a framebuffer per swapchain image
+	VkRenderPass _mergedRenderPass = VK_NULL_HANDLE;
+	std::vector<VkImageView> _mergedViews; //the gbuffer's, each framebuffer adds its swapchain image's
+	std::vector<VkFramebuffer> _mergedFramebuffers;
 
-	//tinygltf
-	tinygltf::Model _model;
+	//gpu timing, two timestamps per frame in flight
+	VkQueryPool _timestampPool = VK_NULL_HANDLE;
+	float _timestampPeriod = 1.f;
+	bool _timestampsWritten[3] = {};
+	FrameStats _frameStats;
+	bool _overBudgetWarned = false;
 
 	//mat4 matrices[3];
 
-	void CompileShaders();
-	void LoadModel(std::string filename);
-	void CreateGeometryData();
+	//false when any shader failed, its stale spv is gone then
+	bool CompileShaders();
+	bool LoadModel(const std::string& filename, ModelData& out);
+	bool LoadCookedModel(const std::string& filename, ModelData& out);
+	void CreateGeometryData(tinygltf::Model& model, ModelData& out);
+	unsigned int CommitGeometry(ModelData& model);
+	unsigned int AddModel(ModelData&& model);
+	std::vector<size_t> UploadTextures(const std::vector<Cooked::TextureData>& textures, const std::vector<std::string>& names, std::vector<Image>& out);
+	void UpdateLights();
 	void CreateFrameGraphNodes();
+	//again whenever Gateware rebuilds the swapchain
+	void CreateMergedFramebuffers();
+	void DestroyMergedFramebuffers();
 	void CleanUp();
 	void Prepare(FrameGraphNode node);
 	template <typename T>
 	bool DoesVectorContain(std::vector<T> v, T value) { return (std::find(v.begin(), v.end(), value) != v.end()); }
 	VkWriteDescriptorSet MakeWrite(VkDescriptorSet descriptorSet, unsigned int binding, unsigned int descriptorCount, VkDescriptorType type, const VkDescriptorImageInfo* pImageInfo = nullptr, const VkDescriptorBufferInfo* pBufferInfo = nullptr);
 	mat4 GetLocalMatrix(const tinygltf::Node& node);
-	std::string ShaderAsString(const char* shaderFilePath);
 
 public:
-	VulkanRenderer(GWindow win);
+	//mergeSubpasses lets the frame graph fold the composition pass into the offscreen pass's render pass
+	VulkanRenderer(GWindow win, GBufferLayout gBufferLayout = GBufferLayout::FULL, bool mergeSubpasses = true);
 	~VulkanRenderer();
 
 	void Render() override;
 	void UpdateCamera() override;
+
+	//runtime model streaming, ids come from the geometry arena (0 = failed or committed on the first frame)
+	unsigned int AddModel(const std::string& filename);
+	void RemoveModel(unsigned int id);
+	bool LoadScene(const std::string& filename);
+	bool LoadScene(const nlohmann::json& scene);
+	void UnloadScene();
+
+	void SetView(vec4 eye, vec4 target);
+	const FrameStats& GetFrameStats() const { return _frameStats; }
+	//heap usage against budget and per owner usage as of the last frame
+	nlohmann::json GetMemoryReport() const;
+	bool WriteMemoryReport(const std::string& filename) const;
+	//the frame graph's recent node timings per queue as a trace, see FrameGraph::GetTimelineReport
+	bool WriteTimeline(const std::string& filename) const;
 };
 
 class DX12Renderer : public Renderer
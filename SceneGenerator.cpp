@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "SceneGenerator.h"
+
+namespace
+{
+	//the json chunk of a .glb, or the whole file for .gltf
+	nlohmann::json ReadGltfJson(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return nlohmann::json();
+
+		if (std::filesystem::path(path).extension() != ".glb") return nlohmann::json::parse(file, nullptr, false);
+
+		uint32_t header[3], chunkLength, chunkType;
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		file.read(reinterpret_cast<char*>(&chunkLength), sizeof(chunkLength));
+		file.read(reinterpret_cast<char*>(&chunkType), sizeof(chunkType));
+		if (!file || chunkType != 0x4E4F534A) return nlohmann::json(); //"JSON"
+
+		std::string chunk(chunkLength, '\0');
+		file.read(chunk.data(), chunkLength);
+		return nlohmann::json::parse(chunk, nullptr, false);
+	}
+}
+
+namespace SceneGenerator
+{
+	unsigned long long CountTriangles(const std::string& gltfPath)
+	{
+		nlohmann::json gltf = ReadGltfJson(gltfPath);
+		if (gltf.is_discarded() || !gltf.contains("nodes") || !gltf.contains("meshes") || !gltf.contains("accessors")) return 0;
+
+		//every node with a mesh gets drawn, same as CreateGeometryData
+		unsigned long long triangles = 0;
+		for (auto& node : gltf["nodes"])
+		{
+			if (!node.contains("mesh")) continue;
+			for (auto& prim : gltf["meshes"][node["mesh"].get<int>()]["primitives"])
+			{
+				int accessor = prim.contains("indices") ? prim["indices"].get<int>() : prim["attributes"].value("POSITION", -1);
+				if (accessor >= 0) triangles += gltf["accessors"][accessor].value("count", 0ull) / 3;
+			}
+		}
+		return triangles;
+	}
+
+	nlohmann::json Generate(const SceneGeneratorSettings& settings)
+	{
+		nlohmann::json scene;
+		scene["models"] = nlohmann::json::array();
+		scene["lights"] = nlohmann::json::array();
+
+		std::vector<std::string> meshes;
+		std::vector<unsigned long long> meshTriangles;
+		for (auto& mesh : settings.meshes)
+		{
+			unsigned long long triangles = CountTriangles(mesh);
+			if (!triangles)
+			{
+				std::cout << "Warning: scene generator skipping " << mesh << ", it couldn't be read or has no triangles\n";
+				continue;
+			}
+			meshes.push_back(mesh);
+			meshTriangles.push_back(triangles);
+		}
+
+		unsigned long long instances = settings.instances;
+		if (settings.targetTriangles && !meshes.empty())
+		{
+			unsigned long long average = std::accumulate(meshTriangles.begin(), meshTriangles.end(), 0ull) / meshes.size();
+			instances = std::max(1ull, (settings.targetTriangles + average - 1) / average);
+		}
+
+		unsigned int side = std::max(1u, (unsigned int)std::ceil(std::sqrt((double)instances)));
+		float half = (side - 1) * settings.spacing * .5f;
+
+		//one entry per row, the row's instances step along x
+		unsigned long long placed = 0, triangles = 0;
+		for (unsigned int row = 0; !meshes.empty(); row++)
+		{
+			size_t mesh = row % meshes.size();
+			unsigned long long count = side;
+
+			if (settings.targetTriangles)
+			{
+				if (triangles >= settings.targetTriangles) break;
+				count = std::min(count, (settings.targetTriangles - triangles + meshTriangles[mesh] - 1) / meshTriangles[mesh]);
+			}
+			else
+			{
+				if (placed >= instances) break;
+				count = std::min(count, instances - placed);
+			}
+
+			nlohmann::json entry;
+			entry["path"] = meshes[mesh];
+			entry["translation"] = { -half, 0.f, -half + row * settings.spacing };
+			entry["instances"] = count;
+			entry["offset"] = { settings.spacing, 0.f, 0.f };
+			scene["models"].push_back(entry);
+
+			placed += count;
+			triangles += count * meshTriangles[mesh];
+		}
+
+		std::default_random_engine gen(settings.seed);
+		std::uniform_real_distribution<float> color(.2f, 1.f);
+		std::uniform_real_distribution<float> position(-half - settings.spacing * .5f, half + settings.spacing * .5f);
+		std::uniform_real_distribution<float> height(1.f, settings.spacing);
+
+		for (unsigned int i = 0; i < settings.lights; i++)
+		{
+			nlohmann::json light;
+			light["position"] = { position(gen), height(gen), position(gen) };
+			light["color"] = { color(gen), color(gen), color(gen) };
+			light["radius"] = settings.spacing * 2.f;
+			scene["lights"].push_back(light);
+		}
+
+		//informational, LoadScene ignores these
+		scene["instances"] = placed;
+		scene["triangles"] = triangles;
+		return scene;
+	}
+
+	bool Save(const nlohmann::json& scene, const std::string& filename)
+	{
+		std::ofstream file(filename);
+		if (!file) return false;
+
+		file << scene.dump(1, '\t');
+		return bool(file);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+//parametric test scenes for scaling benchmarks
+//output is the same scene format LoadScene reads, so it can be loaded straight from memory or saved next to the hand written ones
+struct SceneGeneratorSettings
+{
+	std::vector<std::string> meshes = { "Models/Shapes/Shapes.gltf", "Models/Spheres/Spheres.gltf", "Models/Test/Test.gltf" };
+	unsigned int instances = 64; //ignored when targetTriangles is set
+	unsigned long long targetTriangles = 0; //instances are added row by row until the scene reaches this many triangles
+	unsigned int lights = 10;
+	float spacing = 10.f;
+	unsigned int seed = 777;
+};
+
+namespace SceneGenerator
+{
+	//triangles drawn by one instance of a gltf, read from the json alone so no buffers get loaded
+	unsigned long long CountTriangles(const std::string& gltfPath);
+
+	//instances on a square grid in xz centred on the origin, one mesh per row, lights scattered above the grid
+	nlohmann::json Generate(const SceneGeneratorSettings& settings);
+
+	bool Save(const nlohmann::json& scene, const std::string& filename);
+}
@@ -0,0 +1,218 @@
+#include "pch.h"
+
+namespace
+{
+	bool ReadFile(const std::filesystem::path& path, std::string& out)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+		out.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read(out.data(), out.size());
+		return bool(file);
+	}
+
+	std::string ToHex(uint64_t v)
+	{
+		std::ostringstream ss;
+		ss << std::hex << v;
+		return ss.str();
+	}
+
+	//hashes a file and everything it #includes, each file once
+	uint64_t HashIncludes(const std::filesystem::path& path, const std::filesystem::path& sourceDirectory, std::set<std::filesystem::path>& visited, uint64_t hash)
+	{
+		std::string text;
+		if (!visited.insert(path.lexically_normal()).second || !ReadFile(path, text)) return hash;
+		hash = Cooked::Hash(text.data(), text.size(), hash);
+
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t directive = line.find("#include");
+			if (directive == std::string::npos) continue;
+			size_t open = line.find_first_of("\"<", directive);
+			size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+			if (close == std::string::npos) continue;
+
+			//relative to the including file first, then the include directory, like dxc
+			std::filesystem::path include = line.substr(open + 1, close - open - 1);
+			std::filesystem::path resolved = path.parent_path() / include;
+			if (!std::filesystem::exists(resolved)) resolved = sourceDirectory / include;
+			hash = Cooked::Hash(include.string().data(), include.string().size(), hash);
+			hash = HashIncludes(resolved, sourceDirectory, visited, hash);
+		}
+		return hash;
+	}
+}
+
+ShaderCompiler::ShaderCompiler(const std::string& sourceDirectory, const std::string& outputDirectory) : _sourceDirectory(sourceDirectory), _outputDirectory(outputDirectory)
+{
+}
+
+std::string ShaderCompiler::GetOutputName(const std::string& name) const
+{
+	if (_defines.empty()) return name;
+
+	//the order defines were added in doesn't make another permutation
+	std::vector<std::string> defines = _defines;
+	std::sort(defines.begin(), defines.end());
+	std::string set;
+	for (auto& define : defines) set += define + '\n';
+	return name + "." + ToHex(Cooked::Hash(set.data(), set.size()));
+}
+
+std::vector<std::string> ShaderCompiler::GetArguments(const ShaderSource& shader) const
+{
+	std::vector<std::string> arguments = { "-spirv", "-T" };
+	arguments.push_back(shader.stage == ShaderStage::PIXEL ? "ps_6_6" : shader.stage == ShaderStage::VERTEX ? "vs_6_6" : "cs_6_6");
+	arguments.insert(arguments.end(), { "-E", "main", _sourceDirectory + "/" + shader.name + ".hlsl", "-Fo", GetOutputName(shader.name) + ".spv", "-I", _sourceDirectory });
+	for (auto& define : _defines)
+	{
+		arguments.push_back("-D");
+		arguments.push_back(define);
+	}
+#ifndef NDEBUG
+	arguments.push_back("-Zi");
+	arguments.push_back("-Qembed_debug");
+#endif // NDEBUG
+	return arguments;
+}
+
+uint64_t ShaderCompiler::Hash(const ShaderSource& shader) const
+{
+	uint64_t hash = Cooked::Hash(&VERSION, sizeof(VERSION));
+	for (auto& argument : GetArguments(shader)) hash = Cooked::Hash(argument.c_str(), argument.size() + 1, hash);
+
+	std::set<std::filesystem::path> visited;
+	return HashIncludes(std::filesystem::path(_sourceDirectory) / (shader.name + ".hlsl"), _sourceDirectory, visited, hash);
+}
+
+void ShaderCompiler::Compile(const ShaderSource& shader, ShaderBuild& build, IDxcCompiler3* compiler, IDxcIncludeHandler* includeHandler) const
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::string shaderCode;
+	if (!ReadFile(_sourceDirectory + "/" + shader.name + ".hlsl", shaderCode))
+	{
+		build.failed = true;
+		build.messages = "can't read " + _sourceDirectory + "/" + shader.name + ".hlsl";
+		return;
+	}
+
+	DxcBuffer sourceBuffer;
+	sourceBuffer.Ptr = shaderCode.c_str();
+	sourceBuffer.Size = shaderCode.size();
+	sourceBuffer.Encoding = DXC_CP_ACP;
+
+	//dxc takes wide arguments, they have to outlive the call
+	std::vector<std::wstring> wideArguments;
+	for (auto& argument : GetArguments(shader)) wideArguments.emplace_back(argument.begin(), argument.end());
+	std::vector<LPCWSTR> arguments;
+	for (auto& argument : wideArguments) arguments.push_back(argument.c_str());
+
+	Microsoft::WRL::ComPtr<IDxcResult> result;
+	HRESULT status = compiler ? compiler->Compile(&sourceBuffer, arguments.data(), arguments.size(), includeHandler, IID_PPV_ARGS(&result)) : E_FAIL;
+	if (SUCCEEDED(status)) result->GetStatus(&status);
+
+	//errors and warnings share this output
+	Microsoft::WRL::ComPtr<IDxcBlobUtf8> errors;
+	if (result && SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) && errors && errors->GetStringLength() > 0)
+		build.messages = errors->GetStringPointer();
+
+	Microsoft::WRL::ComPtr<IDxcBlob> shaderBlob;
+	if (FAILED(status) || FAILED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr)) || !shaderBlob)
+	{
+		build.failed = true;
+		return;
+	}
+
+	// Write the compiled shader to file
+	std::ofstream outFile(GetOutputPath(shader.name), std::ios::binary | std::ios::trunc);
+	outFile.write(static_cast<const char*>(shaderBlob->GetBufferPointer()), shaderBlob->GetBufferSize());
+	build.failed = !outFile;
+
+	build.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ShaderCompiler::Build(const std::vector<ShaderSource>& shaders, unsigned int jobs)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::filesystem::create_directories(_outputDirectory);
+
+	std::string manifestPath = _outputDirectory + "/" + MANIFEST, text;
+	_manifest = ReadFile(manifestPath, text) ? nlohmann::json::parse(text, nullptr, false) : nlohmann::json::object();
+	if (!_manifest.is_object()) _manifest = nlohmann::json::object();
+
+	std::vector<ShaderBuild> builds(shaders.size());
+	std::vector<size_t> stale;
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		builds[i].name = shaders[i].name;
+		builds[i].hash = Hash(shaders[i]);
+		builds[i].upToDate = _manifest.value(GetOutputName(shaders[i].name), "") == ToHex(builds[i].hash) && std::filesystem::exists(GetOutputPath(shaders[i].name));
+		if (!builds[i].upToDate) stale.push_back(i);
+	}
+
+	if (!stale.empty())
+	{
+		if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+		jobs = (unsigned int)std::min<size_t>(jobs, stale.size());
+
+		std::atomic<size_t> next = 0;
+		auto worker = [&]()
+			{
+				Microsoft::WRL::ComPtr<IDxcCompiler3> compiler;
+				Microsoft::WRL::ComPtr<IDxcUtils> utils;
+				Microsoft::WRL::ComPtr<IDxcIncludeHandler> includeHandler;
+				DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
+				DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+				if (utils) utils->CreateDefaultIncludeHandler(&includeHandler);
+
+				for (size_t i = next++; i < stale.size(); i = next++)
+					Compile(shaders[stale[i]], builds[stale[i]], compiler.Get(), includeHandler.Get());
+			};
+
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < jobs; i++) workers.emplace_back(worker);
+		worker();
+		for (auto& w : workers) w.join();
+	}
+
+	//reported once everything is done so messages from different shaders don't interleave
+	unsigned int compiled = 0, upToDate = 0, failed = 0;
+	for (auto& build : builds)
+	{
+		if (build.upToDate)
+		{
+			upToDate++;
+			continue;
+		}
+
+		//the previous spv was built from other sources or defines, the renderer's descriptors may no longer match it
+		if (build.failed)
+		{
+			std::cout << "Error: shader " << build.name << " failed to compile, removing its stale spv\n" << build.messages << '\n';
+			std::error_code error;
+			std::filesystem::remove(GetOutputPath(build.name), error);
+			_manifest.erase(GetOutputName(build.name));
+			failed++;
+			continue;
+		}
+
+		if (!build.messages.empty()) std::cout << "Warning: shader " << build.name << ":\n" << build.messages << '\n';
+		_manifest[GetOutputName(build.name)] = ToHex(build.hash);
+		compiled++;
+	}
+
+	if (compiled || failed)
+	{
+		std::ofstream manifest(manifestPath, std::ios::trunc);
+		manifest << _manifest.dump(1, '\t');
+	}
+
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Shaders: " << compiled << " compiled, " << upToDate << " up to date, " << failed << " failed in " << ms << "ms (" << (stale.empty() ? "warm" : "cold") << ")\n";
+	return failed == 0;
+}
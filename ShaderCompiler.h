@@ -0,0 +1,54 @@
+#pragma once
+
+enum class ShaderStage
+{
+	PIXEL,
+	VERTEX,
+	COMPUTE
+};
+
+//Shaders/<name>.hlsl compiles to Shaders/SPV/<name>.spv, or <name>.<define set hash>.spv with defines
+struct ShaderSource
+{
+	ShaderStage stage;
+	std::string name;
+};
+
+struct ShaderBuild
+{
+	std::string name;
+	uint64_t hash = 0; //source, everything it includes and the dxc arguments
+	bool upToDate = false;
+	bool failed = false;
+	std::string messages; //dxc errors and warnings
+	float ms = 0.f;
+};
+
+//incremental dxc front end, a shader is only recompiled when its hash differs from the one its spv was built from
+//stale shaders compile in parallel, each worker thread owns its compiler since dxc instances aren't shared between threads
+class ShaderCompiler
+{
+	std::string _sourceDirectory, _outputDirectory;
+	std::vector<std::string> _defines;
+	nlohmann::json _manifest; //output name -> hash of its spv
+
+	std::vector<std::string> GetArguments(const ShaderSource& shader) const;
+	uint64_t Hash(const ShaderSource& shader) const;
+	void Compile(const ShaderSource& shader, ShaderBuild& build, IDxcCompiler3* compiler, IDxcIncludeHandler* includeHandler) const;
+
+public:
+	static constexpr uint32_t VERSION = 1; //bump to rebuild every shader
+	static constexpr const char* MANIFEST = "shaders.json";
+
+	ShaderCompiler(const std::string& sourceDirectory = "Shaders", const std::string& outputDirectory = "Shaders/SPV");
+
+	void AddDefine(const std::string& define) { _defines.push_back(define); }
+
+	//each define set builds its own spv, so switching permutations back and forth finds them all up to date
+	std::string GetOutputName(const std::string& name) const;
+	std::string GetOutputPath(const std::string& name) const { return _outputDirectory + "/" + GetOutputName(name) + ".spv"; }
+
+	//compiles every stale shader on up to 'jobs' threads (0 = hardware concurrency), false if any failed
+	//a failed shader loses its previous spv, which was built from other inputs, and is retried next run, the others are unaffected
+	bool Build(const std::vector<ShaderSource>& shaders, unsigned int jobs = 0);
+};
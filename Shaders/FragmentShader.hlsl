@@ -1,9 +1,19 @@
+//depth instead of position with COMPACT_GBUFFER
+#ifdef SUBPASS_INPUTS
+//the frame graph merged this pass into the offscreen pass, the gbuffer is read from tile memory at this pixel
+[[vk::input_attachment_index(0)]] SubpassInput textureposition : register(t1);
+[[vk::input_attachment_index(1)]] SubpassInput textureNormal : register(t2);
+[[vk::input_attachment_index(2)]] SubpassInput textureAlbedo : register(t3);
+#define GBUFFER_LOAD(name, uv) texture##name.SubpassLoad()
+#else
 Texture2D textureposition : register(t1);
 SamplerState samplerposition : register(s1);
 Texture2D textureNormal : register(t2);
 SamplerState samplerNormal : register(s2);
 Texture2D textureAlbedo : register(t3);
 SamplerState samplerAlbedo : register(s3);
+#define GBUFFER_LOAD(name, uv) texture##name.Sample(sampler##name, uv)
+#endif
 
 struct Light
 {
@@ -12,26 +22,61 @@ struct Light
     float radius;
 };
 
+//MAX_LIGHTS and TILE_SIZE are defined by the renderer from Structs.h
 cbuffer UniformBufferFinal : register(b0)
 {
-    Light lights[10];
+    Light lights[MAX_LIGHTS];
     float4 view;
     matrix viewProj;
+    matrix inverseViewProj;
+    uint lightCount;
 };
 
-float4 main(float2 inUV : TEXCOORD0) : SV_TARGET
+#ifdef COMPACT_GBUFFER
+//a bit per light reaching each tile, from LightCulling
+Texture2D<uint2> lightTiles : register(t4);
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += float2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+#endif
+
+float3 Shade(Light light, float3 fragPos, float3 normal, float3 albedo)
+{
+    //diffuse
+    float3 lightDir = normalize(light.pos - fragPos);
+    float3 diffuse = max(dot(normal, lightDir), 0.0) * albedo * light.col;
+
+    //attenuation
+    float dist = length(light.pos - fragPos);
+    float attenuation = saturate(1.0 - (dist / light.radius));
+    return diffuse * attenuation;
+}
+
+float4 main(float4 position : SV_Position, float2 inUV : TEXCOORD0) : SV_TARGET
 {
-    float3 fragPos = normalize(textureposition.Sample(samplerposition, inUV).rgb);
-    float3 normal = normalize(textureNormal.Sample(samplerNormal, inUV).rgb);
-    float3 albedo = textureAlbedo.Sample(samplerAlbedo, inUV).rgb;
-    float specular = textureAlbedo.Sample(samplerAlbedo, inUV).a;
+#ifdef COMPACT_GBUFFER
+    //world position from depth, uv (0, 0) is ndc (-1, -1) in vulkan
+    float depth = GBUFFER_LOAD(position, inUV).r;
+    float4 worldPos = mul(inverseViewProj, float4(inUV * 2.0 - 1.0, depth, 1.0));
+    float3 fragPos = worldPos.xyz / worldPos.w;
+    float3 normal = OctahedralDecode(GBUFFER_LOAD(Normal, inUV).rg);
+#else
+    float3 fragPos = normalize(GBUFFER_LOAD(position, inUV).rgb);
+    float3 normal = normalize(GBUFFER_LOAD(Normal, inUV).rgb);
+#endif
+    float3 albedo = GBUFFER_LOAD(Albedo, inUV).rgb;
+    float specular = GBUFFER_LOAD(Albedo, inUV).a;
   
     //return float4(normalize(fragPos), 1.0); // Visualize position
   // return float4(normal, 1.0); // Visualize normal
    //return float4(albedo.rgb, 1.0); // Visualize albedo
     
    // return float4(lights[0].col, 1);
-#define lightCount 4
 #define ambient 0
     //float3 fragcolor;
     
@@ -39,21 +84,19 @@ float4 main(float2 inUV : TEXCOORD0) : SV_TARGET
     
     float3 fragcolor = albedo * 0;
     float3 viewDir = normalize(view.xyz - fragPos);
-    for (int i = 0; i < 10; i++)
+#ifdef COMPACT_GBUFFER
+    //only the lights whose radius reaches this pixel's tile, the rest would attenuate to nothing
+    uint2 tileLights = lightTiles.Load(int3(uint2(position.xy) / TILE_SIZE, 0));
+    for (uint word = 0; word < 2; word++)
     {
-        //float4 lightPos = mul(viewProj, float4(lights[i].pos, 1));
-        //diffuse
-        float3 lightDir = normalize(lights[i].pos - fragPos);
-        float3 diffuse = max(dot(normal, lightDir), 0.0) * albedo * lights[i].col;
-        
-        //attenuation
-        float dist = length(lights[i].pos - fragPos);
-        float attenuation = saturate(1.0 - (dist / lights[i].radius));
-        diffuse *= attenuation;
-        
-        //accumulate the light contribution
-        fragcolor += diffuse;
+        for (uint bits = tileLights[word]; bits != 0; bits &= bits - 1)
+            fragcolor += Shade(lights[word * 32 + firstbitlow(bits)], fragPos, normal, albedo);
     }
+#else
+    //world positions are only rebuilt in the compact layout, tiles culled in world space don't apply here
+    for (uint i = 0; i < lightCount; i++)
+        fragcolor += Shade(lights[i], fragPos, normal, albedo);
+#endif
    
   
     return float4(fragcolor, 1);
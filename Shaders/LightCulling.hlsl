@@ -0,0 +1,85 @@
+//a thread per TILE_SIZE square of pixels, writes a bit for every light whose sphere reaches into the tile's frustum
+//needs nothing from this frame's gbuffer, so it can run on the async compute queue while the offscreen pass draws
+struct Light
+{
+    float3 pos;
+    float3 col;
+    float radius;
+};
+
+//MAX_LIGHTS and TILE_SIZE are defined by the renderer from Structs.h
+cbuffer UniformBufferFinal : register(b0)
+{
+    Light lights[MAX_LIGHTS];
+    float4 view;
+    matrix viewProj;
+    matrix inverseViewProj;
+    uint lightCount;
+};
+
+//MAX_LIGHTS bits per tile
+RWTexture2D<uint2> lightTiles : register(u1);
+
+struct PushConstants
+{
+    uint2 screenSize;
+};
+[[vk::push_constant]] PushConstants pushConstants;
+
+float3 Unproject(float2 ndc, float depth)
+{
+    float4 worldPos = mul(inverseViewProj, float4(ndc, depth, 1.0));
+    return worldPos.xyz / worldPos.w;
+}
+
+//plane through a, b and c, facing the side 'inside' is on
+float4 Plane(float3 a, float3 b, float3 c, float3 inside)
+{
+    float3 n = normalize(cross(b - a, c - a));
+    float4 plane = float4(n, -dot(n, a));
+    return dot(plane, float4(inside, 1.0)) < 0.0 ? -plane : plane;
+}
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint2 tiles;
+    lightTiles.GetDimensions(tiles.x, tiles.y);
+    if (any(id.xy >= tiles))
+        return;
+
+    //pixel (0, 0) is ndc (-1, -1) in vulkan, the last tile stops at the screen's edge
+    float2 ndcMin = float2(id.xy * TILE_SIZE) / pushConstants.screenSize * 2.0 - 1.0;
+    float2 ndcMax = float2(min((id.xy + 1) * TILE_SIZE, pushConstants.screenSize)) / pushConstants.screenSize * 2.0 - 1.0;
+
+    //bit 0 picks max x, bit 1 max y, bit 2 the far plane
+    float3 corners[8];
+    float3 center = 0.0;
+    for (uint i = 0; i < 8; i++)
+    {
+        corners[i] = Unproject(float2((i & 1) ? ndcMax.x : ndcMin.x, (i & 2) ? ndcMax.y : ndcMin.y), (i & 4) ? 1.0 : 0.0);
+        center += corners[i] / 8.0;
+    }
+
+    float4 planes[6] =
+    {
+        Plane(corners[0], corners[2], corners[4], center), //min x
+        Plane(corners[1], corners[3], corners[5], center), //max x
+        Plane(corners[0], corners[1], corners[4], center), //min y
+        Plane(corners[2], corners[3], corners[6], center), //max y
+        Plane(corners[0], corners[1], corners[2], center), //near
+        Plane(corners[4], corners[5], corners[6], center), //far
+    };
+
+    //the composition pass's attenuation reaches zero at the radius, lights outside every tile sphere contribute nothing
+    uint2 mask = 0;
+    for (uint light = 0; light < lightCount; light++)
+    {
+        bool visible = true;
+        for (uint p = 0; p < 6; p++)
+            visible = visible && dot(planes[p], float4(lights[light].pos, 1.0)) > -lights[light].radius;
+        if (visible)
+            mask[light / 32] |= 1u << (light % 32);
+    }
+    lightTiles[id.xy] = mask;
+}
@@ -6,17 +6,51 @@ struct VSOutput
     float3 tan : TANGENT;
 };
 
+#ifdef BINDLESS
+//every material texture, indexed by the draw's push constant
+Texture2D materialTextures[] : register(t0, space1);
+SamplerState materialSamplers[] : register(s0, space1);
+
+struct PCR
+{
+    matrix model;
+    uint textureIndex;
+};
+
+[[vk::push_constant]] PCR _pcr;
+
+static const uint INVALID_TEXTURE = 0xFFFFFFFF;
+#endif
+
+#ifdef COMPACT_GBUFFER
+//position comes back from depth, the normal is octahedral encoded
+struct FSOutput
+{
+    float2 Normal : SV_TARGET0;
+    float4 UV : SV_TARGET1;
+};
+
+float2 OctahedralEncode(float3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    float2 signs = float2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+#else
 struct FSOutput
 {
     float4 Position : SV_TARGET0;
     float4 Normal : SV_TARGET1;
     float4 UV : SV_TARGET2;
 };
+#endif
 
 FSOutput main(VSOutput input)
 {
     FSOutput output;
+#ifndef COMPACT_GBUFFER
     output.Position = input.pos;
+#endif
     
     float3 N = normalize(input.nrm);
     float3 T = normalize(input.tan);
@@ -29,7 +63,15 @@ FSOutput main(VSOutput input)
     float3 worldNormal = normalize(mul(flatNormal, TBN));
 
     // Output world-space normal
+#ifdef COMPACT_GBUFFER
+    output.Normal = OctahedralEncode(worldNormal);
+#else
     output.Normal = float4(worldNormal, 1.0);
+#endif
     output.UV = float4(0.7, 0.7, 0.7, 1);
+#ifdef BINDLESS
+    if (_pcr.textureIndex != INVALID_TEXTURE)
+        output.UV = float4(materialTextures[_pcr.textureIndex].Sample(materialSamplers[_pcr.textureIndex], input.uv).rgb, 1);
+#endif
     return output;
 }
\ No newline at end of file
@@ -23,6 +23,7 @@ cbuffer UniformBuffer : register(b0)
 struct PCR
 {
     matrix model;
+    uint textureIndex;
 };
 
 [[vk::push_constant]] PCR _pcr;
@@ -0,0 +1,356 @@
+#include "pch.h"
+
+bool StagingRing::Create(MemoryAllocator& allocator, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily, VkCommandPool commandPool, VkDeviceSize capacity, unsigned int framesInFlight)
+{
+	if (allocator.CreateBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, "Staging Ring") != VK_SUCCESS) return false;
+
+	_allocator = &allocator;
+	_device = device;
+	_queue = queue;
+	_queueFamily = queueFamily;
+	_commandPool = commandPool;
+	_capacity = _baseCapacity = capacity;
+	_head = _tail = 0;
+	_frameEnds.assign(framesInFlight, 0);
+
+	if (!GvkHelper::supports_timeline_semaphores(physicalDevice)) return true;
+
+	//gateware creates a queue on the dedicated transfer family when there is one, otherwise uploads share the graphics queue
+	_uploadQueue = _queue;
+	_uploadFamily = queueFamily;
+	uint32_t transferFamily;
+	if (GvkHelper::find_dedicated_transfer_queue_family(physicalDevice, &transferFamily) == VK_SUCCESS)
+	{
+		vkGetDeviceQueue(_device, transferFamily, 0, &_uploadQueue);
+		_uploadFamily = transferFamily;
+	}
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = _uploadFamily;
+	vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &_uploadPool);
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+	vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_timeline);
+
+	_submittedValue = _completedValue = 0;
+	return true;
+}
+
+void StagingRing::Destroy()
+{
+	if (!IsCreated()) return;
+
+	if (IsAsync())
+	{
+		vkQueueWaitIdle(_uploadQueue);
+		vkDestroyCommandPool(_device, _uploadPool, nullptr);
+		vkDestroySemaphore(_device, _timeline, nullptr);
+		_timeline = VK_NULL_HANDLE;
+		_inFlight.clear();
+		_freeCommandBuffers.clear();
+		_acquires.clear();
+	}
+
+	_allocator->DestroyBuffer(_buffer);
+	_pending.clear();
+	_pendingImages.clear();
+	_pendingBytes = 0;
+	_allocator = nullptr;
+}
+
+void StagingRing::Retire()
+{
+	vkGetSemaphoreCounterValue(_device, _timeline, &_completedValue);
+
+	while (!_inFlight.empty() && _inFlight.front().value <= _completedValue)
+	{
+		_tail = std::max(_tail, _inFlight.front().end);
+		_freeCommandBuffers.push_back(_inFlight.front().commandBuffer);
+		_inFlight.pop_front();
+	}
+}
+
+void StagingRing::BeginFrame(unsigned int frameSlot)
+{
+	if (IsAsync()) Retire();
+	else
+	{
+		_frame = frameSlot;
+
+		//frames finish in submission order, so everything up to this slot's last flush is free
+		if (_frameEnds[_frame]) _tail = std::max(_tail, _frameEnds[_frame]);
+		_frameEnds[_frame] = 0;
+	}
+
+	//a batch's growth isn't kept, the memory goes back once nothing reads the ring anymore
+	if (_capacity > _baseCapacity && _head == _tail && _inFlight.empty() && _pending.empty() && _pendingImages.empty()) Reallocate(_baseCapacity);
+}
+
+bool StagingRing::Reallocate(VkDeviceSize capacity)
+{
+	Buffer buffer;
+	if (_allocator->CreateBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, "Staging Ring") != VK_SUCCESS) return false;
+
+	_allocator->DestroyBuffer(_buffer);
+	_buffer = buffer;
+	_capacity = capacity;
+	_head = _tail = 0;
+	std::fill(_frameEnds.begin(), _frameEnds.end(), 0);
+	return true;
+}
+
+uint8_t* StagingRing::Stage(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& srcOffset)
+{
+	if (size > _capacity) return nullptr;
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+
+	uint64_t start = (_head + alignment - 1) / alignment * alignment;
+	//allocations never straddle the end of the buffer, the tail end is skipped instead
+	if (start % _capacity + size > _capacity) start = (start / _capacity + 1) * _capacity;
+	if (start + size - _tail > _capacity) return nullptr;
+
+	_head = start + size;
+	srcOffset = start % _capacity;
+	return _buffer.allocation.mapped + srcOffset;
+}
+
+uint64_t StagingRing::Upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	VkDeviceSize chunkSize = _capacity / 4;
+
+	while (size)
+	{
+		VkDeviceSize chunk = std::min(size, chunkSize);
+		VkDeviceSize srcOffset;
+		uint8_t* mapped = Stage(chunk, 4, srcOffset);
+		if (!mapped)
+		{
+			FlushAndWait();
+			mapped = Stage(chunk, 4, srcOffset);
+		}
+
+		memcpy(mapped, src, chunk);
+
+		auto& regions = _pending[dst];
+		if (!regions.empty() && regions.back().srcOffset + regions.back().size == srcOffset && regions.back().dstOffset + regions.back().size == dstOffset)
+			regions.back().size += chunk;
+		else
+			regions.push_back({ srcOffset, dstOffset, chunk });
+
+		_pendingBytes += chunk;
+		src += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+	}
+
+	//whatever is pending goes out with the next submission
+	return IsAsync() ? _submittedValue + 1 : 0;
+}
+
+uint64_t StagingRing::UploadImage(VkImage image, uint32_t mipLevels, const std::vector<VkBufferImageCopy>& regions, const void* data, VkDeviceSize size)
+{
+	if (size > _capacity)
+	{
+		std::cout << "Error: " << size << " byte image doesn't fit in the " << _capacity << " byte staging ring\n";
+		return FAILED;
+	}
+
+	//16 covers the texel block size of every compressed format
+	VkDeviceSize srcOffset;
+	uint8_t* mapped = Stage(size, 16, srcOffset);
+	if (!mapped)
+	{
+		FlushAndWait();
+		mapped = Stage(size, 16, srcOffset);
+	}
+	if (!mapped) return FAILED;
+
+	memcpy(mapped, data, size);
+
+	PendingImage pending = { image, mipLevels, regions };
+	for (auto& region : pending.regions) region.bufferOffset += srcOffset;
+	_pendingImages.push_back(std::move(pending));
+	_pendingBytes += size;
+
+	return IsAsync() ? _submittedValue + 1 : 0;
+}
+
+bool StagingRing::Reserve(VkDeviceSize size)
+{
+	if (size <= _capacity) return true;
+
+	//drained, so nothing on either queue still reads the old buffer
+	FlushAndWait();
+	if (Reallocate(size)) return true;
+
+	std::cout << "Warning: can't grow the staging ring to " << size << " bytes, uploading in " << _capacity << " byte batches\n";
+	return false;
+}
+
+void StagingRing::Record(VkCommandBuffer commandBuffer)
+{
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	for (auto& pending : _pendingImages)
+	{
+		VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = pending.image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, pending.mipLevels, 0, 1 };
+		imageBarriers.push_back(barrier);
+	}
+	if (!imageBarriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, imageBarriers.size(), imageBarriers.data());
+
+	for (auto& [dst, regions] : _pending) vkCmdCopyBuffer(commandBuffer, _buffer.buffer, dst, regions.size(), regions.data());
+	for (auto& pending : _pendingImages) vkCmdCopyBufferToImage(commandBuffer, _buffer.buffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pending.regions.size(), pending.regions.data());
+
+	//on a dedicated transfer family this is the release half, the graphics queue acquires once the upload has completed
+	bool release = IsAsync() && _uploadFamily != _queueFamily;
+	for (auto& barrier : imageBarriers)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = release ? 0 : VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		if (release)
+		{
+			barrier.srcQueueFamilyIndex = _uploadFamily;
+			barrier.dstQueueFamilyIndex = _queueFamily;
+
+			Acquire acquire = { _submittedValue + 1, barrier };
+			acquire.barrier.srcAccessMask = 0;
+			acquire.barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			_acquires.push_back(acquire);
+		}
+	}
+	if (!imageBarriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, imageBarriers.size(), imageBarriers.data());
+
+	_pending.clear();
+	_pendingImages.clear();
+	_pendingBytes = 0;
+
+	//async copies are made visible by the timeline semaphore wait instead
+	if (IsAsync()) return;
+
+	VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void StagingRing::Flush(VkCommandBuffer commandBuffer)
+{
+	if (_pending.empty() && _pendingImages.empty()) return;
+
+	if (!IsAsync())
+	{
+		Record(commandBuffer);
+		_frameEnds[_frame] = _head;
+		return;
+	}
+
+	//everything queued since the last flush goes out as one submission
+	VkCommandBuffer uploadCommandBuffer;
+	if (_freeCommandBuffers.empty())
+	{
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		commandBufferAllocateInfo.commandPool = _uploadPool;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+		vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &uploadCommandBuffer);
+	}
+	else
+	{
+		uploadCommandBuffer = _freeCommandBuffers.back();
+		_freeCommandBuffers.pop_back();
+	}
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(uploadCommandBuffer, &commandBufferBeginInfo);
+	Record(uploadCommandBuffer);
+	vkEndCommandBuffer(uploadCommandBuffer);
+
+	//Record tagged its acquires with this value
+	uint64_t value = ++_submittedValue;
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSubmitInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineSubmitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &uploadCommandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &_timeline;
+	vkQueueSubmit(_uploadQueue, 1, &submitInfo, VK_NULL_HANDLE);
+
+	_inFlight.push_back({ value, _head, uploadCommandBuffer });
+}
+
+void StagingRing::FlushAndWait()
+{
+	if (IsAsync())
+	{
+		Flush(VK_NULL_HANDLE);
+
+		VkSemaphoreWaitInfo semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		semaphoreWaitInfo.semaphoreCount = 1;
+		semaphoreWaitInfo.pSemaphores = &_timeline;
+		semaphoreWaitInfo.pValues = &_submittedValue;
+		vkWaitSemaphores(_device, &semaphoreWaitInfo, UINT64_MAX);
+		Retire();
+
+		if (!_acquires.empty())
+		{
+			VkCommandBuffer commandBuffer;
+			GvkHelper::signal_command_start(_device, _commandPool, &commandBuffer);
+			RecordAcquires(commandBuffer);
+			GvkHelper::signal_command_end(_device, _queue, _commandPool, &commandBuffer);
+		}
+		return;
+	}
+
+	if (!_pending.empty() || !_pendingImages.empty())
+	{
+		VkCommandBuffer commandBuffer;
+		GvkHelper::signal_command_start(_device, _commandPool, &commandBuffer);
+		Record(commandBuffer);
+		GvkHelper::signal_command_end(_device, _queue, _commandPool, &commandBuffer);
+	}
+	else vkQueueWaitIdle(_queue);
+
+	//the queue is idle, so every earlier frame's copies are done as well
+	_tail = _head;
+	std::fill(_frameEnds.begin(), _frameEnds.end(), 0);
+}
+
+void StagingRing::RecordAcquires(VkCommandBuffer commandBuffer)
+{
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (size_t i = 0; i < _acquires.size();)
+	{
+		//the frame's submission waits on the completed value, which orders it after the release
+		if (_acquires[i].value <= _completedValue)
+		{
+			barriers.push_back(_acquires[i].barrier);
+			_acquires[i] = _acquires.back();
+			_acquires.pop_back();
+		}
+		else i++;
+	}
+
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+}
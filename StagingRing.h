@@ -0,0 +1,105 @@
+#pragma once
+
+//persistently mapped upload ring, data is copied in on the cpu and copied to its destination on the gpu
+//with timeline semaphores the copies go out in their own submission, on the dedicated transfer queue if the device has one,
+//and Upload returns the timeline value the data is usable from; the renderer waits on the completed value, which never stalls
+//without them the copies are recorded into the frame's command buffer and space comes back with the frame's fence
+class StagingRing
+{
+	struct PendingImage
+	{
+		VkImage image;
+		uint32_t mipLevels;
+		std::vector<VkBufferImageCopy> regions; //bufferOffset is in the ring
+	};
+
+	struct Acquire
+	{
+		uint64_t value; //the release is submitted with this timeline value
+		VkImageMemoryBarrier barrier;
+	};
+
+	struct Submission
+	{
+		uint64_t value; //timeline value signalled once the copies are done
+		uint64_t end; //ring head when it was submitted
+		VkCommandBuffer commandBuffer;
+	};
+
+	MemoryAllocator* _allocator = nullptr;
+	VkDevice _device = VK_NULL_HANDLE;
+	VkQueue _queue = VK_NULL_HANDLE;
+	uint32_t _queueFamily = VK_QUEUE_FAMILY_IGNORED;
+	VkCommandPool _commandPool = VK_NULL_HANDLE;
+	Buffer _buffer = {};
+	VkDeviceSize _capacity = 0;
+	VkDeviceSize _baseCapacity = 0; //what Create was given, a ring grown by Reserve goes back to it once drained
+
+	//monotonic byte positions, offsets in the buffer are position % capacity
+	uint64_t _head = 0, _tail = 0;
+
+	//frame recorded path
+	std::vector<uint64_t> _frameEnds; //head at each frame slot's flush, 0 if it flushed nothing
+	unsigned int _frame = 0;
+
+	//async path
+	VkQueue _uploadQueue = VK_NULL_HANDLE;
+	uint32_t _uploadFamily = VK_QUEUE_FAMILY_IGNORED;
+	VkCommandPool _uploadPool = VK_NULL_HANDLE;
+	VkSemaphore _timeline = VK_NULL_HANDLE;
+	uint64_t _submittedValue = 0, _completedValue = 0;
+	std::deque<Submission> _inFlight;
+	std::vector<VkCommandBuffer> _freeCommandBuffers;
+	//images released by the transfer family still to be acquired on the graphics queue
+	std::vector<Acquire> _acquires;
+
+	//adjacent regions into the same buffer are merged as they are queued
+	std::map<VkBuffer, std::vector<VkBufferCopy>> _pending;
+	std::vector<PendingImage> _pendingImages;
+	VkDeviceSize _pendingBytes = 0;
+
+	uint8_t* Stage(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& srcOffset);
+	void Record(VkCommandBuffer commandBuffer);
+	void Retire();
+	//replaces the buffer, only while nothing is queued or in flight. a failure leaves the old one
+	bool Reallocate(VkDeviceSize capacity);
+
+public:
+	static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull << 20;
+	static constexpr uint64_t FAILED = UINT64_MAX;
+
+	bool Create(MemoryAllocator& allocator, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily, VkCommandPool commandPool, VkDeviceSize capacity, unsigned int framesInFlight);
+	void Destroy();
+	bool IsCreated() const { return _allocator != nullptr; }
+	bool IsAsync() const { return _timeline != VK_NULL_HANDLE; }
+
+	//call after the frame slot's fence wait, reclaims finished uploads and shrinks a grown ring once it's drained
+	void BeginFrame(unsigned int frameSlot);
+
+	//any size, uploads bigger than the free space are split and the ring drained with a blocking wait as needed
+	//returns the timeline value the data can be used from, 0 when it is usable in the current frame
+	uint64_t Upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	//every mip of an image at once, the regions' bufferOffsets are relative to data
+	//the image goes from undefined to shader read only, all images queued before a flush share one submission and one barrier per direction
+	//FAILED when it doesn't fit in the ring, nothing is queued for the image then
+	uint64_t UploadImage(VkImage image, uint32_t mipLevels, const std::vector<VkBufferImageCopy>& regions, const void* data, VkDeviceSize size);
+	//grows the ring so a batch of this many bytes goes out in one submission, drains it first
+	//false when the memory isn't there, the ring keeps its size and uploads go out in ring sized batches
+	bool Reserve(VkDeviceSize size);
+
+	//records the queued copies into the frame's command buffer, or submits them to the upload queue when async
+	void Flush(VkCommandBuffer commandBuffer);
+	//graphics queue half of the ownership transfer for images released by completed uploads, after Flush
+	void RecordAcquires(VkCommandBuffer commandBuffer);
+	//submits the queued copies on their own and waits for them, everything queued is usable on return
+	void FlushAndWait();
+
+	const Buffer& GetBuffer() const { return _buffer; }
+	VkDeviceSize GetCapacity() const { return _capacity; }
+	VkDeviceSize GetPendingBytes() const { return _pendingBytes; }
+	VkSemaphore GetTimeline() const { return _timeline; }
+	//sampled in BeginFrame, so waiting on it from this frame's submission never blocks
+	uint64_t GetCompletedValue() const { return _completedValue; }
+	//differs from the graphics family when uploads run on a dedicated transfer queue
+	uint32_t GetUploadFamily() const { return _uploadFamily; }
+};
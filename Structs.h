@@ -2,15 +2,15 @@
 
 struct Buffer
 {
-	VkBuffer buffer;
-	VkDeviceMemory memory;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
 };
 
 struct Image
 {
-	VkImage image;
-	VkImageView imageView;
-	VkDeviceMemory memory;
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	Allocation allocation;
 };
 
 struct Texture
@@ -40,7 +40,6 @@ struct FrameBufferT
 	VkPipelineBindPoint bindPoint;
 	VkPipeline pipeline;
 	VkPipelineLayout pipelineLayout;
-	VkDescriptorPool descriptorPool;
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorSet descriptorSet;
 	std::vector<VkShaderModule> shaderModules;
@@ -71,11 +70,25 @@ struct UniformBufferOffscreen
 	vec3 pad;
 };
 
+//handed to the shaders as -D defines by VulkanRenderer::CompileShaders
+constexpr unsigned int MAX_LIGHTS = 64; //a tile's mask holds a bit per light
+constexpr unsigned int LIGHT_TILE_SIZE = 16; //pixels, TILE_SIZE in the shaders
+
 struct UniformBufferFinal
 {
-	Light lights[10];
+	Light lights[MAX_LIGHTS];
 	vec4 view;
 	mat4 viewProj;
+	mat4 inverseViewProj; //compact g-buffer rebuilds positions from depth with it
+	unsigned int lightCount;
+	vec3 pad;
+};
+
+//FULL stores world position and a 64 bit normal, COMPACT keeps depth and an octahedral RG16 normal instead
+enum class GBufferLayout
+{
+	FULL,
+	COMPACT
 };
 
 struct Vertex
@@ -88,6 +101,8 @@ struct Vertex
 struct PCR
 {
 	mat4 model;
+	uint32_t textureIndex; //into the bindless array, BindlessTextures::INVALID for none
+	uint32_t pad[3];
 };
 
 struct PrimData
@@ -227,4 +242,31 @@ struct DrawInfo
 {
 	unsigned int idxCount, firstIdx, vertexOffset;
 	mat4 nodeWorld;
+	int textureIndex = -1; //into ModelData::texturePaths once loaded, into the bindless array once the scene uploads them
+};
+
+//one loaded asset, draw offsets are relative to its own geometry
+struct ModelData
+{
+	GeometryData geometry;
+	std::vector<DrawInfo> draws;
+	std::vector<std::string> texturePaths; //cooked textures, empty when loaded straight from the gltf
+};
+
+//filled in by VulkanRenderer::Render, read by the benchmark runner
+struct FrameStats
+{
+	float cpuMs = 0.f; //Render() minus the fence wait
+	float gpuMs = -1.f; //offscreen + composition from timestamp queries, -1 if unsupported or not available yet
+	unsigned int draws = 0;
+	unsigned long long triangles = 0;
+	unsigned long long geometryBytes = 0; //in use in the geometry arena
+	unsigned long long frame = 0;
+	unsigned long long deviceUsage = 0, deviceBudget = 0; //summed over device local heaps, see MemoryAllocator::GetBudgets
+	unsigned long long transientBytes = 0, transientSavedBytes = 0; //frame graph images, saved by aliasing and lazily allocated memory
+	float gBufferBytesPerPixel = 0.f; //offscreen attachments stored for the composition pass to read
+	unsigned long long commandBuffers = 0; //allocated by the frame command pools so far, flat once warmed up
+	unsigned int barriers = 0; //image barriers the frame graph inferred for the frame
+	unsigned int mergedPasses = 0; //render passes the frame graph merged into another's subpass, 0 with merging off
+	float asyncMs = 0.f, asyncOverlapMs = 0.f; //frame graph nodes on their own queues and the part of that overlapping graphics nodes
 };
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+
+// Header only and free of vulkan, so the CPU-only tests build it without a device
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+
+//two level segregated fit over [0, size), constant time allocate and free
+//free ranges are bucketed by log2 size (first level) and 16 linear steps within it (second level)
+class TlsfAllocator
+{
+public:
+	struct Node
+	{
+		uint64_t offset = 0, size = 0;
+		Node* prevPhysical = nullptr;
+		Node* nextPhysical = nullptr;
+		Node* prevFree = nullptr;
+		Node* nextFree = nullptr;
+		bool free = true;
+	};
+
+private:
+	static constexpr uint32_t SL_LOG2 = 4;
+	static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+	static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+	Node* _head = nullptr; //lowest offset, walks the physical list
+	Node* _freeLists[FL_COUNT][SL_COUNT] = {};
+	uint64_t _flBitmap = 0;
+	uint32_t _slBitmaps[FL_COUNT] = {};
+	uint64_t _size = 0, _used = 0;
+	uint32_t _allocationCount = 0;
+
+	static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+	Node* FindSuitable(uint64_t size) const;
+	void InsertFree(Node* node);
+	void RemoveFree(Node* node);
+	void Clear();
+
+public:
+	TlsfAllocator() = default;
+	TlsfAllocator(const TlsfAllocator&) = delete;
+	TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+	~TlsfAllocator() { Clear(); }
+
+	void Reset(uint64_t size);
+	//null when no free range fits, the returned node's offset is aligned
+	Node* Allocate(uint64_t size, uint64_t alignment);
+	void Free(Node* node);
+
+	uint64_t GetSize() const { return _size; }
+	uint64_t GetUsed() const { return _used; }
+	uint32_t GetAllocationCount() const { return _allocationCount; }
+	bool IsEmpty() const { return _allocationCount == 0; }
+};
+
+inline void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+	uint32_t msb = std::bit_width(size) - 1;
+	if (msb < SL_LOG2)
+	{
+		fl = 0;
+		sl = uint32_t(size);
+		return;
+	}
+
+	fl = msb - SL_LOG2 + 1;
+	sl = uint32_t(size >> (msb - SL_LOG2)) - SL_COUNT;
+}
+
+//rounds the request up to the next class so every node in the list found is big enough
+inline TlsfAllocator::Node* TlsfAllocator::FindSuitable(uint64_t size) const
+{
+	uint32_t msb = std::bit_width(size) - 1;
+	if (msb >= SL_LOG2) size += (uint64_t(1) << (msb - SL_LOG2)) - 1;
+
+	uint32_t fl, sl;
+	Mapping(size, fl, sl);
+	if (fl >= FL_COUNT) return nullptr;
+
+	uint32_t slMap = _slBitmaps[fl] & (~0u << sl);
+	if (!slMap)
+	{
+		uint64_t flMap = fl + 1 < FL_COUNT ? _flBitmap & (~0ull << (fl + 1)) : 0;
+		if (!flMap) return nullptr;
+
+		fl = std::countr_zero(flMap);
+		slMap = _slBitmaps[fl];
+	}
+
+	return _freeLists[fl][std::countr_zero(slMap)];
+}
+
+inline void TlsfAllocator::InsertFree(Node* node)
+{
+	uint32_t fl, sl;
+	Mapping(node->size, fl, sl);
+
+	node->free = true;
+	node->prevFree = nullptr;
+	node->nextFree = _freeLists[fl][sl];
+	if (node->nextFree) node->nextFree->prevFree = node;
+	_freeLists[fl][sl] = node;
+
+	_flBitmap |= 1ull << fl;
+	_slBitmaps[fl] |= 1u << sl;
+}
+
+inline void TlsfAllocator::RemoveFree(Node* node)
+{
+	uint32_t fl, sl;
+	Mapping(node->size, fl, sl);
+
+	if (node->prevFree) node->prevFree->nextFree = node->nextFree;
+	else _freeLists[fl][sl] = node->nextFree;
+	if (node->nextFree) node->nextFree->prevFree = node->prevFree;
+
+	if (!_freeLists[fl][sl])
+	{
+		_slBitmaps[fl] &= ~(1u << sl);
+		if (!_slBitmaps[fl]) _flBitmap &= ~(1ull << fl);
+	}
+
+	node->free = false;
+	node->prevFree = node->nextFree = nullptr;
+}
+
+inline void TlsfAllocator::Clear()
+{
+	while (_head)
+	{
+		Node* next = _head->nextPhysical;
+		delete _head;
+		_head = next;
+	}
+
+	for (auto& list : _freeLists) std::fill(std::begin(list), std::end(list), nullptr);
+	std::fill(std::begin(_slBitmaps), std::end(_slBitmaps), 0u);
+	_flBitmap = 0;
+	_size = _used = 0;
+	_allocationCount = 0;
+}
+
+inline void TlsfAllocator::Reset(uint64_t size)
+{
+	Clear();
+	_size = size;
+	if (!size) return;
+
+	_head = new Node{ 0, size };
+	InsertFree(_head);
+}
+
+inline TlsfAllocator::Node* TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0) return nullptr;
+	alignment = std::max<uint64_t>(alignment, 1);
+
+	//worst case padding is alignment - 1, so this always fits once found
+	Node* node = FindSuitable(size + alignment - 1);
+	if (!node) return nullptr;
+	RemoveFree(node);
+
+	//free neighbours are always merged, so both sides of a free node are in use and the splits below stay canonical
+	uint64_t aligned = (node->offset + alignment - 1) / alignment * alignment;
+	if (uint64_t padding = aligned - node->offset)
+	{
+		Node* front = new Node{ node->offset, padding };
+		front->prevPhysical = node->prevPhysical;
+		front->nextPhysical = node;
+		if (front->prevPhysical) front->prevPhysical->nextPhysical = front;
+		else _head = front;
+		node->prevPhysical = front;
+		node->offset = aligned;
+		node->size -= padding;
+		InsertFree(front);
+	}
+
+	if (node->size > size)
+	{
+		Node* back = new Node{ node->offset + size, node->size - size };
+		back->prevPhysical = node;
+		back->nextPhysical = node->nextPhysical;
+		if (back->nextPhysical) back->nextPhysical->prevPhysical = back;
+		node->nextPhysical = back;
+		node->size = size;
+		InsertFree(back);
+	}
+
+	node->free = false;
+	_used += node->size;
+	_allocationCount++;
+	return node;
+}
+
+inline void TlsfAllocator::Free(Node* node)
+{
+	_used -= node->size;
+	_allocationCount--;
+
+	if (Node* prev = node->prevPhysical; prev && prev->free)
+	{
+		RemoveFree(prev);
+		prev->size += node->size;
+		prev->nextPhysical = node->nextPhysical;
+		if (prev->nextPhysical) prev->nextPhysical->prevPhysical = prev;
+		delete node;
+		node = prev;
+	}
+
+	if (Node* next = node->nextPhysical; next && next->free)
+	{
+		RemoveFree(next);
+		node->size += next->size;
+		node->nextPhysical = next->nextPhysical;
+		if (node->nextPhysical) node->nextPhysical->prevPhysical = node;
+		delete next;
+	}
+
+	InsertFree(node);
+}
@@ -0,0 +1,45 @@
+#include "pch.h"
+
+bool UniformRing::Create(MemoryAllocator& allocator, VkPhysicalDevice physicalDevice, VkDeviceSize frameSize, unsigned int framesInFlight)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+	_frameSize = (frameSize + _alignment - 1) / _alignment * _alignment;
+
+	if (allocator.CreateBuffer(_frameSize * framesInFlight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, "Uniform Ring") != VK_SUCCESS) return false;
+
+	_allocator = &allocator;
+	BeginFrame(0);
+	return true;
+}
+
+void UniformRing::Destroy()
+{
+	if (!IsCreated()) return;
+
+	_allocator->DestroyBuffer(_buffer);
+	_allocator = nullptr;
+}
+
+void UniformRing::BeginFrame(unsigned int frameSlot)
+{
+	_offset = _frameSize * frameSlot;
+	_end = _offset + _frameSize;
+}
+
+uint32_t UniformRing::Push(const void* data, VkDeviceSize size)
+{
+	//running out means the frame size is too small, earlier pushes are still bound by this frame's draws so nothing wraps
+	if (size > _end - _offset)
+	{
+		if (!_warned) std::cout << "Warning: uniform ring frame region of " << _frameSize << " bytes can't fit a " << size << " byte push\n";
+		_warned = true;
+		return FAILED;
+	}
+
+	uint32_t offset = uint32_t(_offset);
+	memcpy(_buffer.allocation.mapped + offset, data, size);
+	_offset += (size + _alignment - 1) / _alignment * _alignment;
+	return offset;
+}
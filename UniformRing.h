@@ -0,0 +1,32 @@
+#pragma once
+
+//one persistently mapped uniform buffer split into a region per frame in flight
+//each frame bump allocates from its own region, bound through UNIFORM_BUFFER_DYNAMIC offsets
+//the region is only reused after that frame slot's fence, so the cpu never writes what the gpu is reading
+class UniformRing
+{
+	MemoryAllocator* _allocator = nullptr;
+	Buffer _buffer = {};
+	VkDeviceSize _frameSize = 0, _alignment = 1;
+	VkDeviceSize _offset = 0, _end = 0;
+	bool _warned = false;
+
+public:
+	static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 64 << 10;
+	static constexpr uint32_t FAILED = UINT32_MAX;
+
+	bool Create(MemoryAllocator& allocator, VkPhysicalDevice physicalDevice, VkDeviceSize frameSize, unsigned int framesInFlight);
+	void Destroy();
+	bool IsCreated() const { return _allocator != nullptr; }
+
+	//call after the frame slot's fence wait
+	void BeginFrame(unsigned int frameSlot);
+
+	//copies data into this frame's region and returns the dynamic offset to bind it with
+	//FAILED when the region is full, nothing already pushed this frame is overwritten and the caller must not bind it
+	uint32_t Push(const void* data, VkDeviceSize size);
+	template <typename T>
+	uint32_t Push(const T& data) { return Push(&data, sizeof(T)); }
+
+	const Buffer& GetBuffer() const { return _buffer; }
+};
@@ -0,0 +1,53 @@
+#include "pch.h"
+
+void WorkerPool::Create(unsigned int threadCount)
+{
+	_stop = false;
+	_threads.reserve(threadCount);
+	for (unsigned int worker = 0; worker < threadCount; worker++) _threads.emplace_back(&WorkerPool::Work, this, worker);
+}
+
+void WorkerPool::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (auto& thread : _threads) thread.join();
+	_threads.clear();
+}
+
+void WorkerPool::Work(unsigned int worker)
+{
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_wake.wait(lock, [&]() { return _stop || _generation != seen; });
+		if (_stop) return;
+		seen = _generation;
+		if (worker >= _jobCount) continue;
+
+		lock.unlock();
+		_job(_context, worker);
+		lock.lock();
+		if (--_pending == 0) _done.notify_one();
+	}
+}
+
+void WorkerPool::Dispatch(unsigned int count, void* context, void (*job)(void*, unsigned int))
+{
+	count = std::min(count, GetThreadCount());
+	if (count == 0) return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_job = job;
+	_context = context;
+	_jobCount = count;
+	_pending = count;
+	_generation++;
+	_wake.notify_all();
+	//every participant has seen this generation before the next dispatch can start
+	_done.wait(lock, [&]() { return _pending == 0; });
+}
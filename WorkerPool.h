@@ -0,0 +1,31 @@
+#pragma once
+
+//persistent recording threads, worker w only ever runs job w so it can own per thread state such as command pool w + 1
+//jobs are a context pointer and a plain function, dispatching allocates nothing
+class WorkerPool
+{
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _wake, _done;
+	void (*_job)(void*, unsigned int) = nullptr;
+	void* _context = nullptr;
+	unsigned int _jobCount = 0;
+	unsigned int _pending = 0;
+	uint64_t _generation = 0; //bumped per dispatch so sleeping workers can tell a new one from a spurious wake
+	bool _stop = false;
+
+	void Work(unsigned int worker);
+	void Dispatch(unsigned int count, void* context, void (*job)(void*, unsigned int));
+
+public:
+	void Create(unsigned int threadCount);
+	void Destroy();
+	unsigned int GetThreadCount() const { return (unsigned int)_threads.size(); }
+
+	//calls fn(worker) on workers 0..count - 1 and returns once all of them have, count is capped at the thread count
+	template <typename Fn>
+	void Run(unsigned int count, Fn& fn)
+	{
+		Dispatch(count, &fn, [](void* context, unsigned int worker) { (*static_cast<Fn*>(context))(worker); });
+	}
+};
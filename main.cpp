@@ -1,21 +1,71 @@
 #include "pch.h"
 #include "Renderer.h"
+#include "Benchmark.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	GWindow win;
-	Renderer* renderer;
+	Renderer* renderer = nullptr;
 	entt::registry registry;
 	bool useVulkan = true;
 
-	if (+win.Create(0, 0, 1280, 720, GWindowStyle::WINDOWEDBORDERED))
+	//--benchmark [results.csv] [--scenes <dir>] sweeps generated scenes with every gbuffer layout and merge setting and exits
+	//--memory-report <file.json> writes the gpu memory report on exit
+	//--timeline <file.json> writes the last frames' per queue node timings on exit, open it in chrome://tracing
+	//--compact-gbuffer rebuilds positions from depth and stores octahedral normals
+	//--no-subpass-merge keeps the offscreen and composition passes in separate render passes, for comparing output
+	//either of the last two limits --benchmark to that one configuration
+	bool benchmark = false, mergeSubpasses = true, configured = false;
+	GBufferLayout gBufferLayout = GBufferLayout::FULL;
+	std::string memoryReport, timeline;
+	BenchmarkSettings benchmarkSettings;
+	for (int i = 1; i < argc; i++)
 	{
-		renderer = useVulkan ? static_cast<Renderer*>(new VulkanRenderer(win)) : static_cast<Renderer*>(new DX12Renderer(win));
+		std::string arg = argv[i];
+		if (arg == "--benchmark")
+		{
+			benchmark = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') benchmarkSettings.output = argv[++i];
+		}
+		else if (arg == "--scenes" && i + 1 < argc) benchmarkSettings.sceneDirectory = argv[++i];
+		else if (arg == "--memory-report" && i + 1 < argc) memoryReport = argv[++i];
+		else if (arg == "--timeline" && i + 1 < argc) timeline = argv[++i];
+		else if (arg == "--compact-gbuffer")
+		{
+			gBufferLayout = GBufferLayout::COMPACT;
+			configured = true;
+		}
+		else if (arg == "--no-subpass-merge")
+		{
+			mergeSubpasses = false;
+			configured = true;
+		}
+	}
 
-		while (+win.ProcessWindowEvents())
+	if (+win.Create(0, 0, 1280, 720, GWindowStyle::WINDOWEDBORDERED))
+	{
+		if (benchmark)
 		{
-			renderer->Render();
-			renderer->UpdateCamera();
+			if (configured) benchmarkSettings.configurations = { { gBufferLayout, mergeSubpasses } };
+			//the reports are of the last configuration
+			VulkanRenderer* vulkanRenderer = nullptr;
+			Benchmark(benchmarkSettings).Run(vulkanRenderer, win);
+			renderer = vulkanRenderer;
+			if (vulkanRenderer && !memoryReport.empty()) vulkanRenderer->WriteMemoryReport(memoryReport);
+			if (vulkanRenderer && !timeline.empty()) vulkanRenderer->WriteTimeline(timeline);
+		}
+		else
+		{
+			renderer = useVulkan ? static_cast<Renderer*>(new VulkanRenderer(win, gBufferLayout, mergeSubpasses)) : static_cast<Renderer*>(new DX12Renderer(win));
+
+			while (+win.ProcessWindowEvents())
+			{
+				renderer->Render();
+				renderer->UpdateCamera();
+			}
+
+			if (!memoryReport.empty() && useVulkan) static_cast<VulkanRenderer*>(renderer)->WriteMemoryReport(memoryReport);
+			if (!timeline.empty() && useVulkan) static_cast<VulkanRenderer*>(renderer)->WriteTimeline(timeline);
 		}
 	}
 	
@@ -16,6 +16,7 @@
 #define GATEWARE_DISABLE_GOPENGLSURFACE // we have another template for this
 // With what we want & what we don't defined we can include the API
 #include "Gateware/Gateware.h"
+#include "tinygltf/json.hpp"
 #include "tinygltf/tiny_gltf.h"
 #include "entt/entt.hpp"
 
@@ -23,10 +24,20 @@
 #include <wrl/client.h>
 #pragma comment(lib, "dxcompiler.lib")
 
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <random>
 #include <set>
-#include <variant>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 using GWindow = GW::SYSTEM::GWindow;
 using GWindowStyle = GW::SYSTEM::GWindowStyle;
@@ -45,7 +56,20 @@ using mat3 = GW::MATH2D::GMATRIX3F;
 using vec3 = GW::MATH2D::GVECTOR3F;
 using vec2 = GW::MATH2D::GVECTOR2F;
 
+#include "CookedFormat.h"
+#include "TlsfAllocator.h"
+#include "MemoryAllocator.h"
 #include "Structs.h"
 #include "Components.h"
+#include "FrameGraphCompiler.h"
 #include "FrameGraph.h"
+#include "StagingRing.h"
+#include "UniformRing.h"
+#include "FrameCommandPools.h"
+#include "WorkerPool.h"
+#include "RangeAllocator.h"
+#include "GeometryArena.h"
+#include "PipelineCache.h"
+#include "ShaderCompiler.h"
+#include "DescriptorAllocator.h"
 